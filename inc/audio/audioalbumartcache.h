@@ -0,0 +1,59 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_ALBUM_ART_CACHE_H
+#define AUDIO_ALBUM_ART_CACHE_H
+
+#include "audio/audiometadata.h"
+
+#include <cinttypes>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace audio
+{
+
+// Content addressed store of album art images
+// Every image is written once to the cache directory, named after the hash of its data,
+// so the identical covers embedded in all tracks of an album share a single file.
+// All methods are thread safe.
+class AlbumArtCache
+{
+public:
+    // The directory is created if it does not exist
+    AlbumArtCache(const std::string& directory);
+
+    // Adds the image if it is not in the cache yet, returns its hash or 0 if the art is empty
+    // The hash is also returned when writing the image failed, contains tells if it is available
+    uint64_t store(const AlbumArtView& art);
+    // Only true once the image file is completely written
+    bool contains(uint64_t hash) const;
+    // Path of the cached image file, empty if the image is not in the cache
+    std::string getPath(uint64_t hash) const;
+
+private:
+    std::string                                 m_Directory;
+    std::unordered_map<uint64_t, std::string>   m_Images;
+    std::unordered_set<uint64_t>                m_Writing; // images that are being written by a store call
+    mutable std::mutex                          m_Mutex;
+};
+
+}
+
+#endif
@@ -20,6 +20,7 @@
 #include <string>
 
 #include "audio/audioformat.h"
+#include "audio/audiometrics.h"
 
 namespace audio
 {
@@ -43,9 +44,15 @@ public:
     virtual double  getProgress() = 0;
     virtual size_t getFrameSize() = 0;
 
+    // Adds the metrics of the decoder to the snapshot, safe to call from any thread
+    void getMetrics(MetricsSnapshot& snapshot, const std::string& prefix) const { m_Metrics.snapshot(snapshot, prefix); }
+    // Not safe while decoding
+    void resetMetrics() { m_Metrics.reset(); }
+
 protected:
     std::string         m_Filepath;
     double              m_AudioClock;
+    DecoderMetrics      m_Metrics;
 };
 
 }
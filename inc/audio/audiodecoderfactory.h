@@ -17,6 +17,7 @@
 #ifndef AUDIO_DECODER_FACTORY_H
 #define AUDIO_DECODER_FACTORY_H
 
+#include <atomic>
 #include <string>
 
 namespace audio
@@ -28,6 +29,15 @@ class DecoderFactory
 {
 public:
     static IDecoder* create(const std::string& filepath);
+
+    // Local files are read through a memory mapping instead of a buffered reader, disabled by default
+    // The decoders then parse the data in place, but a file that is truncated by another
+    // process while it is being played crashes the application with SIGBUS.
+    static void setMemoryMappedFiles(bool enabled);
+    static bool useMemoryMappedFiles();
+
+private:
+    static std::atomic<bool> s_MemoryMappedFiles;
 };
 
 }
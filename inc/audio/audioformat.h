@@ -29,7 +29,8 @@ struct Format
         return     (bits            == otherFormat.bits)
                 && (rate            == otherFormat.rate)
                 && (numChannels     == otherFormat.numChannels)
-                && (framesPerPacket == otherFormat.framesPerPacket);
+                && (framesPerPacket == otherFormat.framesPerPacket)
+                && (floatingPoint   == otherFormat.floatingPoint);
     }
 
     uint32_t bits = 0;
@@ -23,6 +23,7 @@
 namespace audio
 {
 
+// Use PlaylistParser to avoid copying the entries or to get the extended info
 class M3uParser
 {
 public:
@@ -18,9 +18,12 @@
 #define AUDIO_METADATA_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 
+#include "audio/audiostringarena.h"
+
 namespace TagLib
 {
 
@@ -48,6 +51,35 @@ struct AlbumArt
     std::vector<uint8_t>    data;
 };
 
+// Album art embedded in the file, the data points into the parsed tag
+// and is only valid as long as the Metadata object exists
+struct AlbumArtView
+{
+    ImageFormat             format = ImageFormat::Unknown;
+    const uint8_t*          pData = nullptr;
+    size_t                  size = 0;
+
+    bool empty() const { return size == 0; }
+};
+
+// All the fields of a file, the strings are stored in the arena that was passed to readAll
+struct MetadataFields
+{
+    std::string_view    artist;
+    std::string_view    title;
+    std::string_view    album;
+    std::string_view    albumArtist;
+    std::string_view    genre;
+    std::string_view    composer;
+    uint32_t            discNr = 0;
+    uint32_t            year = 0;
+    uint32_t            trackNr = 0;
+    uint32_t            bitRate = 0;
+    uint32_t            sampleRate = 0;
+    uint32_t            channels = 0;
+    uint32_t            duration = 0;
+};
+
 class Metadata
 {
 public:
@@ -61,6 +93,9 @@ public:
 
     Metadata(const std::string& filepath, ReadAudioProperties props);
 
+    // True if the file extension is one of the supported file types
+    static bool isSupported(const std::string& filepath);
+
     std::string getArtist();
     std::string getTitle();
     std::string getAlbum();
@@ -75,6 +110,12 @@ public:
     uint32_t getChannels();
     uint32_t getDuration();
     AlbumArt getAlbumArt();
+    // Presence, size and format of the album art and its data without copying it
+    AlbumArtView getAlbumArtView();
+
+    // Reads all fields at once, the tags are only walked once per tag type
+    // Prefer this over the getters when more than a couple of fields are needed
+    MetadataFields readAll(StringArena& arena);
 
 private:
     void throwIfNotValid() const;
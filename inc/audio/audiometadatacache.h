@@ -0,0 +1,100 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_METADATA_CACHE_H
+#define AUDIO_METADATA_CACHE_H
+
+#include "audio/audiometadatascanner.h"
+
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace audio
+{
+
+class MemoryMappedFile;
+
+// Identifies the version of a file, the cached metadata is only used when it matches
+struct FileStamp
+{
+    uint64_t    size = 0;
+    int64_t     modificationTime = 0;
+
+    // Returns false when the file does not exist
+    static bool get(const std::string& path, FileStamp& stamp);
+};
+
+// Persistent cache of file metadata
+// The cache file is memory mapped and consists of fixed size records sorted
+// on the hash of the path followed by the strings, lookups do not need to
+// parse or load the file. Stored entries are kept in memory until save is called.
+// The file uses the native byte order. All methods are thread safe.
+class MetadataCache
+{
+public:
+    // Optional parts of the metadata that depend on how the file was read
+    enum Fields : uint32_t
+    {
+        AudioProperties = 1 << 0,   // bitRate, sampleRate, channels and duration
+        AlbumArtHash    = 1 << 1,
+    };
+
+    // A missing or corrupt cache file results in an empty cache
+    MetadataCache(const std::string& cachePath);
+    ~MetadataCache();
+
+    // Returns true and fills in the metadata if the cache contains the file with the same stamp
+    // and the entry contains at least the requested fields
+    bool lookup(const std::string& path, const FileStamp& stamp, uint32_t fields, TrackMetadata& meta);
+    // fields are the optional parts that were read, the tags are always expected to be complete
+    void store(const std::string& path, const FileStamp& stamp, uint32_t fields, const TrackMetadata& meta);
+
+    // Writes the cache file, when dropUnused is set the files that were not looked up
+    // or stored since the cache was opened are removed (e.g. after a full library scan)
+    void save(bool dropUnused = false);
+
+private:
+    struct Record;
+    struct Entry
+    {
+        FileStamp       stamp;
+        uint32_t        fields = 0;
+        TrackMetadata   meta;
+    };
+
+    void map();
+    const Record* findRecord(const std::string& path) const;
+    void readRecord(const Record& record, TrackMetadata& meta) const;
+
+    std::string                             m_Path;
+    std::unique_ptr<MemoryMappedFile>       m_File;
+    const Record*                           m_pRecords;
+    uint64_t                                m_RecordCount;
+    const char*                             m_pStrings;
+    uint64_t                                m_StringsSize;
+    std::vector<bool>                       m_Used;
+    std::unordered_map<std::string, Entry>  m_Updates;
+    std::mutex                              m_Mutex;
+};
+
+}
+
+#endif
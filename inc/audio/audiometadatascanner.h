@@ -0,0 +1,94 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_METADATA_SCANNER_H
+#define AUDIO_METADATA_SCANNER_H
+
+#include <atomic>
+#include <cinttypes>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace audio
+{
+
+class AlbumArtCache;
+class MetadataCache;
+
+// All the tags of a file, read at once
+struct TrackMetadata
+{
+    std::string path;
+    std::string artist;
+    std::string title;
+    std::string album;
+    std::string albumArtist;
+    std::string genre;
+    std::string composer;
+    uint32_t    discNr = 0;
+    uint32_t    year = 0;
+    uint32_t    trackNr = 0;
+    uint32_t    bitRate = 0;
+    uint32_t    sampleRate = 0;
+    uint32_t    channels = 0;
+    uint32_t    duration = 0;
+    uint64_t    albumArtHash = 0;   // 0: no album art or not read
+};
+
+// Reads the metadata of a list of files and directory trees in parallel
+// Directories are walked on the calling thread while a pool of worker threads
+// reads the tags, the number of files that is being read at the same time
+// is limited separately so slow disks are not flooded with requests.
+class MetadataScanner
+{
+public:
+    struct Options
+    {
+        uint32_t    threads = 0;            // 0: number of cores
+        uint32_t    maxOpenFiles = 4;       // files being read at the same time
+        bool        readAudioProperties = true;
+        bool        nativeReaders = true;   // read mp3 and flac tags without taglib when possible
+        bool        hashAlbumArt = false;
+        // Stores the album art of the files that are read, implies hashAlbumArt
+        AlbumArtCache*  albumArtCache = nullptr;
+        // Files that are in the cache and did not change are not opened,
+        // the files that are read are added to it. The cache is not saved by the scanner.
+        MetadataCache*  cache = nullptr;
+    };
+
+    // The callbacks are called from the worker threads, but never concurrently
+    using TrackCallback = std::function<void(const TrackMetadata&)>;
+    using ErrorCallback = std::function<void(const std::string& path, const std::string& error)>;
+
+    MetadataScanner();
+    MetadataScanner(const Options& options);
+
+    // Blocks until all files are read, returns the number of files that were read successfully
+    // Paths can be files or directories, directories are scanned recursively for supported files
+    uint64_t scan(const std::vector<std::string>& paths, const TrackCallback& onTrack, const ErrorCallback& onError = nullptr);
+    // Stops a running scan, can be called from any thread and from the callbacks
+    void cancel();
+
+private:
+    Options             m_Options;
+    std::atomic<bool>   m_Cancelled;
+};
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_METRICS_H
+#define AUDIO_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <map>
+#include <string>
+
+namespace audio
+{
+
+// Global switch for metric collection, disabled by default
+// When disabled recording a value costs a single relaxed load and the clock is not read.
+class Metrics
+{
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+private:
+    static std::atomic<bool> s_Enabled;
+};
+
+class Counter
+{
+public:
+    void increment(uint64_t value = 1)
+    {
+        if (Metrics::isEnabled())
+        {
+            m_Value.fetch_add(value, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t value() const { return m_Value.load(std::memory_order_relaxed); }
+    void reset() { m_Value.store(0, std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t>   m_Value {0};
+};
+
+struct HistogramSnapshot
+{
+    // bucket 0 counts the zero values, bucket i the values in [2^(i-1), 2^i)
+    static const size_t NumBuckets = 32;
+
+    double mean() const;
+    // Upper bound of the bucket that contains the percentile (0 - 100)
+    uint64_t percentile(double percent) const;
+    // Merges the values recorded in the other snapshot
+    void add(const HistogramSnapshot& other);
+
+    std::array<uint64_t, NumBuckets>    buckets {};
+    uint64_t                            count = 0;
+    uint64_t                            sum = 0;
+    uint64_t                            max = 0;
+};
+
+// Histogram with power of two buckets, recording is lock free
+class Histogram
+{
+public:
+    void record(uint64_t value);
+    HistogramSnapshot snapshot() const;
+    void reset();
+
+private:
+    std::array<std::atomic<uint64_t>, HistogramSnapshot::NumBuckets>  m_Buckets {};
+    std::atomic<uint64_t>                                              m_Count {0};
+    std::atomic<uint64_t>                                              m_Sum {0};
+    std::atomic<uint64_t>                                              m_Max {0};
+};
+
+// Records its lifetime in microseconds
+class ScopedTimer
+{
+public:
+    ScopedTimer(Histogram& histogram);
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram*                              m_pHistogram;
+    std::chrono::steady_clock::time_point   m_Start;
+};
+
+// Point in time copy of metrics, the names are prefixed with the component (e.g. renderer.underruns)
+struct MetricsSnapshot
+{
+    // Sums the counters and merges the histograms of the other snapshot
+    void add(const MetricsSnapshot& other);
+
+    std::map<std::string, uint64_t>             counters;
+    std::map<std::string, HistogramSnapshot>    histograms;
+};
+
+struct RendererMetrics
+{
+    void snapshot(MetricsSnapshot& snapshot, const std::string& prefix) const;
+
+    Counter     underruns;
+    Counter     bytesQueued;
+};
+
+struct DecoderMetrics
+{
+    void snapshot(MetricsSnapshot& snapshot, const std::string& prefix) const;
+    void reset();
+
+    Counter     framesDecoded;
+    Counter     decodeErrors;
+    Histogram   decodeTime;         // microseconds per frame
+};
+
+struct PlaybackMetrics
+{
+    void snapshot(MetricsSnapshot& snapshot, const std::string& prefix) const;
+
+    Counter     wakeUps;
+    Counter     commands;
+    Counter     seeks;
+    Counter     rebuffers;
+    Counter     tracksStarted;
+    Histogram   bufferFill;         // milliseconds of buffered audio, sampled on every wake up
+    Histogram   trackStartLatency;  // microseconds from starting a track until its first audio is queued
+};
+
+}
+
+#endif
@@ -0,0 +1,82 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef AUDIO_PLAYBACK_CLOCK_H
+#define AUDIO_PLAYBACK_CLOCK_H
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <mutex>
+
+namespace audio
+{
+
+struct PlaybackPosition
+{
+    double                                  pts = 0.0;      // position in the track in seconds
+    int64_t                                 frames = 0;     // position in the track in sample frames
+    std::chrono::steady_clock::time_point   timestamp;      // monotonic time at which the position was sampled
+};
+
+// Playback position that is interpolated between device updates
+// The renderer updates the clock whenever it learns the real device position,
+// getPosition is lock free and does not touch the audio device so it can be
+// called at a high rate from any thread.
+class PlaybackClock
+{
+public:
+    PlaybackClock();
+
+    void setSampleRate(uint32_t rate);
+    // Update with the pts that is currently audible
+    void update(double pts, bool running);
+    void setRunning(bool running);
+    // Pts of the end of the queued audio, the clock will not interpolate beyond it
+    void setLimit(double pts);
+    void reset(double pts = 0.0);
+
+    PlaybackPosition getPosition() const;
+
+private:
+    struct Anchor
+    {
+        double  pts;
+        int64_t time;
+        double  limit;
+        double  speed;
+        bool    running;
+    };
+
+    Anchor readAnchor() const;
+    void writeAnchor(const Anchor& anchor);
+    static double interpolate(const Anchor& anchor, int64_t time);
+    static int64_t now();
+
+    std::atomic<uint32_t>   m_Sequence;
+    std::atomic<double>     m_Pts;
+    std::atomic<int64_t>    m_Time;
+    std::atomic<double>     m_Limit;
+    std::atomic<double>     m_Speed;
+    std::atomic<bool>       m_Running;
+    std::atomic<uint32_t>   m_SampleRate;
+
+    std::mutex              m_WriteMutex;
+};
+
+}
+
+#endif
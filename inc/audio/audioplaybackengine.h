@@ -0,0 +1,95 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef AUDIO_PLAYBACK_ENGINE_H
+#define AUDIO_PLAYBACK_ENGINE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cinttypes>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace audio
+{
+
+class IPlayback;
+class IPlaylist;
+class Playback;
+
+// Runs many playback sessions on a small pool of threads
+// Sessions are scheduled on the first available thread in the order of their
+// deadline (the moment their renderer buffer needs more audio).
+// The engine has to outlive the playback instances it created and they
+// should not be destroyed from within one of their own signal handlers.
+class PlaybackEngine
+{
+public:
+    PlaybackEngine(uint32_t numThreads);
+    ~PlaybackEngine();
+
+    PlaybackEngine(const PlaybackEngine&) = delete;
+    PlaybackEngine& operator=(const PlaybackEngine&) = delete;
+
+    IPlayback* createPlayback(IPlaylist& playlist, const std::string& appName, const std::string& audioOutput, const std::string& deviceName);
+
+private:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    friend class Playback;
+
+    void addSession(Playback* pSession);
+    void removeSession(Playback* pSession);
+    void wakeUp(Playback* pSession);
+
+    struct Session
+    {
+        uint64_t    generation = 0;
+        TimePoint   deadline = TimePoint::max();
+        bool        running = false;
+        bool        wakeUp = false;
+    };
+
+    struct Entry
+    {
+        TimePoint   deadline;
+        Playback*   pSession;
+        uint64_t    generation;
+
+        bool operator>(const Entry& other) const { return deadline > other.deadline; }
+    };
+
+    void schedule(Playback* pSession, Session& session, TimePoint deadline);
+    void workerThread();
+
+    bool                                                        m_Stop;
+    uint64_t                                                    m_Generation;
+    std::unordered_map<Playback*, Session>                      m_Sessions;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> m_Queue;
+
+    std::mutex                                                  m_Mutex;
+    std::condition_variable                                     m_Condition;
+    std::condition_variable                                     m_SessionDone;
+    std::vector<std::thread>                                    m_Threads;
+};
+
+}
+
+#endif
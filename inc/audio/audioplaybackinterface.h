@@ -18,7 +18,11 @@
 #define AUDIO_PLAYBACK_INTERFACE_H
 
 #include "utils/signal.h"
+#include "audio/audiometrics.h"
+#include "audio/audioplaybackclock.h"
 #include <set>
+#include <chrono>
+#include <future>
 #include <memory>
 
 namespace audio
@@ -42,37 +46,65 @@ enum class PlaybackAction
     Next
 };
 
+// Controls how much audio is buffered, a duration of zero disables the corresponding rule
+// Larger values trade start latency for less risk of underruns on slow (network) sources.
+struct BufferPolicy
+{
+    // audio that is buffered before the renderer is started or resumed after rebuffering,
+    // when zero the renderer is started as soon as its buffer is full
+    std::chrono::milliseconds   preRoll = std::chrono::milliseconds(0);
+    // when less audio is buffered while playing an underrun is imminent,
+    // the renderer is paused until the pre roll is buffered again
+    std::chrono::milliseconds   lowWatermark = std::chrono::milliseconds(0);
+    // decoding is throttled once this much audio is buffered,
+    // when zero the renderer buffer is filled completely
+    std::chrono::milliseconds   highWatermark = std::chrono::milliseconds(0);
+};
+
 class IPlayback
 {
 public:
     virtual ~IPlayback() {}
 
-    virtual void play() = 0;
-    virtual void pause() = 0;
-    virtual void stop() = 0;
-    virtual void prev() = 0;
-    virtual void next() = 0;
+    // Control operations are asynchronous, the future completes when the operation has been executed
+    virtual std::future<void> play() = 0;
+    virtual std::future<void> pause() = 0;
+    virtual std::future<void> stop() = 0;
+    virtual std::future<void> prev() = 0;
+    virtual std::future<void> next() = 0;
 
     virtual PlaybackState getState() const = 0;
     virtual bool isPlaying() const = 0;
 
-    virtual void seek(double seconds) = 0;
+    virtual std::future<void> seek(double seconds) = 0;
     virtual double getCurrentTime() const = 0;
     virtual double getDuration() const = 0;
+    // Sample accurate position, interpolated between renderer updates
+    virtual PlaybackPosition getPlaybackPosition() const = 0;
 
-    virtual void setVolume(int32_t volume) = 0;
+    virtual std::future<void> setVolume(int32_t volume) = 0;
     virtual int32_t getVolume() const = 0;
-    virtual void setMute(bool mute) = 0;
+    virtual std::future<void> setMute(bool mute) = 0;
     virtual bool getMute() const = 0;
 
     virtual std::shared_ptr<ITrack> getTrack() const = 0;
     virtual std::set<PlaybackAction> getAvailableActions() const = 0;
 
+    virtual std::future<void> setBufferPolicy(const BufferPolicy& policy) = 0;
+    virtual BufferPolicy getBufferPolicy() const = 0;
+    // True while playback waits for the pre roll to be buffered
+    virtual bool isBuffering() const = 0;
+
+    // Metrics of the playback, renderer and the decoders (summed over all tracks and seeks),
+    // only collected when enabled with Metrics::setEnabled
+    virtual MetricsSnapshot getMetrics() const = 0;
+
     utils::Signal<PlaybackState>              PlaybackStateChanged;
     utils::Signal<std::set<PlaybackAction>>   AvailableActionsChanged;
     utils::Signal<double>                     ProgressChanged;
     utils::Signal<int32_t>                    VolumeChanged;
     utils::Signal<std::shared_ptr<ITrack>>    NewTrackStarted;
+    utils::Signal<bool>                       BufferingChanged;
 };
 
 }
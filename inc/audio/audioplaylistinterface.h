@@ -18,6 +18,7 @@
 #define AUDIO_PLAYLIST_INTERFACE_H
 
 #include <memory>
+#include <vector>
 
 namespace audio
 {
@@ -31,6 +32,9 @@ public:
 
     virtual std::shared_ptr<ITrack> dequeueNextTrack() = 0;
     virtual size_t getNumberOfTracks() const = 0;
+
+    // The tracks that will be dequeued next without removing them, used to open them in advance
+    virtual std::vector<std::shared_ptr<ITrack>> peekNextTracks(size_t /*count*/) const { return {}; }
 };
 
 }
@@ -0,0 +1,61 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_PLAYLIST_PARSER_H
+#define AUDIO_PLAYLIST_PARSER_H
+
+#include <cinttypes>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace audio
+{
+
+struct PlaylistEntry
+{
+    std::string_view    path;               // as written in the playlist
+    std::string_view    title;              // from #EXTINF or TitleN=, empty when not present
+    double              duration = -1.0;    // seconds, negative when unknown
+};
+
+// Single pass parser for m3u, m3u8 and pls playlists
+// The entries are passed to the callback as soon as they are parsed, their views
+// point into the playlist contents so nothing is copied. Pls entries are passed on
+// at the end in the order of their numbers, their keys do not have to be adjacent.
+class PlaylistParser
+{
+public:
+    using EntryCallback = std::function<void(const PlaylistEntry&)>;
+    using ResolvedEntryCallback = std::function<void(const PlaylistEntry&, const std::string& resolvedPath)>;
+
+    // The format is detected from the contents, returns the number of entries
+    static uint64_t parse(std::string_view contents, const EntryCallback& onEntry);
+    static uint64_t parseM3u(std::string_view contents, const EntryCallback& onEntry);
+    static uint64_t parsePls(std::string_view contents, const EntryCallback& onEntry);
+
+    // Parses the playlist file, relative entries are resolved against its directory
+    // Throws when the file cannot be read
+    static uint64_t parseFile(const std::string& path, const ResolvedEntryCallback& onEntry);
+
+    // Absolute paths and uris are returned unchanged
+    static std::string resolvePath(std::string_view playlistPath, std::string_view entryPath);
+};
+
+}
+
+#endif
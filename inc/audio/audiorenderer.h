@@ -20,6 +20,8 @@
 #include <cinttypes>
 
 #include "utils/signal.h"
+#include "audio/audiometrics.h"
+#include "audio/audioplaybackclock.h"
 
 namespace audio
 {
@@ -50,9 +52,31 @@ public:
     virtual void flushBuffers() = 0;
     virtual void queueFrame(const Frame& frame) = 0;
 
+    // Drop the queued audio except for the next fadeDuration seconds, which are faded out.
+    // Playback continues, so audio that is queued afterwards follows without a gap.
+    // Returns false when this is not supported, nothing is dropped in that case.
+    virtual bool flushTail(double /*fadeDuration*/) { return false; }
+
+    // Amount of audio (in seconds) the playback buffers before starting the renderer,
+    // renderers that start playing by themselves should not start earlier
+    virtual void setPreRoll(double /*duration*/) {}
+
     virtual double getCurrentPts() = 0;
 
+    // Interpolated position that does not query the device, safe to call from any thread
+    virtual PlaybackPosition getPlaybackPosition() const { return m_Clock.getPosition(); }
+
+    // Adds the metrics of the renderer to the snapshot, safe to call from any thread
+    virtual void getMetrics(MetricsSnapshot& snapshot, const std::string& prefix) const { m_Metrics.snapshot(snapshot, prefix); }
+
     utils::Signal<int32_t>    VolumeChanged;
+    // Emitted when the renderer consumed buffered audio from its own thread,
+    // renderers without such a thread never emit it and are polled instead
+    utils::Signal<>           SpaceAvailable;
+
+protected:
+    PlaybackClock             m_Clock;
+    RendererMetrics           m_Metrics;
 };
 
 }
@@ -0,0 +1,96 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_STREAM_CACHE_H
+#define AUDIO_STREAM_CACHE_H
+
+#include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace audio
+{
+
+// Disk cache for the data of tracks that are streamed from remote uris
+// Every track is stored in fixed size chunks in a sparse data file with an index
+// of the chunks that are present, so partially played tracks are resumed where
+// they were left. When the cache grows beyond its maximum size the least
+// recently used tracks are removed.
+// All methods are thread safe.
+class StreamCache
+{
+public:
+    static const uint64_t ChunkSize = 256 * 1024;
+
+    // The directory is created if it does not exist
+    StreamCache(const std::string& directory, uint64_t maxSize);
+
+    // The cache used by the decoders for remote uris, there is none by default
+    static void setDefault(std::shared_ptr<StreamCache> cache);
+    static std::shared_ptr<StreamCache> getDefault();
+
+    // Marks the track as in use so it is not evicted, returns the content length or 0 if unknown
+    uint64_t acquire(const std::string& uri);
+    void release(const std::string& uri);
+    void setContentLength(const std::string& uri, uint64_t length);
+
+    // Returns false if the chunk is not cached, the track needs to be acquired
+    bool readChunk(const std::string& uri, uint64_t index, std::vector<uint8_t>& data);
+    // Only complete chunks are stored, the last chunk of a track can be shorter
+    void writeChunk(const std::string& uri, uint64_t index, const uint8_t* pData, uint64_t size);
+
+    uint64_t size() const;
+
+private:
+    struct Entry
+    {
+        std::string             uri;
+        uint64_t                contentLength = 0;
+        std::vector<bool>       chunks;
+        uint64_t                lastUse = 0;
+        uint32_t                users = 0;
+        // incremented when the cached data is discarded, detects stale chunk io
+        uint64_t                generation = 0;
+    };
+
+    Entry& getEntry(const std::string& uri);
+    uint64_t chunkSize(const Entry& entry, uint64_t index) const;
+    uint64_t cachedSize(const Entry& entry) const;
+    void loadIndex(const std::string& path);
+    void saveIndex(uint64_t key, const Entry& entry);
+    void removeEntry(uint64_t key);
+    void makeRoom(uint64_t size);
+    std::string dataPath(uint64_t key) const;
+    std::string indexPath(uint64_t key) const;
+
+    std::string                             m_Directory;
+    uint64_t                                m_MaxSize;
+    uint64_t                                m_Size;
+    uint64_t                                m_UseCounter;
+    std::unordered_map<uint64_t, Entry>     m_Entries;
+    mutable std::mutex                      m_Mutex;
+
+    static std::shared_ptr<StreamCache>     s_Default;
+    static std::mutex                       s_DefaultMutex;
+};
+
+}
+
+#endif
@@ -0,0 +1,57 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_STRING_ARENA_H
+#define AUDIO_STRING_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace audio
+{
+
+// Stores many small strings in large blocks instead of allocating each of them
+// The returned views stay valid until the arena is cleared or destroyed.
+class StringArena
+{
+public:
+    StringArena(size_t blockSize = 64 * 1024);
+
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+
+    std::string_view add(std::string_view value);
+    // Invalidates all views, the first block is kept for reuse
+    void clear();
+
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t                  size;
+    };
+
+    std::vector<Block>  m_Blocks;
+    size_t              m_BlockSize;
+    size_t              m_Used;
+};
+
+}
+
+#endif
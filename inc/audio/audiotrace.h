@@ -0,0 +1,41 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_TRACE_H
+#define AUDIO_TRACE_H
+
+#include <string>
+
+namespace audio
+{
+
+// Trace of the stages of the decode and render pipeline (decoding, queueing, waiting, ...)
+// The events are only recorded when the library is built with tracing support (HAVE_TRACING),
+// they are kept in a fixed size ring buffer so only the most recent events are available.
+class Trace
+{
+public:
+    static bool isSupported();
+
+    // The recorded events in the Chrome trace event format (load in chrome://tracing or Perfetto)
+    static std::string exportChromeJson();
+    static void clear();
+};
+
+}
+
+#endif
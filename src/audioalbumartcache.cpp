@@ -0,0 +1,139 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audio/audioalbumartcache.h"
+#include "audiohash.h"
+
+#include "utils/format.h"
+#include "utils/log.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+using namespace utils;
+
+namespace audio
+{
+
+static const char* extensionForFormat(ImageFormat format)
+{
+    switch (format)
+    {
+    case ImageFormat::Png:      return "png";
+    case ImageFormat::Jpeg:     return "jpg";
+    case ImageFormat::Bitmap:   return "bmp";
+    case ImageFormat::Gif:      return "gif";
+    default:                    return "img";
+    }
+}
+
+AlbumArtCache::AlbumArtCache(const std::string& directory)
+: m_Directory(directory)
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_Directory, error);
+    if (error)
+    {
+        throw std::logic_error("Failed to create album art cache directory: " + m_Directory);
+    }
+
+    // the file names are the hashes of the images
+    for (auto& entry : std::filesystem::directory_iterator(m_Directory, error))
+    {
+        auto name = entry.path().stem().string();
+        if (name.size() == 16 && entry.path().extension() != ".tmp")
+        {
+            try
+            {
+                m_Images.emplace(std::stoull(name, nullptr, 16), entry.path().string());
+            }
+            catch (std::exception&)
+            {
+                // not one of our files
+            }
+        }
+    }
+}
+
+uint64_t AlbumArtCache::store(const AlbumArtView& art)
+{
+    if (art.empty())
+    {
+        return 0;
+    }
+
+    uint64_t hash = hashData(art.pData, art.size);
+    auto path = fmt::format("{}/{:016x}.{}", m_Directory, hash, extensionForFormat(art.format));
+
+    {
+        // concurrent stores of the same cover only write it once
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Images.find(hash) != m_Images.end() || !m_Writing.insert(hash).second)
+        {
+            return hash;
+        }
+    }
+
+    // write and rename so readers never see a partial image
+    auto tempPath = path + ".tmp";
+    bool written = false;
+    {
+        std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char*>(art.pData), art.size);
+        stream.close();
+        written = static_cast<bool>(stream);
+    }
+
+    std::error_code error;
+    if (written)
+    {
+        std::filesystem::rename(tempPath, path, error);
+    }
+
+    bool stored = written && !error;
+    if (!stored)
+    {
+        log::warn("Failed to store album art {}: {}", path, written ? error.message() : "write failed");
+        std::filesystem::remove(tempPath, error);
+    }
+
+    // the image is only published once the file is complete
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Writing.erase(hash);
+    if (stored)
+    {
+        m_Images.emplace(hash, path);
+    }
+
+    return hash;
+}
+
+bool AlbumArtCache::contains(uint64_t hash) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Images.find(hash) != m_Images.end();
+}
+
+std::string AlbumArtCache::getPath(uint64_t hash) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto iter = m_Images.find(hash);
+    return iter == m_Images.end() ? std::string() : iter->second;
+}
+
+}
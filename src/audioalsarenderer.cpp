@@ -15,13 +15,14 @@
 //    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "audioalsarenderer.h"
+#include "audiofade.h"
 #include "audio/audioframe.h"
 
 #include <stdexcept>
 #include <algorithm>
 #include <vector>
-#include <cassert>
 #include <cmath>
+#include <cstring>
 
 #include "utils/log.h"
 
@@ -31,6 +32,9 @@ using namespace utils;
 namespace audio
 {
 
+// audio that is left in the device when rewinding, the hardware keeps playing while we rewind
+static const double REWIND_SAFETY_MARGIN = 0.02;
+
 AlsaRenderer::AlsaRenderer(const std::string& deviceName)
 : m_pAudioDevice(nullptr)
 , m_bufferSize(0)
@@ -42,7 +46,9 @@ AlsaRenderer::AlsaRenderer(const std::string& deviceName)
 , m_frameSize(0)
 , m_lastPts(0.0)
 , m_supportPause(true)
+, m_preRoll(0.0)
 , m_buffer(1024 * 1024)
+, m_historyPos(0)
 {
     throwOnError(snd_pcm_open(&m_pAudioDevice, deviceName.c_str(), SND_PCM_STREAM_PLAYBACK, 0), "Error opening PCM device " + deviceName);
 }
@@ -92,16 +98,22 @@ void AlsaRenderer::setHardwareParams(snd_pcm_format_t format, uint32_t channels,
     }
 }
 
-void AlsaRenderer::setSoftwareParams()
+void AlsaRenderer::setSoftwareParams(uint32_t rate)
 {
     snd_pcm_sw_params_t* pSwParams = nullptr;
     snd_pcm_sw_params_alloca(&pSwParams);
 
     throwOnError(snd_pcm_sw_params_current(m_pAudioDevice, pSwParams), "Unable to determine current pSwParams for playback");
 
-    /* start the transfer when the buffer is almost full: */
+    /* start the transfer when the pre roll is buffered, or when the buffer is almost full: */
     /* (buffer_size / avail_min) * avail_min */
-    throwOnError(snd_pcm_sw_params_set_start_threshold(m_pAudioDevice, pSwParams, (m_bufferSize / m_periodSize) * m_periodSize), "Unable to set start threshold mode for playback");
+    snd_pcm_uframes_t startThreshold = (m_bufferSize / m_periodSize) * m_periodSize;
+    if (m_preRoll > 0.0)
+    {
+        startThreshold = std::clamp<snd_pcm_uframes_t>(static_cast<snd_pcm_uframes_t>(m_preRoll * rate), 1, m_bufferSize);
+    }
+
+    throwOnError(snd_pcm_sw_params_set_start_threshold(m_pAudioDevice, pSwParams, startThreshold), "Unable to set start threshold mode for playback");
     /* allow the transfer when at least period_size samples can be processed */
     throwOnError(snd_pcm_sw_params_set_avail_min(m_pAudioDevice, pSwParams, m_periodSize), "Unable to set avail min for playback");
     /* write the parameters to the playback device */
@@ -154,14 +166,20 @@ void AlsaRenderer::setFormat(const Format& format)
     }
 
     setHardwareParams(formatType, format.numChannels, format.rate);
-    setSoftwareParams();
+    setSoftwareParams(format.rate);
+    // only when the device is configured, a failed attempt is retried on the next call
+    m_format = format;
 
     //log::debug("Buffer size:", m_BufferSize, "Period size:", m_PeriodSize);
 
-    int bytesPerSample = snd_pcm_format_width(formatType) / 8;
+    // 24 bit samples occupy 32 bits in the buffer
+    int bytesPerSample = snd_pcm_format_physical_width(formatType) / 8;
     m_frameSize = format.numChannels * bytesPerSample;
-    
-    m_format = format;
+
+    m_Clock.setSampleRate(format.rate);
+
+    m_history.assign(snd_pcm_frames_to_bytes(m_pAudioDevice, m_bufferSize), 0);
+    m_historyPos = 0;
 }
 
 void AlsaRenderer::play()
@@ -181,6 +199,7 @@ void AlsaRenderer::play()
         log::debug("Alsa renderer prepared, starting playback");
         //throwOnError(snd_pcm_start(m_pAudioDevice), "Error starting playback");
         snd_pcm_start(m_pAudioDevice);
+        m_Clock.setRunning(true);
         break;
     }
     case SND_PCM_STATE_RUNNING:
@@ -225,6 +244,7 @@ void AlsaRenderer::pause()
         if (m_supportPause)
         {
             throwOnError(snd_pcm_pause(m_pAudioDevice, 1), "Error pausing playback");
+            m_Clock.setRunning(false);
         }
         else
         {
@@ -240,6 +260,7 @@ void AlsaRenderer::resume()
         if (getDeviceStatus() == SND_PCM_STATE_PAUSED)
         {
             throwOnError(snd_pcm_pause(m_pAudioDevice, 0), "Error resuming playback");
+            m_Clock.setRunning(true);
         }
     }
     else
@@ -257,6 +278,7 @@ void AlsaRenderer::stop(bool drain)
     {
         m_buffer.clear();
         m_lastPts = 0.0;
+        m_historyPos = 0;
         
         if (drain)
         {
@@ -267,6 +289,8 @@ void AlsaRenderer::stop(bool drain)
             throwOnError(snd_pcm_drop(m_pAudioDevice), "Error stopping playback");
         }
     }
+
+    m_Clock.reset();
 }
 
 void AlsaRenderer::setVolume(int32_t volume)
@@ -309,24 +333,38 @@ snd_pcm_state_t AlsaRenderer::getDeviceStatus()
     return state;
 }
 
-bool AlsaRenderer::hasBufferSpace(uint32_t dataSize)
+void AlsaRenderer::setPreRoll(double duration)
 {
-    if (getDeviceStatus() == SND_PCM_STATE_PAUSED)
+    m_preRoll = duration;
+    if (m_bufferSize > 0)
     {
-        return false;
+        setSoftwareParams(m_format.rate);
     }
+}
 
+bool AlsaRenderer::hasBufferSpace(uint32_t dataSize)
+{
+    // audio can also be queued while paused, the playback rebuffers that way
     return m_buffer.bytesFree() >= static_cast<uint32_t>(dataSize);
 }
 
 double AlsaRenderer::getBufferDuration()
 {
+    if (m_format.rate == 0)
+    {
+        return 0.0;
+    }
+
     snd_pcm_sframes_t available = snd_pcm_avail_update(m_pAudioDevice);
-    uint32_t availableBytes = snd_pcm_frames_to_bytes(m_pAudioDevice, available);
-    uint32_t bufferSize = snd_pcm_frames_to_bytes(m_pAudioDevice, m_bufferSize);
+    if (available < 0)
+    {
+        // xrun, nothing is queued
+        return 0.0;
+    }
 
-    auto bytesInBuffer = bufferSize - availableBytes;
-    return static_cast<double>(bytesInBuffer / (m_format.bits / 8.0)) / m_format.rate;
+    // the frames in the device plus the data that is still waiting in the intermediate buffer
+    auto framesInBuffer = m_bufferSize - std::min(static_cast<snd_pcm_uframes_t>(available), m_bufferSize);
+    return (static_cast<double>(framesInBuffer) / m_format.rate) + (m_buffer.bytesUsed() / static_cast<double>(m_frameSize * m_format.rate));
 }
 
 bool AlsaRenderer::isPlaying()
@@ -340,21 +378,24 @@ void AlsaRenderer::flushBuffers()
     if (deviceStatus == SND_PCM_STATE_XRUN)
     {
         log::debug("Recover from xrun");
+        m_Metrics.underruns.increment();
         snd_pcm_prepare(m_pAudioDevice);
         snd_pcm_start(m_pAudioDevice);
     }
 
-    snd_pcm_sframes_t available = snd_pcm_avail_update(m_pAudioDevice);
+    snd_pcm_sframes_t available = std::max<snd_pcm_sframes_t>(0, snd_pcm_avail_update(m_pAudioDevice));
     uint32_t availableBytes = snd_pcm_frames_to_bytes(m_pAudioDevice, available);
 
     //log::debug("Alsa av: %d Buf av: %d (%d - %d)", availableBytes, m_Buffer.bytesUsed(), m_PeriodSize, m_BufferSize);
 
-    if (availableBytes != 0 && m_buffer.bytesUsed() > availableBytes)
+    // move as much as fits into the device, data only stays in the intermediate buffer when the device is full
+    if (availableBytes != 0 && m_buffer.bytesUsed() > 0)
     {
-        uint32_t size = availableBytes;
+        uint32_t size = std::min(m_buffer.bytesUsed(), availableBytes);
         uint8_t* pData = m_buffer.getData(size);
-        
-        applyVolume(pData, size);
+
+        addToHistory(pData, size);
+        applyVolume(pData, size, m_format, m_volume);
 
         snd_pcm_sframes_t dataFrames = snd_pcm_bytes_to_frames(m_pAudioDevice, size);
 
@@ -366,11 +407,18 @@ void AlsaRenderer::flushBuffers()
         //log::debug("Write frame: alsaAvB: %d AudioBufAvB %d %d", availableBytes, size, m_Buffer.bytesUsed());
         snd_pcm_sframes_t status = snd_pcm_writei(m_pAudioDevice, pData, dataFrames);
 
+        if (!m_history.empty())
+        {
+            // the frames that were not written are not in the device
+            m_historyPos -= snd_pcm_frames_to_bytes(m_pAudioDevice, dataFrames - std::max<snd_pcm_sframes_t>(0, status));
+        }
+
         if (status < 0)
         {
             if (status == -EPIPE)
             {
                 log::warn("Alsa: Failed to write frame data: underrun occured (%s) %d", snd_strerror(status), m_buffer.bytesUsed());
+                m_Metrics.underruns.increment();
                 snd_pcm_prepare(m_pAudioDevice);
                 snd_pcm_start(m_pAudioDevice);
             }
@@ -400,6 +448,11 @@ void AlsaRenderer::flushBuffers()
 
         flushBuffers();
     }
+    else
+    {
+        // all data that fits is written, sample the device position for the clock
+        updateClock();
+    }
 }
 
 void AlsaRenderer::queueFrame(const Frame& frame)
@@ -410,47 +463,101 @@ void AlsaRenderer::queueFrame(const Frame& frame)
     }
 
     m_buffer.writeData(frame.getFrameData(), frame.getDataSize());
-    m_lastPts = frame.getPts();
+    m_Metrics.bytesQueued.increment(frame.getDataSize());
+    // pts of the end of the queued data
+    m_lastPts = frame.getPts() + (frame.getDataSize() / static_cast<double>(m_frameSize * m_format.rate));
+    m_Clock.setLimit(m_lastPts);
 
     flushBuffers();
 }
 
-void AlsaRenderer::applyVolume(uint8_t* pData, uint32_t dataSize)
+bool AlsaRenderer::flushTail(double fadeDuration)
 {
-    if (m_volume == 100)
+    if (m_frameSize == 0 || getDeviceStatus() != SND_PCM_STATE_RUNNING)
     {
-        return;
+        return false;
     }
 
-    if (m_format.bits == 16)
+    uint32_t bufferedBytes = m_buffer.bytesUsed();
+    uint64_t fadeBytes = static_cast<uint64_t>(fadeDuration * m_format.rate) * m_frameSize;
+
+    // take back the audio from the device that is not about to be played
+    snd_pcm_sframes_t rewindable = snd_pcm_rewindable(m_pAudioDevice);
+    snd_pcm_sframes_t margin = static_cast<snd_pcm_sframes_t>(REWIND_SAFETY_MARGIN * m_format.rate);
+    snd_pcm_sframes_t rewound = 0;
+    if (rewindable > margin)
     {
-        int scaleFactor = (m_volume * 256) / 100;
+        rewound = std::max<snd_pcm_sframes_t>(0, snd_pcm_rewind(m_pAudioDevice, rewindable - margin));
+    }
 
-        for (uint32_t i = 0; i < dataSize; i+=2)
-        {
-            short* pSample = reinterpret_cast<short*>(&pData[i]);
-            int sample = ((*pSample) * scaleFactor + 128) >> 8;
-            *pSample = std::clamp(sample, -32768, 32767);
-        }
+    uint64_t rewoundBytes = std::min<uint64_t>(snd_pcm_frames_to_bytes(m_pAudioDevice, rewound), m_historyPos);
+    m_historyPos -= rewoundBytes;
+
+    // the audio that follows the audio that stays in the device: the rewound audio and then the buffered audio
+    std::vector<uint8_t> fade;
+    fade.reserve(fadeBytes);
+
+    uint64_t offset = 0;
+    while (fade.size() < fadeBytes && offset < rewoundBytes)
+    {
+        uint64_t start = (m_historyPos + offset) % m_history.size();
+        uint64_t size = std::min({fadeBytes - fade.size(), rewoundBytes - offset, m_history.size() - start});
+        fade.insert(fade.end(), m_history.begin() + start, m_history.begin() + start + size);
+        offset += size;
     }
-    else if (m_format.bits == 32)
+
+    while (fade.size() < fadeBytes && m_buffer.bytesUsed() > 0)
     {
-        float scaleFactor = m_volume / 100.0;
+        uint32_t size = static_cast<uint32_t>(fadeBytes - fade.size());
+        uint8_t* pData = m_buffer.getData(size);
+        fade.insert(fade.end(), pData, pData + size);
+    }
 
-        for (uint32_t i = 0; i < dataSize; i+=4)
-        {
-            float* pSample = reinterpret_cast<float*>(pData[i]);
-            *pSample = static_cast<float>(*pSample * scaleFactor);
-        }
+    fade.resize(fade.size() - (fade.size() % m_frameSize));
+    applyFade(fade.data(), static_cast<uint32_t>(fade.size()), m_format, 0, static_cast<uint32_t>(fade.size() / m_frameSize), FadeDirection::Out);
+
+    m_buffer.clear();
+    m_buffer.writeData(fade.data(), static_cast<uint32_t>(fade.size()));
+
+    auto droppedBytes = rewoundBytes + bufferedBytes - fade.size();
+    m_lastPts -= droppedBytes / static_cast<double>(m_frameSize * m_format.rate);
+    m_Clock.setLimit(m_lastPts);
+
+    flushBuffers();
+    return true;
+}
+
+void AlsaRenderer::addToHistory(const uint8_t* pData, uint32_t dataSize)
+{
+    if (m_history.empty())
+    {
+        return;
     }
-    else
+
+    while (dataSize > 0)
     {
-        assert(false); //implement volume scaling for this bitsize
+        uint64_t start = m_historyPos % m_history.size();
+        uint32_t size = static_cast<uint32_t>(std::min<uint64_t>(dataSize, m_history.size() - start));
+        memcpy(m_history.data() + start, pData, size);
+
+        pData        += size;
+        dataSize     -= size;
+        m_historyPos += size;
     }
 }
 
 double AlsaRenderer::getCurrentPts()
 {
+    return updateClock();
+}
+
+double AlsaRenderer::updateClock()
+{
+    if (m_frameSize == 0)
+    {
+        return 0.0;
+    }
+
     double bufferDelay = 0.0;
 
     snd_pcm_sframes_t frames;
@@ -461,7 +568,9 @@ double AlsaRenderer::getCurrentPts()
     
     bufferDelay += m_buffer.bytesUsed() / static_cast<double>(m_frameSize * m_format.rate);
 
-    return std::max(0.0, m_lastPts - bufferDelay);
+    double pts = std::max(0.0, m_lastPts - bufferDelay);
+    m_Clock.update(pts, getDeviceStatus() == SND_PCM_STATE_RUNNING);
+    return pts;
 }
 
 void AlsaRenderer::throwOnError(int err, const string& message)
@@ -24,6 +24,7 @@
 #include <alsa/asoundlib.h>
 #include <string>
 #include <deque>
+#include <vector>
 
 namespace audio
 {
@@ -49,6 +50,8 @@ public:
     double getBufferDuration() override;
     void flushBuffers();
     void queueFrame(const Frame& frame);
+    bool flushTail(double fadeDuration) override;
+    void setPreRoll(double duration) override;
 
     double getCurrentPts();
 
@@ -59,8 +62,9 @@ private:
     snd_pcm_state_t getDeviceStatus();
     std::string getDeviceStatusString(snd_pcm_state_t status);
     void setHardwareParams(snd_pcm_format_t format, uint32_t channels, uint32_t rate);
-    void setSoftwareParams();
-    void applyVolume(uint8_t* pData, uint32_t dataSize);
+    void setSoftwareParams(uint32_t rate);
+    void addToHistory(const uint8_t* pData, uint32_t dataSize);
+    double updateClock();
 
     snd_pcm_t*              m_pAudioDevice;
     snd_pcm_uframes_t       m_bufferSize;
@@ -77,8 +81,14 @@ private:
     double                  m_lastPts;
 
     bool                    m_supportPause;
+    double                  m_preRoll;
 
     Buffer                  m_buffer;
+
+    // copy of the audio in the device buffer (before volume is applied),
+    // needed to fade out the audio that is taken back from the device
+    std::vector<uint8_t>    m_history;
+    uint64_t                m_historyPos;
 };
 
 }
@@ -0,0 +1,251 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audiocachingreader.h"
+
+#include "audio/audiostreamcache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace audio
+{
+
+static const uint64_t NO_CHUNK = std::numeric_limits<uint64_t>::max();
+
+CachingReader::CachingReader(std::shared_ptr<StreamCache> cache, std::unique_ptr<utils::IReader> source)
+: m_Cache(std::move(cache))
+, m_Source(std::move(source))
+, m_SourceOpen(false)
+, m_Acquired(false)
+, m_Position(0)
+, m_ContentLength(0)
+, m_Eof(false)
+, m_ChunkIndex(NO_CHUNK)
+{
+}
+
+CachingReader::~CachingReader()
+{
+    close();
+}
+
+void CachingReader::open(const std::string& uri)
+{
+    close();
+
+    m_Uri = uri;
+    m_ContentLength = m_Cache->acquire(uri);
+    m_Acquired = true;
+
+    if (m_ContentLength == 0)
+    {
+        // first time this track is played, the source provides the size
+        openSource();
+        m_ContentLength = m_Source->getContentLength();
+        if (m_ContentLength > 0)
+        {
+            m_Cache->setContentLength(uri, m_ContentLength);
+        }
+    }
+}
+
+void CachingReader::close()
+{
+    if (m_SourceOpen)
+    {
+        m_Source->close();
+        m_SourceOpen = false;
+    }
+
+    if (m_Acquired)
+    {
+        m_Cache->release(m_Uri);
+        m_Acquired = false;
+    }
+
+    m_Position = 0;
+    m_ContentLength = 0;
+    m_Eof = false;
+    m_Chunk.clear();
+    m_ChunkIndex = NO_CHUNK;
+}
+
+uint64_t CachingReader::getContentLength()
+{
+    return m_ContentLength;
+}
+
+uint64_t CachingReader::currentPosition()
+{
+    return m_Position;
+}
+
+bool CachingReader::eof()
+{
+    if (m_ContentLength == 0)
+    {
+        return m_Eof;
+    }
+
+    return m_Eof || m_Position >= m_ContentLength;
+}
+
+std::string CachingReader::uri()
+{
+    return m_Uri;
+}
+
+void CachingReader::seekAbsolute(uint64_t position)
+{
+    m_Position = position;
+    m_Eof = false;
+}
+
+void CachingReader::seekRelative(uint64_t offset)
+{
+    seekAbsolute(m_Position + offset);
+}
+
+uint64_t CachingReader::read(uint8_t* pData, uint64_t size)
+{
+    if (m_ContentLength == 0)
+    {
+        // unknown size, the data can not be cached
+        m_Source->seekAbsolute(m_Position);
+        auto bytesRead = m_Source->read(pData, size);
+        m_Position += bytesRead;
+        m_Eof = m_Source->eof();
+        return bytesRead;
+    }
+
+    uint64_t bytesRead = 0;
+    while (bytesRead < size && m_Position < m_ContentLength)
+    {
+        auto index = m_Position / StreamCache::ChunkSize;
+        if (!loadChunk(index))
+        {
+            break;
+        }
+
+        auto chunkOffset = m_Position - index * StreamCache::ChunkSize;
+        if (chunkOffset >= m_Chunk.size())
+        {
+            break;
+        }
+
+        auto count = std::min<uint64_t>(size - bytesRead, m_Chunk.size() - chunkOffset);
+        memcpy(pData + bytesRead, m_Chunk.data() + chunkOffset, static_cast<size_t>(count));
+        bytesRead += count;
+        m_Position += count;
+    }
+
+    if (bytesRead < size)
+    {
+        m_Eof = true;
+    }
+
+    return bytesRead;
+}
+
+std::vector<uint8_t> CachingReader::readAllData()
+{
+    std::vector<uint8_t> data;
+    seekAbsolute(0);
+
+    if (m_ContentLength == 0)
+    {
+        openSource();
+        return m_Source->readAllData();
+    }
+
+    data.resize(static_cast<size_t>(m_ContentLength));
+    data.resize(static_cast<size_t>(read(data.data(), data.size())));
+    return data;
+}
+
+void CachingReader::clearErrors()
+{
+    m_Eof = false;
+    if (m_SourceOpen)
+    {
+        m_Source->clearErrors();
+    }
+}
+
+bool CachingReader::loadChunk(uint64_t index)
+{
+    if (index == m_ChunkIndex)
+    {
+        return !m_Chunk.empty();
+    }
+
+    m_ChunkIndex = NO_CHUNK;
+    if (m_Cache->readChunk(m_Uri, index, m_Chunk))
+    {
+        m_ChunkIndex = index;
+        return true;
+    }
+
+    openSource();
+
+    auto offset = index * StreamCache::ChunkSize;
+    if (offset >= m_ContentLength)
+    {
+        return false;
+    }
+
+    auto size = std::min(StreamCache::ChunkSize, m_ContentLength - offset);
+    m_Chunk.resize(static_cast<size_t>(size));
+
+    m_Source->clearErrors();
+    m_Source->seekAbsolute(offset);
+    auto bytesRead = m_Source->read(m_Chunk.data(), size);
+    m_Chunk.resize(static_cast<size_t>(bytesRead));
+    if (bytesRead == size)
+    {
+        m_Cache->writeChunk(m_Uri, index, m_Chunk.data(), size);
+    }
+
+    m_ChunkIndex = index;
+    return bytesRead > 0;
+}
+
+void CachingReader::openSource()
+{
+    if (m_SourceOpen)
+    {
+        return;
+    }
+
+    m_Source->open(m_Uri);
+    m_SourceOpen = true;
+
+    auto length = m_Source->getContentLength();
+    if (m_ContentLength > 0 && length > 0 && length != m_ContentLength)
+    {
+        // the remote file changed since it was cached
+        m_Cache->setContentLength(m_Uri, length);
+        m_ContentLength = length;
+        m_Chunk.clear();
+        m_ChunkIndex = NO_CHUNK;
+    }
+}
+
+}
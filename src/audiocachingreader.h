@@ -0,0 +1,76 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_CACHING_READER_H
+#define AUDIO_CACHING_READER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/readerinterface.h"
+
+namespace audio
+{
+
+class StreamCache;
+
+// Reader that serves the data of a remote uri from the stream cache
+// Chunks that are not cached are read from the source reader and added to the cache,
+// the source is only opened when a missing chunk is needed.
+class CachingReader : public utils::IReader
+{
+public:
+    CachingReader(std::shared_ptr<StreamCache> cache, std::unique_ptr<utils::IReader> source);
+    ~CachingReader();
+
+    void open(const std::string& uri) override;
+    void close() override;
+
+    uint64_t getContentLength() override;
+    uint64_t currentPosition() override;
+    bool eof() override;
+    std::string uri() override;
+
+    void seekAbsolute(uint64_t position) override;
+    void seekRelative(uint64_t offset) override;
+    uint64_t read(uint8_t* pData, uint64_t size) override;
+    std::vector<uint8_t> readAllData() override;
+    void clearErrors() override;
+
+private:
+    bool loadChunk(uint64_t index);
+    void openSource();
+
+    std::shared_ptr<StreamCache>    m_Cache;
+    std::unique_ptr<utils::IReader> m_Source;
+    bool                            m_SourceOpen;
+    bool                            m_Acquired;
+
+    std::string                     m_Uri;
+    uint64_t                        m_Position;
+    uint64_t                        m_ContentLength;
+    bool                            m_Eof;
+
+    // the chunk that is currently being read
+    std::vector<uint8_t>            m_Chunk;
+    uint64_t                        m_ChunkIndex;
+};
+
+}
+
+#endif
@@ -40,6 +40,8 @@ using namespace utils;
 namespace audio
 {
 
+std::atomic<bool> DecoderFactory::s_MemoryMappedFiles(false);
+
 IDecoder* DecoderFactory::create(const std::string& filepath)
 {
     std::string extension = fileops::getFileExtension(filepath);
@@ -69,4 +71,14 @@ IDecoder* DecoderFactory::create(const std::string& filepath)
 #endif
 }
 
+void DecoderFactory::setMemoryMappedFiles(bool enabled)
+{
+    s_MemoryMappedFiles.store(enabled, std::memory_order_relaxed);
+}
+
+bool DecoderFactory::useMemoryMappedFiles()
+{
+    return s_MemoryMappedFiles.load(std::memory_order_relaxed);
+}
+
 } // namespace audio
@@ -0,0 +1,119 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audiofade.h"
+#include "audio/audioformat.h"
+
+#include <algorithm>
+
+namespace audio
+{
+
+template <typename SampleType>
+static void fadeSamples(SampleType* pSamples, uint32_t numFrames, uint32_t numChannels, uint32_t startFrame, uint32_t rampFrames, FadeDirection direction)
+{
+    for (uint32_t frame = 0; frame < numFrames; ++frame)
+    {
+        uint32_t position = startFrame + frame;
+        if (position >= rampFrames && direction == FadeDirection::In)
+        {
+            break;
+        }
+
+        double gain = std::min(1.0, static_cast<double>(position) / rampFrames);
+        if (direction == FadeDirection::Out)
+        {
+            gain = 1.0 - gain;
+        }
+
+        for (uint32_t channel = 0; channel < numChannels; ++channel)
+        {
+            auto& sample = pSamples[frame * numChannels + channel];
+            sample = static_cast<SampleType>(sample * gain);
+        }
+    }
+}
+
+void applyFade(uint8_t* pData, uint32_t dataSize, const Format& format, uint32_t startFrame, uint32_t rampFrames, FadeDirection direction)
+{
+    if (rampFrames == 0 || format.numChannels == 0)
+    {
+        return;
+    }
+
+    if (format.floatingPoint && format.bits == 32)
+    {
+        auto numFrames = dataSize / (sizeof(float) * format.numChannels);
+        fadeSamples(reinterpret_cast<float*>(pData), static_cast<uint32_t>(numFrames), format.numChannels, startFrame, rampFrames, direction);
+    }
+    else if (format.bits == 16)
+    {
+        auto numFrames = dataSize / (sizeof(int16_t) * format.numChannels);
+        fadeSamples(reinterpret_cast<int16_t*>(pData), static_cast<uint32_t>(numFrames), format.numChannels, startFrame, rampFrames, direction);
+    }
+    else if (format.bits == 24 || format.bits == 32)
+    {
+        // 24 bit samples are stored in 32 bit containers
+        auto numFrames = dataSize / (sizeof(int32_t) * format.numChannels);
+        fadeSamples(reinterpret_cast<int32_t*>(pData), static_cast<uint32_t>(numFrames), format.numChannels, startFrame, rampFrames, direction);
+    }
+}
+
+void applyVolume(uint8_t* pData, uint32_t dataSize, const Format& format, int32_t volume)
+{
+    if (volume == 100)
+    {
+        return;
+    }
+
+    if (format.floatingPoint && format.bits == 32)
+    {
+        float scaleFactor = volume / 100.f;
+        auto* pSamples = reinterpret_cast<float*>(pData);
+
+        for (uint32_t i = 0; i < dataSize / sizeof(float); ++i)
+        {
+            pSamples[i] *= scaleFactor;
+        }
+    }
+    else if (format.bits == 16)
+    {
+        int32_t scaleFactor = (volume * 256) / 100;
+        auto* pSamples = reinterpret_cast<int16_t*>(pData);
+
+        for (uint32_t i = 0; i < dataSize / sizeof(int16_t); ++i)
+        {
+            int32_t sample = (pSamples[i] * scaleFactor + 128) >> 8;
+            pSamples[i] = static_cast<int16_t>(std::clamp(sample, -32768, 32767));
+        }
+    }
+    else if (format.bits == 24 || format.bits == 32)
+    {
+        // 24 bit samples are stored in the low bits of the container and are clamped to 24 bits
+        int64_t maxSample = (int64_t(1) << (format.bits - 1)) - 1;
+        int64_t scaleFactor = (static_cast<int64_t>(volume) << 16) / 100;
+        auto* pSamples = reinterpret_cast<int32_t*>(pData);
+
+        for (uint32_t i = 0; i < dataSize / sizeof(int32_t); ++i)
+        {
+            int64_t sample = (pSamples[i] * scaleFactor + (1 << 15)) >> 16;
+            pSamples[i] = static_cast<int32_t>(std::clamp<int64_t>(sample, -maxSample - 1, maxSample));
+        }
+    }
+}
+
+}
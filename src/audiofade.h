@@ -0,0 +1,46 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_FADE_H
+#define AUDIO_FADE_H
+
+#include <cinttypes>
+
+namespace audio
+{
+
+struct Format;
+
+enum class FadeDirection
+{
+    In,
+    Out
+};
+
+// Applies a linear gain ramp of rampFrames sample frames, startFrame is the position
+// of the first frame of the data within the ramp so a ramp can span several buffers.
+// Frames after the ramp are left untouched when fading in and silenced when fading out.
+void applyFade(uint8_t* pData, uint32_t dataSize, const Format& format, uint32_t startFrame, uint32_t rampFrames, FadeDirection direction);
+
+// Scales the samples in place, volume is a percentage (100 leaves the data untouched)
+// Supports 32 bit float and 16, 24 (in 32 bit containers) and 32 bit integer samples,
+// other formats are left untouched.
+void applyVolume(uint8_t* pData, uint32_t dataSize, const Format& format, int32_t volume);
+
+}
+
+#endif
@@ -265,6 +265,7 @@ void FFmpegDecoder::mergeAudioPlanes(Frame& frame)
 
 bool FFmpegDecoder::decodeAudioFrame(Frame& frame)
 {
+    ScopedTimer timer(m_Metrics.decodeTime);
     bool frameDecoded = false;
 
     AVPacket packet;
@@ -332,11 +333,13 @@ bool FFmpegDecoder::decodeAudioFrame(Frame& frame)
 
             frame.setPts(m_AudioClock);
             frameDecoded = true;
+            m_Metrics.framesDecoded.increment();
         }
     }
     catch (std::exception& e)
     {
         log::error(e.what());
+        m_Metrics.decodeErrors.increment();
     }
 
     av_packet_unref(&packet);
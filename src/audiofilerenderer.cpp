@@ -0,0 +1,306 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "audiofilerenderer.h"
+
+#include "audio/audioframe.h"
+#include "utils/fileoperations.h"
+#include "utils/log.h"
+#include "utils/stringoperations.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace utils;
+
+namespace audio
+{
+
+// audio is collected in memory and written in large blocks
+static const size_t BUFFER_SIZE = 4 * 1024 * 1024;
+
+// RIFF header + JUNK chunk (placeholder for the RF64 ds64 chunk) + fmt chunk + data chunk header
+static const uint32_t JUNK_SIZE   = 28;
+static const uint32_t HEADER_SIZE = 12 + (8 + JUNK_SIZE) + (8 + 16) + 8;
+
+static void writeLE(std::ofstream& file, uint64_t value, int numBytes)
+{
+    char data[8];
+    for (int i = 0; i < numBytes; ++i)
+    {
+        data[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+
+    file.write(data, numBytes);
+}
+
+FileRenderer::FileRenderer(const std::string& path)
+: m_Path(path)
+, m_WaveHeader(false)
+, m_HeaderWritten(false)
+, m_DataBytes(0)
+, m_Volume(100)
+, m_Muted(false)
+, m_Playing(false)
+, m_LastPts(0.0)
+{
+    auto extension = fileops::getFileExtension(path);
+    str::lowercase_in_place(extension);
+    m_WaveHeader = extension == "wav";
+
+    m_File.open(path, std::ios_base::binary | std::ios_base::trunc);
+    if (!m_File.is_open())
+    {
+        throw std::logic_error("FileRenderer: failed to open output file: " + path);
+    }
+
+    m_Buffer.reserve(BUFFER_SIZE);
+}
+
+FileRenderer::~FileRenderer()
+{
+    try
+    {
+        stop(true);
+    }
+    catch (std::exception& e)
+    {
+        log::error("FileRenderer: failed to finalize {}: {}", m_Path, e.what());
+    }
+}
+
+void FileRenderer::setFormat(const Format& format)
+{
+    bool sameFormat = format.bits == m_Format.bits &&
+                      format.rate == m_Format.rate &&
+                      format.numChannels == m_Format.numChannels &&
+                      format.floatingPoint == m_Format.floatingPoint;
+
+    if (m_DataBytes > 0 && !sameFormat)
+    {
+        // a single file can only contain one format
+        throw std::logic_error(fmt::format("FileRenderer: format change after data was written to {} ({} bits {}Hz {} channels)",
+                                           m_Path, format.bits, format.rate, format.numChannels));
+    }
+
+    m_Format = format;
+    m_Clock.setSampleRate(format.rate);
+}
+
+void FileRenderer::play()
+{
+    m_Playing = true;
+}
+
+void FileRenderer::pause()
+{
+    m_Playing = false;
+}
+
+void FileRenderer::resume()
+{
+    m_Playing = true;
+}
+
+void FileRenderer::stop(bool /*drain*/)
+{
+    // everything that was queued is written, so the file is valid after every stop
+    m_Playing = false;
+    writeBuffer();
+
+    if (m_HeaderWritten)
+    {
+        updateWaveHeader();
+    }
+
+    m_File.flush();
+}
+
+void FileRenderer::setVolume(int32_t volume)
+{
+    // the output is bit exact, volume is not applied
+    m_Volume = std::clamp(volume, 0, 100);
+}
+
+int32_t FileRenderer::getVolume()
+{
+    return m_Volume;
+}
+
+void FileRenderer::setMute(bool enabled)
+{
+    m_Muted = enabled;
+}
+
+bool FileRenderer::getMute()
+{
+    return m_Muted;
+}
+
+bool FileRenderer::isPlaying()
+{
+    return m_Playing;
+}
+
+bool FileRenderer::hasBufferSpace(uint32_t /*dataSize*/)
+{
+    return true;
+}
+
+double FileRenderer::getBufferDuration()
+{
+    return 0.0;
+}
+
+void FileRenderer::flushBuffers()
+{
+}
+
+void FileRenderer::queueFrame(const Frame& frame)
+{
+    if (m_Format.rate == 0)
+    {
+        throw std::logic_error("FileRenderer: no format set before queueing audio");
+    }
+
+    if (m_WaveHeader && !m_HeaderWritten)
+    {
+        writeWaveHeader();
+    }
+
+    m_Buffer.insert(m_Buffer.end(), frame.getFrameData(), frame.getFrameData() + frame.getDataSize());
+    m_Metrics.bytesQueued.increment(frame.getDataSize());
+    m_DataBytes += frame.getDataSize();
+
+    if (m_Buffer.size() >= BUFFER_SIZE)
+    {
+        writeBuffer();
+    }
+
+    uint32_t bytesPerSecond = m_Format.rate * m_Format.numChannels * (m_Format.bits / 8);
+    m_LastPts = frame.getPts() + (frame.getDataSize() / static_cast<double>(bytesPerSecond));
+    m_Clock.setLimit(m_LastPts);
+    m_Clock.update(m_LastPts, false);
+}
+
+double FileRenderer::getCurrentPts()
+{
+    return m_LastPts;
+}
+
+void FileRenderer::writeWaveHeader()
+{
+    uint16_t blockAlign = static_cast<uint16_t>(m_Format.numChannels * (m_Format.bits / 8));
+
+    m_File.seekp(0, std::ios_base::beg);
+    m_File.write("RIFF", 4);
+    writeLE(m_File, 0, 4);                                  // riff size, updated afterwards
+    m_File.write("WAVE", 4);
+
+    m_File.write("JUNK", 4);
+    writeLE(m_File, JUNK_SIZE, 4);
+    writeLE(m_File, 0, 8);
+    writeLE(m_File, 0, 8);
+    writeLE(m_File, 0, 8);
+    writeLE(m_File, 0, 4);
+
+    m_File.write("fmt ", 4);
+    writeLE(m_File, 16, 4);
+    writeLE(m_File, m_Format.floatingPoint ? 3 : 1, 2);     // WAVE_FORMAT_IEEE_FLOAT or WAVE_FORMAT_PCM
+    writeLE(m_File, m_Format.numChannels, 2);
+    writeLE(m_File, m_Format.rate, 4);
+    writeLE(m_File, m_Format.rate * blockAlign, 4);
+    writeLE(m_File, blockAlign, 2);
+    writeLE(m_File, m_Format.bits, 2);
+
+    m_File.write("data", 4);
+    writeLE(m_File, 0, 4);                                  // data size, updated afterwards
+
+    if (!m_File)
+    {
+        throw std::logic_error("FileRenderer: failed to write wave header to " + m_Path);
+    }
+
+    m_HeaderWritten = true;
+}
+
+void FileRenderer::updateWaveHeader()
+{
+    // the riff chunks need to be word aligned
+    uint64_t padding  = m_DataBytes % 2;
+    uint64_t riffSize = HEADER_SIZE - 8 + m_DataBytes + padding;
+
+    if (padding)
+    {
+        // overwritten when more data is written
+        m_File.seekp(HEADER_SIZE + m_DataBytes, std::ios_base::beg);
+        writeLE(m_File, 0, 1);
+    }
+
+    m_File.seekp(0, std::ios_base::beg);
+    if (riffSize <= 0xFFFFFFFF)
+    {
+        m_File.write("RIFF", 4);
+        writeLE(m_File, riffSize, 4);
+
+        m_File.seekp(HEADER_SIZE - 4, std::ios_base::beg);
+        writeLE(m_File, m_DataBytes, 4);
+    }
+    else
+    {
+        // too large for riff, turn the JUNK chunk into a ds64 chunk
+        uint32_t blockAlign = m_Format.numChannels * (m_Format.bits / 8);
+
+        m_File.write("RF64", 4);
+        writeLE(m_File, 0xFFFFFFFF, 4);
+        m_File.write("WAVE", 4);
+        m_File.write("ds64", 4);
+        writeLE(m_File, JUNK_SIZE, 4);
+        writeLE(m_File, riffSize, 8);
+        writeLE(m_File, m_DataBytes, 8);
+        writeLE(m_File, m_DataBytes / blockAlign, 8);
+        writeLE(m_File, 0, 4);                              // no table entries
+
+        m_File.seekp(HEADER_SIZE - 4, std::ios_base::beg);
+        writeLE(m_File, 0xFFFFFFFF, 4);
+    }
+
+    if (!m_File)
+    {
+        throw std::logic_error("FileRenderer: failed to update wave header of " + m_Path);
+    }
+}
+
+void FileRenderer::writeBuffer()
+{
+    if (m_Buffer.empty())
+    {
+        return;
+    }
+
+    // the header may have been updated in the meantime
+    uint64_t dataOffset = m_HeaderWritten ? HEADER_SIZE : 0;
+    m_File.seekp(static_cast<std::streamoff>(dataOffset + m_DataBytes - m_Buffer.size()), std::ios_base::beg);
+    m_File.write(reinterpret_cast<const char*>(m_Buffer.data()), static_cast<std::streamsize>(m_Buffer.size()));
+    if (!m_File)
+    {
+        throw std::logic_error("FileRenderer: failed to write to " + m_Path);
+    }
+
+    m_Buffer.clear();
+}
+
+}
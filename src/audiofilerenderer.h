@@ -0,0 +1,80 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef FILE_RENDERER_H
+#define FILE_RENDERER_H
+
+#include "audio/audioformat.h"
+#include "audio/audiorenderer.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace audio
+{
+
+// Writes the audio to a file as fast as it is queued, intended for offline decoding
+// Files with a .wav extension get a wave header (RF64 when the data exceeds 4GB),
+// all other files contain raw interleaved pcm data
+class FileRenderer : public IRenderer
+{
+public:
+    FileRenderer(const std::string& path);
+    ~FileRenderer();
+
+    void setFormat(const Format& format) override;
+
+    void play() override;
+    void pause() override;
+    void resume() override;
+    void stop(bool drain) override;
+    void setVolume(int32_t volume) override;
+    int32_t getVolume() override;
+    void setMute(bool enabled) override;
+    bool getMute() override;
+
+    bool isPlaying() override;
+
+    bool hasBufferSpace(uint32_t dataSize) override;
+    double getBufferDuration() override;
+    void flushBuffers() override;
+    void queueFrame(const Frame& frame) override;
+
+    double getCurrentPts() override;
+
+private:
+    void writeWaveHeader();
+    void updateWaveHeader();
+    void writeBuffer();
+
+    std::string             m_Path;
+    std::ofstream           m_File;
+    bool                    m_WaveHeader;
+    bool                    m_HeaderWritten;
+    Format                  m_Format;
+    uint64_t                m_DataBytes;
+    std::vector<uint8_t>    m_Buffer;
+
+    int32_t                 m_Volume;
+    bool                    m_Muted;
+    bool                    m_Playing;
+    double                  m_LastPts;
+};
+
+}
+
+#endif
@@ -22,7 +22,7 @@
 
 #include "audio/audioframe.h"
 #include "utils/log.h"
-#include "utils/readerfactory.h"
+#include "audioreaderfactory.h"
 
 using namespace utils;
 
@@ -33,7 +33,7 @@ FlacDecoder::FlacDecoder(const std::string& uri)
 : IDecoder(uri)
 , m_BytesPerFrame(0)
 , m_NumSamples(0)
-, m_Reader(ReaderFactory::createBuffered(uri, 128*1024))
+, m_Reader(createReader(uri, 128*1024))
 {
     m_Reader->open(uri);
 
@@ -105,9 +105,12 @@ void FlacDecoder::seekRelative(double offset)
 
 bool FlacDecoder::decodeAudioFrame(Frame& frame)
 {
+    ScopedTimer timer(m_Metrics.decodeTime);
+
     if (!process_single())
     {
         log::error("Flac decode error");
+        m_Metrics.decodeErrors.increment();
         return false;
     }
 
@@ -125,6 +128,7 @@ bool FlacDecoder::decodeAudioFrame(Frame& frame)
     frame.setFrameData(&m_AudioBuffer[0]);
     frame.setDataSize(m_AudioBuffer.size());
     frame.setPts(m_AudioClock);
+    m_Metrics.framesDecoded.increment();
     return true;
 }
 
@@ -0,0 +1,42 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_HASH_H
+#define AUDIO_HASH_H
+
+#include <cinttypes>
+#include <cstddef>
+
+namespace audio
+{
+
+// 64 bit FNV-1a, fast and stable across platforms and runs (unlike std::hash)
+inline uint64_t hashData(const void* pData, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    auto* pBytes = static_cast<const uint8_t*>(pData);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= pBytes[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+}
+
+#endif
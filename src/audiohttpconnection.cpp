@@ -0,0 +1,507 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audiohttpconnection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "utils/format.h"
+#include "utils/stringoperations.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace audio
+{
+
+#ifdef _WIN32
+static const intptr_t INVALID_SOCKET_HANDLE = static_cast<intptr_t>(INVALID_SOCKET);
+static void closeSocket(intptr_t sock) { closesocket(static_cast<SOCKET>(sock)); }
+
+static bool initWinsock()
+{
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+}
+#else
+static const intptr_t INVALID_SOCKET_HANDLE = -1;
+static void closeSocket(intptr_t sock) { ::close(static_cast<int>(sock)); }
+#endif
+
+// writing to a connection the server already reset must fail with EPIPE instead of raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+static const size_t RECEIVE_SIZE = 64 * 1024;
+static const size_t MAX_LINE_LENGTH = 8 * 1024;
+
+HttpUrl HttpUrl::parse(const std::string& url)
+{
+    static const std::string scheme = "http://";
+    if (url.compare(0, scheme.size(), scheme) != 0)
+    {
+        throw std::logic_error("Unsupported url: " + url);
+    }
+
+    HttpUrl result;
+    auto hostStart = scheme.size();
+    auto pathStart = url.find('/', hostStart);
+    auto hostPort = url.substr(hostStart, pathStart == std::string::npos ? std::string::npos : pathStart - hostStart);
+    result.path = pathStart == std::string::npos ? "/" : url.substr(pathStart);
+    result.authority = hostPort;
+
+    auto colon = hostPort.rfind(':');
+    if (colon != std::string::npos && hostPort.find(']', colon) == std::string::npos)
+    {
+        result.host = hostPort.substr(0, colon);
+        result.port = hostPort.substr(colon + 1);
+    }
+    else
+    {
+        result.host = hostPort;
+        result.port = "80";
+    }
+
+    // ipv6 literal
+    if (result.host.size() > 2 && result.host.front() == '[' && result.host.back() == ']')
+    {
+        result.host = result.host.substr(1, result.host.size() - 2);
+    }
+
+    if (result.host.empty())
+    {
+        throw std::logic_error("Invalid url: " + url);
+    }
+
+    return result;
+}
+
+HttpConnection::HttpConnection(const HttpUrl& url, int32_t timeoutMs)
+: m_Host(url.host)
+, m_Authority(url.authority)
+, m_Socket(INVALID_SOCKET_HANDLE)
+, m_Reusable(true)
+, m_BufferPos(0)
+, m_BodyOpen(false)
+, m_BodyChunked(false)
+, m_BodyUntilClose(false)
+, m_ChunkStarted(false)
+, m_BodyRemaining(0)
+{
+#ifdef _WIN32
+    static bool winsockInitialised = initWinsock();
+    if (!winsockInitialised)
+    {
+        throw std::logic_error("Failed to initialise winsock");
+    }
+#endif
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* pAddresses = nullptr;
+    if (getaddrinfo(url.host.c_str(), url.port.c_str(), &hints, &pAddresses) != 0)
+    {
+        throw std::logic_error("Failed to resolve host: " + url.host);
+    }
+
+    for (auto* pAddr = pAddresses; pAddr != nullptr; pAddr = pAddr->ai_next)
+    {
+        auto sock = static_cast<intptr_t>(socket(pAddr->ai_family, pAddr->ai_socktype, pAddr->ai_protocol));
+        if (sock == INVALID_SOCKET_HANDLE)
+        {
+            continue;
+        }
+
+#ifdef _WIN32
+        DWORD timeout = static_cast<DWORD>(timeoutMs);
+        setsockopt(static_cast<SOCKET>(sock), SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+        setsockopt(static_cast<SOCKET>(sock), SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+#else
+        timeval timeout;
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_usec = (timeoutMs % 1000) * 1000;
+        setsockopt(static_cast<int>(sock), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(static_cast<int>(sock), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#endif
+
+#ifdef SO_NOSIGPIPE
+        int noSigPipe = 1;
+        setsockopt(static_cast<int>(sock), SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+
+        // requests are small and sent in one go, don't wait for the ack of the previous one
+        int noDelay = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+        if (connect(sock, pAddr->ai_addr, static_cast<socklen_t>(pAddr->ai_addrlen)) == 0)
+        {
+            m_Socket = sock;
+            break;
+        }
+
+        closeSocket(sock);
+    }
+
+    freeaddrinfo(pAddresses);
+
+    if (m_Socket == INVALID_SOCKET_HANDLE)
+    {
+        throw std::logic_error("Failed to connect to host: " + url.authority);
+    }
+}
+
+HttpConnection::~HttpConnection()
+{
+    closeSocket(m_Socket);
+}
+
+bool HttpConnection::isReusable() const
+{
+    return m_Reusable;
+}
+
+HttpRange HttpConnection::getRange(const std::string& path, uint64_t offset, uint64_t size)
+{
+    HttpRange range;
+    range.offset = offset;
+
+    if (size == 0)
+    {
+        return range;
+    }
+
+    try
+    {
+        sendRequest(fmt::format("GET {} HTTP/1.1\r\n"
+                                "Host: {}\r\n"
+                                "Range: bytes={}-{}\r\n"
+                                "Connection: keep-alive\r\n"
+                                "\r\n",
+                                path, m_Authority, offset, offset + size - 1));
+
+        auto response = readResponseHeader();
+        if (response.close)
+        {
+            m_Reusable = false;
+        }
+
+        if (response.status == 416)
+        {
+            // range starts beyond the end of the resource, the error body is not needed
+            range.contentLength = response.rangeTotal;
+            m_Reusable = false;
+            return range;
+        }
+
+        if (response.status == 200)
+        {
+            // no range support, the complete resource is sent and can be streamed with readBody
+            range.ranged = false;
+            range.contentLength = response.hasContentLength ? response.contentLength : 0;
+            m_Reusable = false;
+            startBody(response);
+            return range;
+        }
+
+        if (response.status != 206)
+        {
+            throw std::logic_error(fmt::format("Http request failed with status {}: {}", response.status, path));
+        }
+
+        if (response.rangeStart != offset)
+        {
+            throw std::logic_error(fmt::format("Unexpected range in http response: {} (requested {})", response.rangeStart, offset));
+        }
+
+        range.contentLength = response.rangeTotal;
+        startBody(response);
+        range.data.resize(static_cast<size_t>(size));
+        range.data.resize(static_cast<size_t>(readBody(range.data.data(), size)));
+
+        // the connection can only be reused when the complete body was consumed
+        uint8_t extra;
+        if (m_BodyOpen && (response.close || readBody(&extra, 1) > 0))
+        {
+            m_Reusable = false;
+        }
+    }
+    catch (...)
+    {
+        m_Reusable = false;
+        throw;
+    }
+
+    return range;
+}
+
+uint64_t HttpConnection::readBody(uint8_t* pData, uint64_t size)
+{
+    uint64_t bytesRead = 0;
+    while (bytesRead < size && m_BodyOpen)
+    {
+        if (m_BodyChunked && m_BodyRemaining == 0)
+        {
+            if (m_ChunkStarted)
+            {
+                // line end after the chunk data
+                readLine();
+            }
+
+            m_BodyRemaining = std::strtoull(readLine().c_str(), nullptr, 16);
+            m_ChunkStarted = true;
+            if (m_BodyRemaining == 0)
+            {
+                // trailers
+                while (!readLine().empty()) {}
+                m_BodyOpen = false;
+                break;
+            }
+        }
+
+        if (m_BodyRemaining == 0)
+        {
+            m_BodyOpen = false;
+            break;
+        }
+
+        if (m_BufferPos == m_Buffer.size())
+        {
+            m_Buffer.resize(RECEIVE_SIZE);
+            auto received = receive(m_Buffer.data(), m_Buffer.size());
+            m_Buffer.resize(received);
+            m_BufferPos = 0;
+            if (received == 0)
+            {
+                if (!m_BodyUntilClose)
+                {
+                    throw std::logic_error("Connection closed while reading http body from " + m_Host);
+                }
+
+                m_BodyOpen = false;
+                break;
+            }
+        }
+
+        auto count = std::min<uint64_t>({ size - bytesRead, m_BodyRemaining, m_Buffer.size() - m_BufferPos });
+        memcpy(pData + bytesRead, m_Buffer.data() + m_BufferPos, static_cast<size_t>(count));
+        m_BufferPos += static_cast<size_t>(count);
+        bytesRead += count;
+        if (!m_BodyUntilClose)
+        {
+            m_BodyRemaining -= count;
+        }
+    }
+
+    return bytesRead;
+}
+
+void HttpConnection::startBody(const Response& response)
+{
+    m_BodyOpen = true;
+    m_BodyChunked = response.chunked;
+    m_BodyUntilClose = !response.chunked && !response.hasContentLength;
+    m_ChunkStarted = false;
+
+    if (m_BodyChunked)
+    {
+        m_BodyRemaining = 0;
+    }
+    else if (m_BodyUntilClose)
+    {
+        m_BodyRemaining = std::numeric_limits<uint64_t>::max();
+    }
+    else
+    {
+        m_BodyRemaining = response.contentLength;
+    }
+}
+
+void HttpConnection::sendRequest(const std::string& request)
+{
+    size_t sent = 0;
+    while (sent < request.size())
+    {
+        auto ret = send(m_Socket, request.data() + sent, static_cast<int>(request.size() - sent), SEND_FLAGS);
+        if (ret <= 0)
+        {
+            throw std::logic_error("Failed to send http request to " + m_Host);
+        }
+
+        sent += static_cast<size_t>(ret);
+    }
+}
+
+HttpConnection::Response HttpConnection::readResponseHeader()
+{
+    Response response;
+
+    auto statusLine = readLine();
+    if (statusLine.compare(0, 5, "HTTP/") != 0)
+    {
+        throw std::logic_error("Invalid http response: " + statusLine);
+    }
+
+    auto statusStart = statusLine.find(' ');
+    if (statusStart == std::string::npos)
+    {
+        throw std::logic_error("Invalid http response: " + statusLine);
+    }
+
+    response.status = std::atoi(statusLine.c_str() + statusStart + 1);
+    // http/1.0 servers close the connection unless told otherwise
+    response.close = statusLine.compare(0, 8, "HTTP/1.0") == 0;
+
+    for (;;)
+    {
+        auto line = readLine();
+        if (line.empty())
+        {
+            break;
+        }
+
+        auto colon = line.find(':');
+        if (colon == std::string::npos)
+        {
+            continue;
+        }
+
+        auto name = utils::str::lowercase(line.substr(0, colon));
+        auto value = utils::str::trim(line.substr(colon + 1));
+
+        if (name == "content-length")
+        {
+            response.contentLength = std::strtoull(value.c_str(), nullptr, 10);
+            response.hasContentLength = true;
+        }
+        else if (name == "content-range")
+        {
+            // bytes <first>-<last>/<total> or bytes */<total>
+            auto space = value.find(' ');
+            auto slash = value.find('/');
+            if (space != std::string::npos && slash != std::string::npos)
+            {
+                if (value[space + 1] != '*')
+                {
+                    response.rangeStart = std::strtoull(value.c_str() + space + 1, nullptr, 10);
+                }
+
+                if (value[slash + 1] != '*')
+                {
+                    response.rangeTotal = std::strtoull(value.c_str() + slash + 1, nullptr, 10);
+                }
+            }
+        }
+        else if (name == "transfer-encoding")
+        {
+            response.chunked = utils::str::lowercase(value).find("chunked") != std::string::npos;
+        }
+        else if (name == "connection")
+        {
+            auto lower = utils::str::lowercase(value);
+            if (lower.find("close") != std::string::npos)
+            {
+                response.close = true;
+            }
+            else if (lower.find("keep-alive") != std::string::npos)
+            {
+                response.close = false;
+            }
+        }
+    }
+
+    if (!response.chunked && !response.hasContentLength && response.status != 416)
+    {
+        // body is terminated by closing the connection
+        response.close = true;
+    }
+
+    return response;
+}
+
+size_t HttpConnection::receive(uint8_t* pData, size_t size)
+{
+    auto ret = recv(m_Socket, reinterpret_cast<char*>(pData), static_cast<int>(size), 0);
+    if (ret < 0)
+    {
+        throw std::logic_error("Failed to receive http data from " + m_Host);
+    }
+
+    return static_cast<size_t>(ret);
+}
+
+std::string HttpConnection::readLine()
+{
+    std::string line;
+
+    for (;;)
+    {
+        if (m_BufferPos == m_Buffer.size())
+        {
+            m_Buffer.resize(RECEIVE_SIZE);
+            auto received = receive(m_Buffer.data(), m_Buffer.size());
+            m_Buffer.resize(received);
+            m_BufferPos = 0;
+            if (received == 0)
+            {
+                throw std::logic_error("Connection closed by " + m_Host);
+            }
+        }
+
+        auto begin = m_Buffer.begin() + static_cast<ptrdiff_t>(m_BufferPos);
+        auto newLine = std::find(begin, m_Buffer.end(), '\n');
+        line.append(begin, newLine);
+        m_BufferPos = static_cast<size_t>(newLine - m_Buffer.begin());
+
+        if (newLine != m_Buffer.end())
+        {
+            ++m_BufferPos;
+            break;
+        }
+
+        if (line.size() > MAX_LINE_LENGTH)
+        {
+            throw std::logic_error("Http header line too long from " + m_Host);
+        }
+    }
+
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.pop_back();
+    }
+
+    return line;
+}
+
+}
@@ -0,0 +1,109 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_HTTP_CONNECTION_H
+#define AUDIO_HTTP_CONNECTION_H
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+namespace audio
+{
+
+struct HttpUrl
+{
+    std::string host;
+    std::string port;
+    std::string path;
+    // host and port as they appear in the url, used as the Host header
+    std::string authority;
+
+    // Only plain http urls are supported, throws on anything else
+    static HttpUrl parse(const std::string& url);
+};
+
+struct HttpRange
+{
+    uint64_t offset = 0;
+    // Total size of the resource, 0 when the server did not report it
+    uint64_t contentLength = 0;
+    // False when the server ignored the range, the data is empty and the
+    // complete resource has to be streamed with readBody
+    bool ranged = true;
+    std::vector<uint8_t> data;
+};
+
+// HTTP/1.1 client connection that is kept alive between requests
+// Not thread safe, a connection serves one request at a time
+class HttpConnection
+{
+public:
+    // Throws when the server cannot be reached
+    HttpConnection(const HttpUrl& url, int32_t timeoutMs);
+    ~HttpConnection();
+
+    HttpConnection(const HttpConnection&) = delete;
+    HttpConnection& operator=(const HttpConnection&) = delete;
+
+    // Get size bytes starting at offset, less data is returned at the end of the resource
+    // Throws on network or http errors, the connection can not be reused afterwards
+    HttpRange getRange(const std::string& path, uint64_t offset, uint64_t size);
+    // Continues reading the body of a response that was not ranged, returns less than size at the end
+    uint64_t readBody(uint8_t* pData, uint64_t size);
+
+    // False when the server closed the connection or a request failed
+    bool isReusable() const;
+
+private:
+    struct Response
+    {
+        int32_t     status = 0;
+        uint64_t    contentLength = 0;
+        bool        hasContentLength = false;
+        uint64_t    rangeStart = 0;
+        uint64_t    rangeTotal = 0;
+        bool        chunked = false;
+        bool        close = false;
+    };
+
+    void sendRequest(const std::string& request);
+    Response readResponseHeader();
+    void startBody(const Response& response);
+    size_t receive(uint8_t* pData, size_t size);
+    std::string readLine();
+
+    std::string             m_Host;
+    std::string             m_Authority;
+    intptr_t                m_Socket;
+    bool                    m_Reusable;
+    // data received beyond the current parse position
+    std::vector<uint8_t>    m_Buffer;
+    size_t                  m_BufferPos;
+
+    // state of the response body that is being read
+    bool                    m_BodyOpen;
+    bool                    m_BodyChunked;
+    bool                    m_BodyUntilClose;
+    bool                    m_ChunkStarted;
+    // bytes left in the body or in the current chunk
+    uint64_t                m_BodyRemaining;
+};
+
+}
+
+#endif
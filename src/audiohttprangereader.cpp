@@ -0,0 +1,438 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audiohttprangereader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "utils/log.h"
+
+namespace audio
+{
+
+static const uint64_t CHUNK_SIZE = 256 * 1024;
+// number of chunks requested in parallel ahead of the read position
+static const uint64_t PREFETCH_CHUNKS = 4;
+static const size_t MAX_CHUNKS = 32;
+static const size_t MAX_IDLE_CONNECTIONS = PREFETCH_CHUNKS + 1;
+
+static void checkRanged(const HttpRange& range)
+{
+    // the first request told us the server supports ranges
+    if (!range.ranged)
+    {
+        throw std::logic_error("Http server no longer honours range requests");
+    }
+}
+
+HttpRangeReader::HttpRangeReader(int32_t timeoutMs)
+: m_Timeout(timeoutMs)
+, m_Position(0)
+, m_ContentLength(0)
+, m_Eof(false)
+, m_Ranged(true)
+, m_StreamPosition(0)
+, m_UseCounter(0)
+{
+}
+
+HttpRangeReader::~HttpRangeReader()
+{
+    close();
+}
+
+void HttpRangeReader::open(const std::string& uri)
+{
+    close();
+
+    m_Uri = uri;
+    m_Url = HttpUrl::parse(uri);
+
+    // the first chunk provides the content length and reports unreachable servers early
+    bool reused = false;
+    auto connection = acquireConnection(reused);
+    auto range = connection->getRange(m_Url.path, 0, CHUNK_SIZE);
+    if (!range.ranged)
+    {
+        utils::log::warn("Http server does not support range requests, streaming: {}", uri);
+        m_Ranged = false;
+        m_ContentLength = range.contentLength;
+        m_Stream = std::move(connection);
+        m_StreamPosition = 0;
+        return;
+    }
+
+    releaseConnection(std::move(connection));
+    addChunk(0, std::move(range));
+}
+
+void HttpRangeReader::close()
+{
+    // waits for the pending fetches
+    m_Chunks.clear();
+
+    std::lock_guard<std::mutex> lock(m_ConnectionMutex);
+    m_Connections.clear();
+
+    m_Stream.reset();
+    m_Ranged = true;
+    m_StreamPosition = 0;
+    m_Position = 0;
+    m_ContentLength = 0;
+    m_Eof = false;
+}
+
+uint64_t HttpRangeReader::getContentLength()
+{
+    return m_ContentLength;
+}
+
+uint64_t HttpRangeReader::currentPosition()
+{
+    return m_Position;
+}
+
+bool HttpRangeReader::eof()
+{
+    return m_Eof || (lengthKnown() && m_Position >= m_ContentLength);
+}
+
+std::string HttpRangeReader::uri()
+{
+    return m_Uri;
+}
+
+void HttpRangeReader::seekAbsolute(uint64_t position)
+{
+    m_Position = position;
+    m_Eof = false;
+}
+
+void HttpRangeReader::seekRelative(uint64_t offset)
+{
+    seekAbsolute(m_Position + offset);
+}
+
+uint64_t HttpRangeReader::read(uint8_t* pData, uint64_t size)
+{
+    uint64_t bytesRead = 0;
+    while (bytesRead < size)
+    {
+        if (lengthKnown() && m_Position >= m_ContentLength)
+        {
+            break;
+        }
+
+        auto index = m_Position / CHUNK_SIZE;
+        prefetch(index);
+
+        auto& chunk = getChunk(index);
+        auto chunkOffset = m_Position - index * CHUNK_SIZE;
+        if (chunkOffset >= chunk.data.size())
+        {
+            break;
+        }
+
+        auto count = std::min<uint64_t>(size - bytesRead, chunk.data.size() - chunkOffset);
+        memcpy(pData + bytesRead, chunk.data.data() + chunkOffset, static_cast<size_t>(count));
+        bytesRead += count;
+        m_Position += count;
+    }
+
+    if (bytesRead < size)
+    {
+        m_Eof = true;
+    }
+
+    return bytesRead;
+}
+
+std::vector<uint8_t> HttpRangeReader::readAllData()
+{
+    std::vector<uint8_t> data;
+    seekAbsolute(0);
+
+    if (lengthKnown())
+    {
+        data.resize(static_cast<size_t>(m_ContentLength));
+        data.resize(static_cast<size_t>(read(data.data(), data.size())));
+        return data;
+    }
+
+    std::vector<uint8_t> buffer(CHUNK_SIZE);
+    while (!eof())
+    {
+        auto count = read(buffer.data(), buffer.size());
+        data.insert(data.end(), buffer.begin(), buffer.begin() + static_cast<ptrdiff_t>(count));
+    }
+
+    return data;
+}
+
+void HttpRangeReader::clearErrors()
+{
+    m_Eof = false;
+}
+
+bool HttpRangeReader::lengthKnown() const
+{
+    return m_ContentLength > 0;
+}
+
+void HttpRangeReader::updateContentLength(const HttpRange& chunk)
+{
+    if (lengthKnown())
+    {
+        return;
+    }
+
+    if (chunk.contentLength > 0)
+    {
+        m_ContentLength = chunk.contentLength;
+    }
+    else if (chunk.data.size() < CHUNK_SIZE)
+    {
+        // server did not report the size, a short chunk is the end of the resource
+        m_ContentLength = chunk.offset + chunk.data.size();
+    }
+}
+
+const HttpRange& HttpRangeReader::addChunk(uint64_t index, HttpRange range)
+{
+    evict();
+
+    std::promise<HttpRange> promise;
+    promise.set_value(std::move(range));
+
+    auto& chunk = m_Chunks[index];
+    chunk.data = promise.get_future().share();
+    chunk.lastUse = ++m_UseCounter;
+
+    auto& data = chunk.data.get();
+    updateContentLength(data);
+    return data;
+}
+
+const HttpRange& HttpRangeReader::getStreamedChunk(uint64_t index)
+{
+    auto iter = m_Chunks.find(index);
+    if (iter != m_Chunks.end())
+    {
+        iter->second.lastUse = ++m_UseCounter;
+        return iter->second.data.get();
+    }
+
+    auto offset = index * CHUNK_SIZE;
+    if (!m_Stream || offset < m_StreamPosition)
+    {
+        // the data was evicted, the only way back is streaming from the start again
+        m_Stream = std::make_unique<HttpConnection>(m_Url, m_Timeout);
+        auto range = m_Stream->getRange(m_Url.path, 0, CHUNK_SIZE);
+        m_StreamPosition = 0;
+        if (range.ranged)
+        {
+            m_Stream.reset();
+            m_Ranged = true;
+            addChunk(0, std::move(range));
+            return getChunk(index);
+        }
+    }
+
+    // the chunks up to the requested one are kept for seeks backwards
+    for (;;)
+    {
+        HttpRange range;
+        range.offset = m_StreamPosition;
+        range.contentLength = m_ContentLength;
+        range.data.resize(CHUNK_SIZE);
+        range.data.resize(static_cast<size_t>(m_Stream->readBody(range.data.data(), CHUNK_SIZE)));
+
+        auto chunkIndex = m_StreamPosition / CHUNK_SIZE;
+        bool end = range.data.size() < CHUNK_SIZE;
+        m_StreamPosition += range.data.size();
+
+        auto& chunk = addChunk(chunkIndex, std::move(range));
+        if (chunkIndex == index)
+        {
+            return chunk;
+        }
+
+        if (end)
+        {
+            // requested beyond the end of the resource
+            static const HttpRange empty;
+            return empty;
+        }
+    }
+}
+
+const HttpRange& HttpRangeReader::getChunk(uint64_t index)
+{
+    if (!m_Ranged)
+    {
+        return getStreamedChunk(index);
+    }
+
+    auto& future = requestChunk(index);
+
+    try
+    {
+        auto& chunk = future.get();
+        updateContentLength(chunk);
+        return chunk;
+    }
+    catch (...)
+    {
+        // a later read retries the request
+        m_Chunks.erase(index);
+        throw;
+    }
+}
+
+HttpRangeReader::ChunkFuture& HttpRangeReader::requestChunk(uint64_t index)
+{
+    auto iter = m_Chunks.find(index);
+    if (iter == m_Chunks.end())
+    {
+        evict();
+
+        Chunk chunk;
+        chunk.data = std::async(std::launch::async, [this, index] () {
+            return fetch(index * CHUNK_SIZE, CHUNK_SIZE);
+        }).share();
+
+        iter = m_Chunks.emplace(index, std::move(chunk)).first;
+    }
+
+    iter->second.lastUse = ++m_UseCounter;
+    return iter->second.data;
+}
+
+void HttpRangeReader::prefetch(uint64_t index)
+{
+    if (!m_Ranged)
+    {
+        // the stream is read in order, there is nothing to request in parallel
+        return;
+    }
+
+    auto last = index + PREFETCH_CHUNKS;
+    if (lengthKnown())
+    {
+        last = std::min(last, (m_ContentLength + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    }
+
+    // the chunk that is read first, the others in order of use
+    for (auto i = index; i < last; ++i)
+    {
+        requestChunk(i);
+    }
+}
+
+void HttpRangeReader::evict()
+{
+    while (m_Chunks.size() >= MAX_CHUNKS)
+    {
+        // least recently used chunk that is no longer being fetched,
+        // pending ones block on destruction
+        auto lru = m_Chunks.end();
+        for (auto iter = m_Chunks.begin(); iter != m_Chunks.end(); ++iter)
+        {
+            if (iter->second.data.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                continue;
+            }
+
+            if (lru == m_Chunks.end() || iter->second.lastUse < lru->second.lastUse)
+            {
+                lru = iter;
+            }
+        }
+
+        if (lru == m_Chunks.end())
+        {
+            break;
+        }
+
+        m_Chunks.erase(lru);
+    }
+}
+
+HttpRange HttpRangeReader::fetch(uint64_t offset, uint64_t size)
+{
+    bool reused = false;
+    auto connection = acquireConnection(reused);
+
+    try
+    {
+        auto range = connection->getRange(m_Url.path, offset, size);
+        checkRanged(range);
+        releaseConnection(std::move(connection));
+        return range;
+    }
+    catch (const std::exception& e)
+    {
+        if (!reused)
+        {
+            throw;
+        }
+
+        // the server may have closed the idle connection, retry once on a new one
+        utils::log::debug("Retry http range request on new connection: {}", e.what());
+    }
+
+    connection = std::make_unique<HttpConnection>(m_Url, m_Timeout);
+    auto range = connection->getRange(m_Url.path, offset, size);
+    checkRanged(range);
+    releaseConnection(std::move(connection));
+    return range;
+}
+
+std::unique_ptr<HttpConnection> HttpRangeReader::acquireConnection(bool& reused)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_ConnectionMutex);
+        if (!m_Connections.empty())
+        {
+            auto connection = std::move(m_Connections.back());
+            m_Connections.pop_back();
+            reused = true;
+            return connection;
+        }
+    }
+
+    reused = false;
+    return std::make_unique<HttpConnection>(m_Url, m_Timeout);
+}
+
+void HttpRangeReader::releaseConnection(std::unique_ptr<HttpConnection> connection)
+{
+    if (!connection->isReusable())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_ConnectionMutex);
+    if (m_Connections.size() < MAX_IDLE_CONNECTIONS)
+    {
+        m_Connections.push_back(std::move(connection));
+    }
+}
+
+}
@@ -0,0 +1,104 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_HTTP_RANGE_READER_H
+#define AUDIO_HTTP_RANGE_READER_H
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "utils/readerinterface.h"
+#include "audiohttpconnection.h"
+
+namespace audio
+{
+
+// Reader for http uris that fetches the resource in fixed size chunks using range requests
+// Connections are kept alive and reused, the chunks ahead of the read position
+// are requested in parallel and fetched chunks are kept so seeks within them
+// don't go to the network.
+// Servers without range support are streamed from a single response instead.
+// Not thread safe, the prefetching happens on background threads.
+class HttpRangeReader : public utils::IReader
+{
+public:
+    HttpRangeReader(int32_t timeoutMs = 10000);
+    ~HttpRangeReader();
+
+    void open(const std::string& uri) override;
+    void close() override;
+
+    uint64_t getContentLength() override;
+    uint64_t currentPosition() override;
+    bool eof() override;
+    std::string uri() override;
+
+    void seekAbsolute(uint64_t position) override;
+    void seekRelative(uint64_t offset) override;
+    uint64_t read(uint8_t* pData, uint64_t size) override;
+    std::vector<uint8_t> readAllData() override;
+    void clearErrors() override;
+
+private:
+    using ChunkFuture = std::shared_future<HttpRange>;
+
+    struct Chunk
+    {
+        ChunkFuture data;
+        uint64_t    lastUse;
+    };
+
+    const HttpRange& getChunk(uint64_t index);
+    // Chunks of servers without range support, read in order from a single response
+    const HttpRange& getStreamedChunk(uint64_t index);
+    const HttpRange& addChunk(uint64_t index, HttpRange range);
+    void updateContentLength(const HttpRange& chunk);
+    ChunkFuture& requestChunk(uint64_t index);
+    void prefetch(uint64_t index);
+    void evict();
+    bool lengthKnown() const;
+
+    // called from the prefetch threads
+    HttpRange fetch(uint64_t offset, uint64_t size);
+    std::unique_ptr<HttpConnection> acquireConnection(bool& reused);
+    void releaseConnection(std::unique_ptr<HttpConnection> connection);
+
+    std::string                                     m_Uri;
+    HttpUrl                                         m_Url;
+    int32_t                                         m_Timeout;
+    uint64_t                                        m_Position;
+    uint64_t                                        m_ContentLength;
+    bool                                            m_Eof;
+    bool                                            m_Ranged;
+    std::unique_ptr<HttpConnection>                 m_Stream;
+    uint64_t                                        m_StreamPosition;
+
+    std::mutex                                      m_ConnectionMutex;
+    std::vector<std::unique_ptr<HttpConnection>>    m_Connections;
+
+    // declared last, pending fetches block on destruction and use the connections
+    std::map<uint64_t, Chunk>                       m_Chunks;
+    uint64_t                                        m_UseCounter;
+};
+
+}
+
+#endif
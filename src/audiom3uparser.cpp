@@ -15,29 +15,18 @@
 //    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "audio/audiom3uparser.h"
-
-#include "utils/stringoperations.h"
-
-#include <algorithm>
-#include <iostream>
-#include <sstream>
-
-using namespace utils;
+#include "audio/audioplaylistparser.h"
 
 namespace audio
 {
 
 std::vector<std::string> M3uParser::parseFileContents(const std::string& contents)
 {
-    std::string copy = contents;
-    str::dos2unix(copy);
-    auto lines = str::split(copy, '\n');
-
-    lines.erase(std::remove_if(lines.begin(), lines.end(), [](const std::string& line) {
-        return line.find("#") == 0 || str::trim(line).empty();
-    }),
-        lines.end());
+    std::vector<std::string> paths;
+    PlaylistParser::parseM3u(contents, [&] (const PlaylistEntry& entry) {
+        paths.emplace_back(entry.path);
+    });
 
-    return lines;
+    return paths;
 }
 }
@@ -26,7 +26,8 @@
 #include "audio/audioframe.h"
 #include "utils/fileoperations.h"
 #include "utils/log.h"
-#include "utils/readerfactory.h"
+#include "audioreaderfactory.h"
+#include "audiomemorymappedreader.h"
 
 using namespace std;
 using namespace utils;
@@ -35,6 +36,8 @@ namespace audio
 {
 
 static const size_t INPUT_BUFFER_SIZE = 65536; //64kb buffer
+// larger than any mp3 frame
+static const size_t MAX_FRAME_SIZE = 8192;
 
 MadDecoder::MadDecoder(const std::string& uri)
 : IDecoder(uri)
@@ -47,9 +50,11 @@ MadDecoder::MadDecoder(const std::string& uri)
 , m_InputBuffer(INPUT_BUFFER_SIZE + MAD_BUFFER_GUARD)
 , m_RandomValueL(0)
 , m_RandomValueR(0)
-, m_Reader(ReaderFactory::createBuffered(uri, 1024 * 128))
+, m_Reader(createReader(uri, 1024 * 128))
+, m_pMappedReader(nullptr)
 {
     m_Reader->open(uri);
+    m_pMappedReader = dynamic_cast<MemoryMappedReader*>(m_Reader.get());
 
     m_FileSize = static_cast<uint32_t>(m_Reader->getContentLength());
 
@@ -155,10 +160,50 @@ void MadDecoder::seekRelative(double offset)
     seekAbsolute(getAudioClock() + offset);
 }
 
+bool MadDecoder::mapDataIfPossible()
+{
+    // mad needs MAD_BUFFER_GUARD zero bytes after the last frame, so only the
+    // data up to the final input buffer is decoded in place, the tail is copied
+    auto* pData = m_pMappedReader->data();
+    auto size = m_pMappedReader->size();
+    uint64_t tailStart = size > INPUT_BUFFER_SIZE ? size - INPUT_BUFFER_SIZE : 0;
+
+    uint64_t position = 0;
+    if (m_MadStream.buffer == nullptr)
+    {
+        position = m_pMappedReader->currentPosition();
+    }
+    else if (m_MadStream.buffer >= pData && m_MadStream.buffer < pData + size && m_MadStream.next_frame != nullptr)
+    {
+        position = static_cast<uint64_t>(m_MadStream.next_frame - pData);
+    }
+    else
+    {
+        // already decoding the copied tail
+        return false;
+    }
+
+    if (position + MAX_FRAME_SIZE >= tailStart)
+    {
+        // the remaining frames are read from the tail position into the input buffer
+        return false;
+    }
+
+    mad_stream_buffer(&m_MadStream, pData + position, static_cast<unsigned long>(tailStart - position));
+    m_MadStream.error = MAD_ERROR_NONE;
+    m_pMappedReader->seekAbsolute(tailStart);
+    return true;
+}
+
 bool MadDecoder::readDataIfNecessary()
 {
     if (m_MadStream.buffer == nullptr || m_MadStream.error == MAD_ERROR_BUFLEN)
     {
+        if (m_pMappedReader && mapDataIfPossible())
+        {
+            return true;
+        }
+
         size_t bytesToRead      = INPUT_BUFFER_SIZE;
         size_t choppedFrameSize = 0;
 
@@ -260,7 +305,15 @@ inline int32_t dither(mad_fixed_t sample, mad_fixed_t ditherError[3], mad_fixed_
 
 bool MadDecoder::decodeAudioFrame(Frame& audioFrame)
 {
-    return decodeAudioFrame(audioFrame, true);
+    ScopedTimer timer(m_Metrics.decodeTime);
+
+    bool decoded = decodeAudioFrame(audioFrame, true);
+    if (decoded)
+    {
+        m_Metrics.framesDecoded.increment();
+    }
+
+    return decoded;
 }
 
 bool MadDecoder::decodeAudioFrame(Frame& frame, bool processSamples)
@@ -272,7 +325,10 @@ bool MadDecoder::decodeAudioFrame(Frame& frame, bool processSamples)
         if (MAD_RECOVERABLE(m_MadStream.error))
         {
             if (processSamples)
+            {
                 log::warn("Decode error, but recoverable: {}", mad_stream_errorstr(&m_MadStream));
+                m_Metrics.decodeErrors.increment();
+            }
         }
         else
         {
@@ -288,6 +344,7 @@ bool MadDecoder::decodeAudioFrame(Frame& frame, bool processSamples)
             else
             {
                 log::error("Decoder error, unrecoverable: {}", mad_stream_errorstr(&m_MadStream));
+                m_Metrics.decodeErrors.increment();
                 return false;
             }
         }
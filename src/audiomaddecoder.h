@@ -36,6 +36,7 @@ namespace audio
 {
 
 class Frame;
+class MemoryMappedReader;
 
 class MadDecoder : public IDecoder
 {
@@ -56,6 +57,7 @@ public:
 
 private:
     bool readDataIfNecessary();
+    bool mapDataIfPossible();
     bool synchronize();
     bool readHeaders(utils::IReader& reader);
     bool decodeAudioFrame(Frame& audioFrame, bool processSamples);
@@ -86,6 +88,8 @@ private:
     mad_fixed_t                     m_RandomValueR;
 
     std::unique_ptr<utils::IReader> m_Reader;
+    // set when the file is memory mapped, mad decodes it in place
+    MemoryMappedReader*             m_pMappedReader;
 };
 
 }
@@ -0,0 +1,169 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audiomemorymappedfile.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace audio
+{
+
+#ifdef _WIN32
+
+MemoryMappedFile::MemoryMappedFile(const std::string& path)
+: m_pData(nullptr)
+, m_Size(0)
+, m_File(INVALID_HANDLE_VALUE)
+, m_Mapping(nullptr)
+{
+    m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE)
+    {
+        throw std::logic_error("Failed to open file: " + path);
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_File, &size))
+    {
+        CloseHandle(m_File);
+        throw std::logic_error("Failed to obtain file size: " + path);
+    }
+
+    m_Size = static_cast<size_t>(size.QuadPart);
+    if (m_Size == 0)
+    {
+        return;
+    }
+
+    m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_Mapping)
+    {
+        m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+
+    if (!m_pData)
+    {
+        if (m_Mapping) CloseHandle(m_Mapping);
+        CloseHandle(m_File);
+        throw std::logic_error("Failed to map file: " + path);
+    }
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    if (m_pData) UnmapViewOfFile(m_pData);
+    if (m_Mapping) CloseHandle(m_Mapping);
+    CloseHandle(m_File);
+}
+
+void MemoryMappedFile::adviseSequential()
+{
+}
+
+void MemoryMappedFile::prefetch(size_t, size_t)
+{
+}
+
+#else
+
+MemoryMappedFile::MemoryMappedFile(const std::string& path)
+: m_pData(nullptr)
+, m_Size(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::logic_error("Failed to open file: " + path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw std::logic_error("Failed to obtain file size: " + path);
+    }
+
+    m_Size = static_cast<size_t>(st.st_size);
+    if (m_Size > 0)
+    {
+        void* pData = mmap(nullptr, m_Size, PROT_READ, MAP_SHARED, fd, 0);
+        if (pData == MAP_FAILED)
+        {
+            close(fd);
+            throw std::logic_error("Failed to map file: " + path);
+        }
+
+        m_pData = static_cast<const uint8_t*>(pData);
+    }
+
+    // the mapping stays valid after closing the descriptor
+    close(fd);
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    if (m_pData)
+    {
+        munmap(const_cast<uint8_t*>(m_pData), m_Size);
+    }
+}
+
+void MemoryMappedFile::adviseSequential()
+{
+    if (m_pData)
+    {
+        madvise(const_cast<uint8_t*>(m_pData), m_Size, MADV_SEQUENTIAL);
+    }
+}
+
+void MemoryMappedFile::prefetch(size_t offset, size_t size)
+{
+    if (!m_pData || offset >= m_Size)
+    {
+        return;
+    }
+
+    // madvise needs a page aligned address
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t start = offset - (offset % pageSize);
+    size_t end = std::min(m_Size, offset + size);
+    madvise(const_cast<uint8_t*>(m_pData) + start, end - start, MADV_WILLNEED);
+}
+
+#endif
+
+const uint8_t* MemoryMappedFile::data() const
+{
+    return m_pData;
+}
+
+size_t MemoryMappedFile::size() const
+{
+    return m_Size;
+}
+
+}
@@ -0,0 +1,57 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_MEMORY_MAPPED_FILE_H
+#define AUDIO_MEMORY_MAPPED_FILE_H
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+
+namespace audio
+{
+
+// Read only mapping of a complete file
+class MemoryMappedFile
+{
+public:
+    // Throws when the file cannot be opened or mapped
+    MemoryMappedFile(const std::string& path);
+    ~MemoryMappedFile();
+
+    MemoryMappedFile(const MemoryMappedFile&) = delete;
+    MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+    const uint8_t* data() const;
+    size_t size() const;
+
+    // Read ahead hints for the kernel, no-ops where they are not supported
+    void adviseSequential();
+    void prefetch(size_t offset, size_t size);
+
+private:
+    const uint8_t*  m_pData;
+    size_t          m_Size;
+#ifdef _WIN32
+    void*           m_File;
+    void*           m_Mapping;
+#endif
+};
+
+}
+
+#endif
@@ -0,0 +1,128 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audiomemorymappedreader.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace audio
+{
+
+// data that is prefetched after a seek
+static const size_t SEEK_PREFETCH_SIZE = 256 * 1024;
+
+MemoryMappedReader::MemoryMappedReader()
+: m_Position(0)
+, m_Eof(false)
+{
+}
+
+void MemoryMappedReader::open(const std::string& uri)
+{
+    close();
+
+    m_File = std::make_unique<MemoryMappedFile>(uri);
+    m_File->adviseSequential();
+    m_File->prefetch(0, SEEK_PREFETCH_SIZE);
+    m_Uri = uri;
+}
+
+void MemoryMappedReader::close()
+{
+    m_File.reset();
+    m_Uri.clear();
+    m_Position = 0;
+    m_Eof = false;
+}
+
+uint64_t MemoryMappedReader::getContentLength()
+{
+    return size();
+}
+
+uint64_t MemoryMappedReader::currentPosition()
+{
+    return m_Position;
+}
+
+bool MemoryMappedReader::eof()
+{
+    return m_Eof || m_Position >= size();
+}
+
+std::string MemoryMappedReader::uri()
+{
+    return m_Uri;
+}
+
+void MemoryMappedReader::seekAbsolute(uint64_t position)
+{
+    m_Position = position;
+    m_Eof = false;
+
+    if (m_File)
+    {
+        m_File->prefetch(static_cast<size_t>(std::min(position, size())), SEEK_PREFETCH_SIZE);
+    }
+}
+
+void MemoryMappedReader::seekRelative(uint64_t offset)
+{
+    seekAbsolute(m_Position + offset);
+}
+
+uint64_t MemoryMappedReader::read(uint8_t* pData, uint64_t size)
+{
+    auto available = m_Position < this->size() ? this->size() - m_Position : 0;
+    auto count = std::min(size, available);
+    if (count > 0)
+    {
+        memcpy(pData, data() + m_Position, static_cast<size_t>(count));
+        m_Position += count;
+    }
+
+    if (count < size)
+    {
+        m_Eof = true;
+    }
+
+    return count;
+}
+
+std::vector<uint8_t> MemoryMappedReader::readAllData()
+{
+    m_Position = size();
+    return std::vector<uint8_t>(data(), data() + size());
+}
+
+void MemoryMappedReader::clearErrors()
+{
+    m_Eof = false;
+}
+
+const uint8_t* MemoryMappedReader::data() const
+{
+    return m_File ? m_File->data() : nullptr;
+}
+
+uint64_t MemoryMappedReader::size() const
+{
+    return m_File ? m_File->size() : 0;
+}
+
+}
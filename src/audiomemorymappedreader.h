@@ -0,0 +1,67 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_MEMORY_MAPPED_READER_H
+#define AUDIO_MEMORY_MAPPED_READER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/readerinterface.h"
+#include "audiomemorymappedfile.h"
+
+namespace audio
+{
+
+// Reader for local files that maps the complete file
+// The mapping is accessible so decoders can parse the data in place without copying it.
+// The kernel is told the file is read sequentially, after a seek the data around
+// the new position is prefetched.
+class MemoryMappedReader : public utils::IReader
+{
+public:
+    MemoryMappedReader();
+
+    void open(const std::string& uri) override;
+    void close() override;
+
+    uint64_t getContentLength() override;
+    uint64_t currentPosition() override;
+    bool eof() override;
+    std::string uri() override;
+
+    void seekAbsolute(uint64_t position) override;
+    void seekRelative(uint64_t offset) override;
+    uint64_t read(uint8_t* pData, uint64_t size) override;
+    std::vector<uint8_t> readAllData() override;
+    void clearErrors() override;
+
+    // Valid until the reader is closed
+    const uint8_t* data() const;
+    uint64_t size() const;
+
+private:
+    std::unique_ptr<MemoryMappedFile>   m_File;
+    std::string                         m_Uri;
+    uint64_t                            m_Position;
+    bool                                m_Eof;
+};
+
+}
+
+#endif
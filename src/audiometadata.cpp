@@ -23,6 +23,7 @@
 #include "utils/stringoperations.h"
 #include "utils/fileoperations.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cassert>
 #include <cstring>
@@ -68,6 +69,17 @@ Metadata::Metadata(const std::string& uri, ReadAudioProperties props)
     throwIfNotValid();
 }
 
+bool Metadata::isSupported(const std::string& filepath)
+{
+    static const std::vector<std::string> extensions = {
+        "MP3", "OGG", "OGA", "FLAC", "MPC", "WV", "SPX", "TTA", "WMA", "ASF", "AIF", "AIFF", "WAV", "APE",
+        "S3M", "IT", "XM", "MOD", "MODULE", "NST", "WOW", "M4A", "M4R", "M4B", "M4P", "MP4", "3G2"
+    };
+
+    auto ext = str::uppercase(fileops::getFileExtension(filepath));
+    return std::find(extensions.begin(), extensions.end(), ext) != extensions.end();
+}
+
 std::string Metadata::getArtist()
 {
     return str::trim(m_TagFile->tag()->artist().to8Bit(true));
@@ -96,6 +108,28 @@ std::string Metadata::getAlbumArtist()
             }
         }
     }
+    else if (TagLib::Ogg::Vorbis::File* pVorbisFile = dynamic_cast<TagLib::Ogg::Vorbis::File*>(m_TagFile.get()))
+    {
+        if (pVorbisFile->tag())
+        {
+            const TagLib::Ogg::FieldListMap& listMap = pVorbisFile->tag()->fieldListMap();
+            if (!listMap["ALBUMARTIST"].isEmpty())
+            {
+                return str::trim(listMap["ALBUMARTIST"].front().to8Bit(true));
+            }
+        }
+    }
+    else if (TagLib::FLAC::File* pFlacFile = dynamic_cast<TagLib::FLAC::File*>(m_TagFile.get()))
+    {
+        if (pFlacFile->xiphComment())
+        {
+            const TagLib::Ogg::FieldListMap& listMap = pFlacFile->xiphComment()->fieldListMap();
+            if (!listMap["ALBUMARTIST"].isEmpty())
+            {
+                return str::trim(listMap["ALBUMARTIST"].front().to8Bit(true));
+            }
+        }
+    }
     else if (TagLib::MP4::File* pMp4File = dynamic_cast<TagLib::MP4::File*>(m_TagFile.get()))
     {
         auto&items = pMp4File->tag()->itemListMap();
@@ -151,9 +185,9 @@ std::string Metadata::getComposer()
     else if (TagLib::MP4::File* pMp4File = dynamic_cast<TagLib::MP4::File*>(m_TagFile.get()))
     {
         auto&items = pMp4File->tag()->itemListMap();
-        if (items.contains("@wrt"))
+        if (items.contains("\251wrt"))
         {
-            return str::trim(items["aART"].toStringList().front().to8Bit(true));
+            return str::trim(items["\251wrt"].toStringList().front().to8Bit(true));
         }
     }
 
@@ -251,9 +285,11 @@ static ImageFormat imageFormatFromMp4Format(MP4::CoverArt::Format format)
     }
 }
 
-AlbumArt Metadata::getAlbumArt()
+AlbumArtView Metadata::getAlbumArtView()
 {
-    AlbumArt art;
+    // taglib byte vectors are implicitly shared, only the const data accessor
+    // is used so the pointers refer to the picture data owned by the tag
+    AlbumArtView art;
 
     if (MPEG::File* pMpegFile = dynamic_cast<MPEG::File*>(m_TagFile.get()))
     {
@@ -261,59 +297,194 @@ AlbumArt Metadata::getAlbumArt()
         {
             TagLib::ID3v2::AttachedPictureFrame* pAlbumArt = nullptr;
 
-            TagLib::ID3v2::FrameList list = pMpegFile->ID3v2Tag()->frameList("APIC");
-            for (TagLib::ID3v2::FrameList::Iterator iter = list.begin(); iter != list.end(); ++iter)
+            const TagLib::ID3v2::FrameList& list = pMpegFile->ID3v2Tag()->frameList("APIC");
+            for (auto iter = list.begin(); iter != list.end(); ++iter)
             {
-                TagLib::ID3v2::AttachedPictureFrame* pCurPicture = static_cast<TagLib::ID3v2::AttachedPictureFrame*>(*iter);
+                auto* pCurPicture = static_cast<TagLib::ID3v2::AttachedPictureFrame*>(*iter);
 
                 if (pCurPicture->type() == TagLib::ID3v2::AttachedPictureFrame::FrontCover)
                 {
                     pAlbumArt = pCurPicture;
-                    art.format = imageFormatFromMimetype(pCurPicture->mimeType().toCString());
                     break;
                 }
                 else if (pAlbumArt == nullptr)
                 {
                     pAlbumArt = pCurPicture;
-                    art.format = imageFormatFromMimetype(pCurPicture->mimeType().toCString());
                 }
             }
 
             if (pAlbumArt != nullptr)
             {
-                art.data.resize(pAlbumArt->picture().size());
-                memcpy(art.data.data(), pAlbumArt->picture().data(), art.data.size());
+                const ByteVector picture = pAlbumArt->picture();
+                art.format = imageFormatFromMimetype(pAlbumArt->mimeType().toCString());
+                art.pData  = reinterpret_cast<const uint8_t*>(picture.data());
+                art.size   = picture.size();
             }
         }
     }
     else if (FLAC::File* pFlacFile = dynamic_cast<FLAC::File*>(m_TagFile.get()))
     {
-        auto picList = pFlacFile->pictureList();
+        const auto& picList = pFlacFile->pictureList();
         if (!picList.isEmpty())
         {
-            TagLib::FLAC::Picture* pic = picList[0];
-            auto picData = pic->data();
-            art.data.resize(picData.size());
-            memcpy(art.data.data(), picData.data(), art.data.size());
+            TagLib::FLAC::Picture* pic = picList.front();
+            const ByteVector picData = pic->data();
             art.format = imageFormatFromMimetype(pic->mimeType().toCString());
+            art.pData  = reinterpret_cast<const uint8_t*>(picData.data());
+            art.size   = picData.size();
         }
     }
     else if (MP4::File* pMp4File = dynamic_cast<MP4::File*>(m_TagFile.get()))
     {
-        auto& coverItem = pMp4File->tag()->itemListMap()["covr"];
-        auto coverList = coverItem.toCoverArtList();
+        // find does not insert an empty item like operator[]
+        auto& items = pMp4File->tag()->itemListMap();
+        auto iter = items.find("covr");
+        if (iter != items.end())
+        {
+            const auto& coverList = iter->second.toCoverArtList();
+            if (!coverList.isEmpty())
+            {
+                const ByteVector data = coverList.front().data();
+                art.format = imageFormatFromMp4Format(coverList.front().format());
+                art.pData  = reinterpret_cast<const uint8_t*>(data.data());
+                art.size   = data.size();
+            }
+        }
+    }
+
+    if (art.size == 0)
+    {
+        art.pData = nullptr;
+    }
+
+    return art;
+}
 
-        if (!coverList.isEmpty())
+AlbumArt Metadata::getAlbumArt()
+{
+    auto view = getAlbumArtView();
+
+    AlbumArt art;
+    art.format = view.format;
+    art.data.assign(view.pData, view.pData + view.size);
+    return art;
+}
+
+static std::string_view trimmed(std::string_view value)
+{
+    static const char* whitespace = " \t\r\n";
+
+    auto begin = value.find_first_not_of(whitespace);
+    if (begin == std::string_view::npos)
+    {
+        return std::string_view();
+    }
+
+    return value.substr(begin, value.find_last_not_of(whitespace) - begin + 1);
+}
+
+static std::string_view addString(StringArena& arena, const TagLib::String& value)
+{
+    // the only utf-8 conversion of the field
+    return arena.add(trimmed(value.to8Bit(true)));
+}
+
+MetadataFields Metadata::readAll(StringArena& arena)
+{
+    MetadataFields fields;
+
+    if (auto* pTag = m_TagFile->tag())
+    {
+        fields.artist   = addString(arena, pTag->artist());
+        fields.title    = addString(arena, pTag->title());
+        fields.album    = addString(arena, pTag->album());
+        fields.genre    = addString(arena, pTag->genre());
+        fields.year     = pTag->year();
+        fields.trackNr  = pTag->track();
+    }
+
+    if (auto* pProps = m_TagFile->audioProperties())
+    {
+        fields.bitRate      = pProps->bitrate();
+        fields.sampleRate   = pProps->sampleRate();
+        fields.channels     = pProps->channels();
+        fields.duration     = pProps->length();
+    }
+
+    auto readXiphComment = [&] (const TagLib::Ogg::XiphComment* pComment) {
+        if (!pComment)
+        {
+            return;
+        }
+
+        auto& listMap = pComment->fieldListMap();
+        auto iter = listMap.find("ALBUMARTIST");
+        if (iter != listMap.end() && !iter->second.isEmpty())
+        {
+            fields.albumArtist = addString(arena, iter->second.front());
+        }
+
+        iter = listMap.find("COMPOSER");
+        if (iter != listMap.end() && !iter->second.isEmpty())
+        {
+            fields.composer = addString(arena, iter->second.front());
+        }
+
+        iter = listMap.find("DISCNUMBER");
+        if (iter != listMap.end() && !iter->second.isEmpty())
         {
-            auto data = coverList.front().data();
+            fields.discNr = parseDisc(std::string(trimmed(iter->second.front().to8Bit(true))));
+        }
+    };
 
-            art.data.resize(data.size());
-            memcpy(art.data.data(), data.data(), art.data.size());
-            art.format = imageFormatFromMp4Format(coverList.front().format());
+    // a single cast per file type and a single pass over the id3v2 frames
+    if (auto* pMpegFile = dynamic_cast<TagLib::MPEG::File*>(m_TagFile.get()))
+    {
+        if (auto* pId3v2Tag = pMpegFile->ID3v2Tag())
+        {
+            for (auto* pFrame : pId3v2Tag->frameList())
+            {
+                auto id = pFrame->frameID();
+                if (id == "TPE2" && fields.albumArtist.empty())
+                {
+                    fields.albumArtist = addString(arena, pFrame->toString());
+                }
+                else if (id == "TCOM" && fields.composer.empty())
+                {
+                    fields.composer = addString(arena, pFrame->toString());
+                }
+                else if (id == "TPOS" && fields.discNr == 0)
+                {
+                    fields.discNr = parseDisc(std::string(trimmed(pFrame->toString().to8Bit(true))));
+                }
+            }
         }
     }
+    else if (auto* pVorbisFile = dynamic_cast<TagLib::Ogg::Vorbis::File*>(m_TagFile.get()))
+    {
+        readXiphComment(pVorbisFile->tag());
+    }
+    else if (auto* pFlacFile = dynamic_cast<TagLib::FLAC::File*>(m_TagFile.get()))
+    {
+        readXiphComment(pFlacFile->xiphComment());
+    }
+    else if (auto* pMp4File = dynamic_cast<TagLib::MP4::File*>(m_TagFile.get()))
+    {
+        auto& items = pMp4File->tag()->itemListMap();
+        auto iter = items.find("aART");
+        if (iter != items.end() && !iter->second.toStringList().isEmpty())
+        {
+            fields.albumArtist = addString(arena, iter->second.toStringList().front());
+        }
 
-    return art;
+        iter = items.find("\251wrt");
+        if (iter != items.end() && !iter->second.toStringList().isEmpty())
+        {
+            fields.composer = addString(arena, iter->second.toStringList().front());
+        }
+    }
+
+    return fields;
 }
 
 uint32_t Metadata::parseDisc(const std::string& disc)
@@ -0,0 +1,377 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audio/audiometadatacache.h"
+#include "audiohash.h"
+#include "audiomemorymappedfile.h"
+
+#include "utils/log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+using namespace utils;
+
+namespace audio
+{
+
+static const char CACHE_MAGIC[4] = { 'A', 'M', 'D', 'C' };
+static const uint32_t CACHE_VERSION = 2;
+
+struct CacheHeader
+{
+    char        magic[4];
+    uint32_t    version;
+    uint64_t    recordCount;
+    uint64_t    stringsSize;
+};
+
+struct StringRef
+{
+    uint32_t    offset;
+    uint32_t    length;
+};
+
+struct MetadataCache::Record
+{
+    uint64_t    pathHash;
+    uint64_t    fileSize;
+    int64_t     modificationTime;
+    uint64_t    albumArtHash;
+    StringRef   path;
+    StringRef   artist;
+    StringRef   title;
+    StringRef   album;
+    StringRef   albumArtist;
+    StringRef   genre;
+    StringRef   composer;
+    uint32_t    discNr;
+    uint32_t    year;
+    uint32_t    trackNr;
+    uint32_t    bitRate;
+    uint32_t    sampleRate;
+    uint32_t    channels;
+    uint32_t    duration;
+    uint32_t    fields;
+};
+
+static_assert(sizeof(CacheHeader) == 24, "Unexpected cache header size");
+
+static uint64_t hashPath(const std::string& path)
+{
+    return hashData(path.data(), path.size());
+}
+
+bool FileStamp::get(const std::string& path, FileStamp& stamp)
+{
+    std::error_code error;
+    auto size = std::filesystem::file_size(path, error);
+    if (error)
+    {
+        return false;
+    }
+
+    auto time = std::filesystem::last_write_time(path, error);
+    if (error)
+    {
+        return false;
+    }
+
+    stamp.size = size;
+    stamp.modificationTime = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    return true;
+}
+
+MetadataCache::MetadataCache(const std::string& cachePath)
+: m_Path(cachePath)
+, m_pRecords(nullptr)
+, m_RecordCount(0)
+, m_pStrings(nullptr)
+, m_StringsSize(0)
+{
+    map();
+}
+
+MetadataCache::~MetadataCache() = default;
+
+void MetadataCache::map()
+{
+    static_assert(sizeof(Record) == 120, "Unexpected cache record size");
+
+    m_File.reset();
+    m_pRecords = nullptr;
+    m_RecordCount = 0;
+    m_pStrings = nullptr;
+    m_StringsSize = 0;
+    m_Used.clear();
+
+    std::error_code error;
+    if (!std::filesystem::exists(m_Path, error))
+    {
+        return;
+    }
+
+    try
+    {
+        m_File = std::make_unique<MemoryMappedFile>(m_Path);
+    }
+    catch (std::exception& e)
+    {
+        log::warn("Failed to open metadata cache: {}", e.what());
+        return;
+    }
+
+    CacheHeader header;
+    if (m_File->size() < sizeof(header))
+    {
+        log::warn("Ignoring corrupt metadata cache: {}", m_Path);
+        m_File.reset();
+        return;
+    }
+
+    memcpy(&header, m_File->data(), sizeof(header));
+    uint64_t recordsSize = header.recordCount * sizeof(Record);
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.version != CACHE_VERSION ||
+        header.recordCount > m_File->size() / sizeof(Record) ||
+        sizeof(header) + recordsSize + header.stringsSize != m_File->size())
+    {
+        log::warn("Ignoring incompatible metadata cache: {}", m_Path);
+        m_File.reset();
+        return;
+    }
+
+    m_pRecords    = reinterpret_cast<const Record*>(m_File->data() + sizeof(header));
+    m_RecordCount = header.recordCount;
+    m_pStrings    = reinterpret_cast<const char*>(m_File->data() + sizeof(header) + recordsSize);
+    m_StringsSize = header.stringsSize;
+    m_Used.resize(m_RecordCount, false);
+}
+
+const MetadataCache::Record* MetadataCache::findRecord(const std::string& path) const
+{
+    auto hash = hashPath(path);
+    auto* pEnd = m_pRecords + m_RecordCount;
+    auto* pRecord = std::lower_bound(m_pRecords, pEnd, hash, [] (const Record& record, uint64_t value) {
+        return record.pathHash < value;
+    });
+
+    for (; pRecord != pEnd && pRecord->pathHash == hash; ++pRecord)
+    {
+        auto& ref = pRecord->path;
+        if (ref.length == path.size() && ref.offset + static_cast<uint64_t>(ref.length) <= m_StringsSize &&
+            memcmp(m_pStrings + ref.offset, path.data(), ref.length) == 0)
+        {
+            return pRecord;
+        }
+    }
+
+    return nullptr;
+}
+
+void MetadataCache::readRecord(const Record& record, TrackMetadata& meta) const
+{
+    auto read = [this] (const StringRef& ref) {
+        if (ref.offset + static_cast<uint64_t>(ref.length) > m_StringsSize)
+        {
+            return std::string();
+        }
+
+        return std::string(m_pStrings + ref.offset, ref.length);
+    };
+
+    meta.path           = read(record.path);
+    meta.artist         = read(record.artist);
+    meta.title          = read(record.title);
+    meta.album          = read(record.album);
+    meta.albumArtist    = read(record.albumArtist);
+    meta.genre          = read(record.genre);
+    meta.composer       = read(record.composer);
+    meta.discNr         = record.discNr;
+    meta.year           = record.year;
+    meta.trackNr        = record.trackNr;
+    meta.bitRate        = record.bitRate;
+    meta.sampleRate     = record.sampleRate;
+    meta.channels       = record.channels;
+    meta.duration       = record.duration;
+    meta.albumArtHash   = record.albumArtHash;
+}
+
+bool MetadataCache::lookup(const std::string& path, const FileStamp& stamp, uint32_t fields, TrackMetadata& meta)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto iter = m_Updates.find(path);
+    if (iter != m_Updates.end())
+    {
+        if (iter->second.stamp.size != stamp.size || iter->second.stamp.modificationTime != stamp.modificationTime ||
+            (iter->second.fields & fields) != fields)
+        {
+            return false;
+        }
+
+        meta = iter->second.meta;
+        return true;
+    }
+
+    auto* pRecord = findRecord(path);
+    if (!pRecord || pRecord->fileSize != stamp.size || pRecord->modificationTime != stamp.modificationTime ||
+        (pRecord->fields & fields) != fields)
+    {
+        return false;
+    }
+
+    m_Used[pRecord - m_pRecords] = true;
+    readRecord(*pRecord, meta);
+    return true;
+}
+
+void MetadataCache::store(const std::string& path, const FileStamp& stamp, uint32_t fields, const TrackMetadata& meta)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto& entry = m_Updates[path];
+    entry.stamp  = stamp;
+    entry.fields = fields;
+    entry.meta   = meta;
+    entry.meta.path = path;
+}
+
+void MetadataCache::save(bool dropUnused)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    struct Item
+    {
+        uint64_t        hash;
+        const Entry*    pEntry;
+    };
+
+    // entries of the current file that are not replaced are copied over
+    std::vector<Entry> existing;
+    for (uint64_t i = 0; i < m_RecordCount; ++i)
+    {
+        if (dropUnused && !m_Used[i])
+        {
+            continue;
+        }
+
+        Entry entry;
+        readRecord(m_pRecords[i], entry.meta);
+        if (m_Updates.find(entry.meta.path) == m_Updates.end())
+        {
+            entry.stamp.size = m_pRecords[i].fileSize;
+            entry.stamp.modificationTime = m_pRecords[i].modificationTime;
+            entry.fields = m_pRecords[i].fields;
+            existing.push_back(std::move(entry));
+        }
+    }
+
+    std::vector<Item> items;
+    items.reserve(existing.size() + m_Updates.size());
+    for (auto& entry : existing)
+    {
+        items.push_back({ hashPath(entry.meta.path), &entry });
+    }
+
+    for (auto& update : m_Updates)
+    {
+        items.push_back({ hashPath(update.first), &update.second });
+    }
+
+    std::sort(items.begin(), items.end(), [] (const Item& lhs, const Item& rhs) { return lhs.hash < rhs.hash; });
+
+    std::vector<Record> records;
+    records.reserve(items.size());
+    std::string strings;
+
+    auto addString = [&strings] (const std::string& value) {
+        if (strings.size() + value.size() > UINT32_MAX)
+        {
+            throw std::logic_error("Metadata cache is too large");
+        }
+
+        StringRef ref { static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(value.size()) };
+        strings += value;
+        return ref;
+    };
+
+    for (auto& item : items)
+    {
+        auto& meta = item.pEntry->meta;
+
+        Record record = {};
+        record.pathHash         = item.hash;
+        record.fileSize         = item.pEntry->stamp.size;
+        record.modificationTime = item.pEntry->stamp.modificationTime;
+        record.albumArtHash     = meta.albumArtHash;
+        record.path             = addString(meta.path);
+        record.artist           = addString(meta.artist);
+        record.title            = addString(meta.title);
+        record.album            = addString(meta.album);
+        record.albumArtist      = addString(meta.albumArtist);
+        record.genre            = addString(meta.genre);
+        record.composer         = addString(meta.composer);
+        record.discNr           = meta.discNr;
+        record.year             = meta.year;
+        record.trackNr          = meta.trackNr;
+        record.bitRate          = meta.bitRate;
+        record.sampleRate       = meta.sampleRate;
+        record.channels         = meta.channels;
+        record.duration         = meta.duration;
+        record.fields           = item.pEntry->fields;
+        records.push_back(record);
+    }
+
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version      = CACHE_VERSION;
+    header.recordCount  = records.size();
+    header.stringsSize  = strings.size();
+
+    // write a new file and replace the old one so readers never see a partial cache
+    std::string tempPath = m_Path + ".tmp";
+    {
+        std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+        stream.write(strings.data(), strings.size());
+        if (!stream)
+        {
+            throw std::logic_error("Failed to write metadata cache: " + tempPath);
+        }
+    }
+
+    // the old file can not be replaced while it is mapped on windows
+    m_File.reset();
+    std::error_code error;
+    std::filesystem::rename(tempPath, m_Path, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+        map();
+        throw std::logic_error("Failed to replace metadata cache: " + m_Path);
+    }
+
+    m_Updates.clear();
+    map();
+}
+
+}
@@ -0,0 +1,341 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audio/audiometadatascanner.h"
+#include "audio/audioalbumartcache.h"
+#include "audio/audiometadata.h"
+#include "audio/audiometadatacache.h"
+#include "audiohash.h"
+#include "audiotagreader.h"
+#include "audioconfig.h"
+
+#include "utils/log.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using namespace utils;
+
+namespace audio
+{
+
+namespace
+{
+
+// Limits the number of files that are being read at the same time
+class IoLimiter
+{
+public:
+    IoLimiter(uint32_t count)
+    : m_Available(count)
+    {
+    }
+
+    void acquire()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Condition.wait(lock, [this] () { return m_Available > 0; });
+        --m_Available;
+    }
+
+    void release()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            ++m_Available;
+        }
+        m_Condition.notify_one();
+    }
+
+private:
+    std::mutex              m_Mutex;
+    std::condition_variable m_Condition;
+    uint32_t                m_Available;
+};
+
+struct IoSlot
+{
+    IoSlot(IoLimiter& limiter) : m_Limiter(limiter) { m_Limiter.acquire(); }
+    ~IoSlot() { m_Limiter.release(); }
+
+    IoLimiter& m_Limiter;
+};
+
+class WorkQueue
+{
+public:
+    void push(std::string path)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Paths.push_back(std::move(path));
+        }
+        m_Condition.notify_one();
+    }
+
+    // Returns false when the queue is finished and empty
+    bool pop(std::string& path)
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Condition.wait(lock, [this] () { return !m_Paths.empty() || m_Finished; });
+        if (m_Paths.empty())
+        {
+            return false;
+        }
+
+        path = std::move(m_Paths.front());
+        m_Paths.pop_front();
+        return true;
+    }
+
+    // No more paths will be added, abort also discards the queued paths
+    void finish(bool abort)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Finished = true;
+            if (abort)
+            {
+                m_Paths.clear();
+            }
+        }
+        m_Condition.notify_all();
+    }
+
+private:
+    std::mutex              m_Mutex;
+    std::condition_variable m_Condition;
+    std::deque<std::string> m_Paths;
+    bool                    m_Finished = false;
+};
+
+bool isSupported(const std::string& path)
+{
+#ifdef HAVE_TAGLIB
+    return Metadata::isSupported(path);
+#else
+    return TagReader::isSupported(path);
+#endif
+}
+
+TrackMetadata readTrack(const std::string& path, const MetadataScanner::Options& options, IoLimiter& ioLimiter, StringArena& arena)
+{
+    MetadataFields fields;
+    bool needAlbumArt = options.hashAlbumArt || options.albumArtCache;
+#ifdef HAVE_TAGLIB
+    std::unique_ptr<Metadata> meta;
+#endif
+
+    {
+        IoSlot slot(ioLimiter);
+
+        // the native readers do not extract album art
+        arena.clear();
+        if (!options.nativeReaders || needAlbumArt || !TagReader::read(path, options.readAudioProperties, arena, fields))
+        {
+#ifdef HAVE_TAGLIB
+            // the tags are parsed when the file is opened, reading the fields does not touch the file
+            meta = std::make_unique<Metadata>(path, options.readAudioProperties ? Metadata::ReadAudioProperties::Yes : Metadata::ReadAudioProperties::No);
+#else
+            throw std::logic_error("Unsupported file: " + path);
+#endif
+        }
+    }
+
+#ifdef HAVE_TAGLIB
+    if (meta)
+    {
+        arena.clear();
+        fields = meta->readAll(arena);
+    }
+#endif
+
+    TrackMetadata track;
+    track.path          = path;
+    track.artist        = fields.artist;
+    track.title         = fields.title;
+    track.album         = fields.album;
+    track.albumArtist   = fields.albumArtist;
+    track.genre         = fields.genre;
+    track.composer      = fields.composer;
+    track.discNr        = fields.discNr;
+    track.year          = fields.year;
+    track.trackNr       = fields.trackNr;
+    track.bitRate       = fields.bitRate;
+    track.sampleRate    = fields.sampleRate;
+    track.channels      = fields.channels;
+    track.duration      = fields.duration;
+
+#ifdef HAVE_TAGLIB
+    if (meta && options.albumArtCache)
+    {
+        track.albumArtHash = options.albumArtCache->store(meta->getAlbumArtView());
+    }
+    else if (meta && options.hashAlbumArt)
+    {
+        auto art = meta->getAlbumArtView();
+        track.albumArtHash = art.empty() ? 0 : hashData(art.pData, art.size);
+    }
+#endif
+
+    return track;
+}
+
+// The optional fields readTrack fills in with these options
+uint32_t cacheFields(const MetadataScanner::Options& options)
+{
+    uint32_t fields = 0;
+    if (options.readAudioProperties)
+    {
+        fields |= MetadataCache::AudioProperties;
+    }
+
+    if (options.hashAlbumArt || options.albumArtCache)
+    {
+        fields |= MetadataCache::AlbumArtHash;
+    }
+
+    return fields;
+}
+
+// The images of the album art cache can be removed independently of the metadata cache
+bool albumArtAvailable(const TrackMetadata& track, const MetadataScanner::Options& options)
+{
+    return !options.albumArtCache || track.albumArtHash == 0 || options.albumArtCache->contains(track.albumArtHash);
+}
+
+}
+
+MetadataScanner::MetadataScanner()
+: MetadataScanner(Options())
+{
+}
+
+MetadataScanner::MetadataScanner(const Options& options)
+: m_Options(options)
+, m_Cancelled(false)
+{
+    if (m_Options.threads == 0)
+    {
+        m_Options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_Options.maxOpenFiles = std::max(1u, m_Options.maxOpenFiles);
+}
+
+uint64_t MetadataScanner::scan(const std::vector<std::string>& paths, const TrackCallback& onTrack, const ErrorCallback& onError)
+{
+    m_Cancelled = false;
+
+    WorkQueue queue;
+    IoLimiter ioLimiter(m_Options.maxOpenFiles);
+    std::mutex callbackMutex;
+    std::atomic<uint64_t> trackCount(0);
+
+    auto worker = [&] () {
+        std::string path;
+        StringArena arena(4096);
+        while (!m_Cancelled && queue.pop(path))
+        {
+            TrackMetadata track;
+
+            try
+            {
+                FileStamp stamp;
+                auto fields = cacheFields(m_Options);
+                bool cacheable = m_Options.cache && FileStamp::get(path, stamp);
+                if (!cacheable || !m_Options.cache->lookup(path, stamp, fields, track) || !albumArtAvailable(track, m_Options))
+                {
+                    track = readTrack(path, m_Options, ioLimiter, arena);
+                    if (cacheable)
+                    {
+                        m_Options.cache->store(path, stamp, fields, track);
+                    }
+                }
+            }
+            catch (std::exception& e)
+            {
+                std::lock_guard<std::mutex> lock(callbackMutex);
+                if (onError)
+                {
+                    onError(path, e.what());
+                }
+                else
+                {
+                    log::warn("Failed to read metadata of {}: {}", path, e.what());
+                }
+                continue;
+            }
+
+            ++trackCount;
+            std::lock_guard<std::mutex> lock(callbackMutex);
+            onTrack(track);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < m_Options.threads; ++i)
+    {
+        workers.emplace_back(worker);
+    }
+
+    // error codes are used so unreadable directories are skipped instead of aborting the scan
+    for (auto& path : paths)
+    {
+        std::error_code error;
+        if (!std::filesystem::is_directory(path, error))
+        {
+            queue.push(path);
+            continue;
+        }
+
+        std::filesystem::recursive_directory_iterator iter(path, std::filesystem::directory_options::skip_permission_denied, error);
+        for (; !error && !m_Cancelled && iter != std::filesystem::recursive_directory_iterator(); iter.increment(error))
+        {
+            if (iter->is_regular_file(error) && isSupported(iter->path().string()))
+            {
+                queue.push(iter->path().string());
+            }
+        }
+
+        if (error)
+        {
+            log::warn("Failed to scan directory {}: {}", path, error.message());
+        }
+    }
+
+    queue.finish(m_Cancelled);
+    for (auto& thread : workers)
+    {
+        thread.join();
+    }
+
+    return trackCount;
+}
+
+void MetadataScanner::cancel()
+{
+    m_Cancelled = true;
+}
+
+}
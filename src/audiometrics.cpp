@@ -0,0 +1,184 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audio/audiometrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace audio
+{
+
+std::atomic<bool> Metrics::s_Enabled(false);
+
+void Metrics::setEnabled(bool enabled)
+{
+    s_Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+double HistogramSnapshot::mean() const
+{
+    return count == 0 ? 0.0 : static_cast<double>(sum) / count;
+}
+
+uint64_t HistogramSnapshot::percentile(double percent) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    auto target = static_cast<uint64_t>(std::ceil(count * std::clamp(percent, 0.0, 100.0) / 100.0));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < NumBuckets; ++i)
+    {
+        cumulative += buckets[i];
+        if (cumulative >= std::max<uint64_t>(target, 1))
+        {
+            uint64_t upperBound = i == 0 ? 0 : (uint64_t(1) << i) - 1;
+            return std::min(upperBound, max);
+        }
+    }
+
+    return max;
+}
+
+void HistogramSnapshot::add(const HistogramSnapshot& other)
+{
+    for (size_t i = 0; i < NumBuckets; ++i)
+    {
+        buckets[i] += other.buckets[i];
+    }
+
+    count += other.count;
+    sum   += other.sum;
+    max    = std::max(max, other.max);
+}
+
+void Histogram::record(uint64_t value)
+{
+    if (!Metrics::isEnabled())
+    {
+        return;
+    }
+
+    size_t bucket = 0;
+    for (uint64_t remaining = value; remaining != 0 && bucket < HistogramSnapshot::NumBuckets - 1; remaining >>= 1)
+    {
+        ++bucket;
+    }
+
+    m_Buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_Count.fetch_add(1, std::memory_order_relaxed);
+    m_Sum.fetch_add(value, std::memory_order_relaxed);
+
+    auto max = m_Max.load(std::memory_order_relaxed);
+    while (value > max && !m_Max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+    // the values are not read atomically as a whole, good enough for monitoring
+    HistogramSnapshot snapshot;
+    for (size_t i = 0; i < HistogramSnapshot::NumBuckets; ++i)
+    {
+        snapshot.buckets[i] = m_Buckets[i].load(std::memory_order_relaxed);
+    }
+
+    snapshot.count = m_Count.load(std::memory_order_relaxed);
+    snapshot.sum   = m_Sum.load(std::memory_order_relaxed);
+    snapshot.max   = m_Max.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void Histogram::reset()
+{
+    for (auto& bucket : m_Buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+
+    m_Count.store(0, std::memory_order_relaxed);
+    m_Sum.store(0, std::memory_order_relaxed);
+    m_Max.store(0, std::memory_order_relaxed);
+}
+
+ScopedTimer::ScopedTimer(Histogram& histogram)
+: m_pHistogram(Metrics::isEnabled() ? &histogram : nullptr)
+{
+    if (m_pHistogram)
+    {
+        m_Start = std::chrono::steady_clock::now();
+    }
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    if (m_pHistogram)
+    {
+        auto elapsed = std::chrono::steady_clock::now() - m_Start;
+        m_pHistogram->record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+}
+
+void MetricsSnapshot::add(const MetricsSnapshot& other)
+{
+    for (auto& [name, value] : other.counters)
+    {
+        counters[name] += value;
+    }
+
+    for (auto& [name, histogram] : other.histograms)
+    {
+        histograms[name].add(histogram);
+    }
+}
+
+void RendererMetrics::snapshot(MetricsSnapshot& snapshot, const std::string& prefix) const
+{
+    snapshot.counters[prefix + "underruns"]     = underruns.value();
+    snapshot.counters[prefix + "bytes_queued"]  = bytesQueued.value();
+}
+
+void DecoderMetrics::snapshot(MetricsSnapshot& snapshot, const std::string& prefix) const
+{
+    snapshot.counters[prefix + "frames_decoded"]    = framesDecoded.value();
+    snapshot.counters[prefix + "decode_errors"]     = decodeErrors.value();
+    snapshot.histograms[prefix + "decode_time_us"]  = decodeTime.snapshot();
+}
+
+void DecoderMetrics::reset()
+{
+    framesDecoded.reset();
+    decodeErrors.reset();
+    decodeTime.reset();
+}
+
+void PlaybackMetrics::snapshot(MetricsSnapshot& snapshot, const std::string& prefix) const
+{
+    snapshot.counters[prefix + "wake_ups"]                  = wakeUps.value();
+    snapshot.counters[prefix + "commands"]                  = commands.value();
+    snapshot.counters[prefix + "seeks"]                     = seeks.value();
+    snapshot.counters[prefix + "rebuffers"]                 = rebuffers.value();
+    snapshot.counters[prefix + "tracks_started"]            = tracksStarted.value();
+    snapshot.histograms[prefix + "buffer_fill_ms"]          = bufferFill.snapshot();
+    snapshot.histograms[prefix + "track_start_latency_us"]  = trackStartLatency.snapshot();
+}
+
+}
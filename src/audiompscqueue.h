@@ -0,0 +1,90 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef AUDIO_MPSC_QUEUE_H
+#define AUDIO_MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+namespace audio
+{
+
+// Unbounded lock free queue with multiple producers and a single consumer
+// push never blocks, pop may only be called from the consumer thread.
+// A pop can miss an element of which the push has not completed yet, producers
+// have to wake up the consumer after pushing.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue()
+    : m_pHead(new Node())
+    , m_pTail(m_pHead.load())
+    {
+    }
+
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(value))
+        {
+        }
+
+        delete m_pTail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value)
+    {
+        auto pNode = new Node();
+        pNode->value = std::move(value);
+
+        auto pPrev = m_pHead.exchange(pNode, std::memory_order_acq_rel);
+        pPrev->pNext.store(pNode, std::memory_order_release);
+    }
+
+    bool pop(T& value)
+    {
+        auto pTail = m_pTail;
+        auto pNext = pTail->pNext.load(std::memory_order_acquire);
+        if (pNext == nullptr)
+        {
+            return false;
+        }
+
+        value = std::move(pNext->value);
+        m_pTail = pNext;
+        delete pTail;
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        std::atomic<Node*>  pNext { nullptr };
+        T                   value;
+    };
+
+    std::atomic<Node*>      m_pHead;
+    Node*                   m_pTail;
+};
+
+}
+
+#endif
@@ -0,0 +1,433 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "audiomultirenderer.h"
+
+#include "utils/log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using namespace utils;
+
+namespace audio
+{
+
+// interval between two position measurements of an output
+static const auto DRIFT_INTERVAL = std::chrono::seconds(1);
+static const double ERROR_SMOOTHING = 0.3;
+// PI controller that turns the position error (in seconds) into a resample ratio
+static const double PROPORTIONAL_GAIN = 0.01;
+static const double INTEGRAL_GAIN = 0.00005;
+// maximum rate correction (0.1%), inaudible but far above the drift of real devices
+static const double MAX_CORRECTION = 0.001;
+// larger errors (e.g. after an underrun) are corrected by dropping or inserting audio
+static const double MAX_ERROR = 0.05;
+
+template <typename T>
+static float toFloat(T sample);
+
+template <>
+float toFloat<int16_t>(int16_t sample)
+{
+    return sample / 32768.f;
+}
+
+template <>
+float toFloat<int32_t>(int32_t sample)
+{
+    return static_cast<float>(sample / 2147483648.0);
+}
+
+template <>
+float toFloat<float>(float sample)
+{
+    return sample;
+}
+
+template <typename T>
+static T fromFloat(float sample);
+
+template <>
+int16_t fromFloat<int16_t>(float sample)
+{
+    return static_cast<int16_t>(std::clamp<long>(std::lrint(sample * 32768.f), -32768, 32767));
+}
+
+template <>
+int32_t fromFloat<int32_t>(float sample)
+{
+    return static_cast<int32_t>(std::clamp<long long>(std::llrint(sample * 2147483648.0), std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()));
+}
+
+template <>
+float fromFloat<float>(float sample)
+{
+    return sample;
+}
+
+void MultiRenderer::DriftResampler::setFormat(const Format& format)
+{
+    m_Format = format;
+    reset();
+}
+
+bool MultiRenderer::DriftResampler::isSupported() const
+{
+    return m_Format.bits == 32 || (m_Format.bits == 16 && !m_Format.floatingPoint);
+}
+
+void MultiRenderer::DriftResampler::reset()
+{
+    m_Position = 0.0;
+    m_LastFrame.assign(m_Format.numChannels, 0.f);
+}
+
+void MultiRenderer::DriftResampler::skip(double frames)
+{
+    m_Position += frames;
+}
+
+void MultiRenderer::DriftResampler::process(const uint8_t* pData, size_t dataSize, double ratio, std::vector<uint8_t>& output)
+{
+    auto numFrames = dataSize / (m_Format.numChannels * (m_Format.bits / 8));
+    auto step      = 1.0 / ratio;
+
+    if (m_Format.floatingPoint)
+    {
+        process(reinterpret_cast<const float*>(pData), numFrames, step, output);
+    }
+    else if (m_Format.bits == 16)
+    {
+        process(reinterpret_cast<const int16_t*>(pData), numFrames, step, output);
+    }
+    else
+    {
+        process(reinterpret_cast<const int32_t*>(pData), numFrames, step, output);
+    }
+}
+
+template <typename T>
+void MultiRenderer::DriftResampler::process(const T* pInput, size_t numFrames, double step, std::vector<uint8_t>& output)
+{
+    auto numChannels = m_Format.numChannels;
+    auto sample = [&] (int64_t frame, uint32_t channel) -> float {
+        if (frame >= 0)
+        {
+            return toFloat<T>(pInput[frame * numChannels + channel]);
+        }
+
+        // frame -1 is the last frame of the previous block, before that is inserted silence
+        return frame == -1 ? m_LastFrame[channel] : 0.f;
+    };
+
+    auto maxFrames = static_cast<size_t>(std::max(0.0, (numFrames - m_Position) / step)) + 1;
+    output.resize(maxFrames * numChannels * sizeof(T));
+    auto pOutput = reinterpret_cast<T*>(output.data());
+
+    size_t outputFrames = 0;
+    while (outputFrames < maxFrames)
+    {
+        auto index = static_cast<int64_t>(std::floor(m_Position));
+        if (index + 1 >= static_cast<int64_t>(numFrames))
+        {
+            // the next frame is in the next block
+            break;
+        }
+
+        auto fraction = static_cast<float>(m_Position - index);
+        for (uint32_t channel = 0; channel < numChannels; ++channel)
+        {
+            float current = sample(index, channel);
+            *pOutput++ = fromFloat<T>(current + (sample(index + 1, channel) - current) * fraction);
+        }
+
+        ++outputFrames;
+        m_Position += step;
+    }
+
+    output.resize(outputFrames * numChannels * sizeof(T));
+
+    m_Position -= numFrames;
+    if (numFrames > 0)
+    {
+        for (uint32_t channel = 0; channel < numChannels; ++channel)
+        {
+            m_LastFrame[channel] = sample(numFrames - 1, channel);
+        }
+    }
+}
+
+MultiRenderer::MultiRenderer(std::vector<std::unique_ptr<IRenderer>> outputs)
+{
+    if (outputs.empty())
+    {
+        throw std::logic_error("MultiRenderer: no outputs provided");
+    }
+
+    for (auto& renderer : outputs)
+    {
+        renderer->SpaceAvailable.connect([this] () { SpaceAvailable(); }, this);
+
+        Output output;
+        output.renderer = std::move(renderer);
+        m_Outputs.push_back(std::move(output));
+    }
+
+    m_Outputs.front().renderer->VolumeChanged.connect([this] (int32_t volume) { VolumeChanged(volume); }, this);
+}
+
+MultiRenderer::~MultiRenderer()
+{
+    m_Outputs.front().renderer->VolumeChanged.disconnect(this);
+    for (auto& output : m_Outputs)
+    {
+        output.renderer->SpaceAvailable.disconnect(this);
+    }
+}
+
+void MultiRenderer::setFormat(const Format& format)
+{
+    m_Format = format;
+    for (auto& output : m_Outputs)
+    {
+        output.renderer->setFormat(format);
+        output.resampler.setFormat(format);
+    }
+
+    if (m_Outputs.size() > 1 && !m_Outputs.back().resampler.isSupported())
+    {
+        log::warn("MultiRenderer: no drift compensation for {} bit audio", format.bits);
+    }
+}
+
+void MultiRenderer::play()
+{
+    for (auto& output : m_Outputs)
+    {
+        output.renderer->play();
+    }
+}
+
+void MultiRenderer::pause()
+{
+    for (auto& output : m_Outputs)
+    {
+        output.renderer->pause();
+    }
+}
+
+void MultiRenderer::resume()
+{
+    for (auto& output : m_Outputs)
+    {
+        output.renderer->resume();
+    }
+}
+
+void MultiRenderer::stop(bool drain)
+{
+    for (auto& output : m_Outputs)
+    {
+        output.renderer->stop(drain);
+
+        // the drift of the device does not change, so the integral is kept
+        output.resampler.reset();
+        output.error    = 0.0;
+        output.measured = false;
+    }
+}
+
+void MultiRenderer::setVolume(int32_t volume)
+{
+    for (auto& output : m_Outputs)
+    {
+        output.renderer->setVolume(volume);
+    }
+}
+
+int32_t MultiRenderer::getVolume()
+{
+    return m_Outputs.front().renderer->getVolume();
+}
+
+void MultiRenderer::setMute(bool enabled)
+{
+    for (auto& output : m_Outputs)
+    {
+        output.renderer->setMute(enabled);
+    }
+}
+
+bool MultiRenderer::getMute()
+{
+    return m_Outputs.front().renderer->getMute();
+}
+
+bool MultiRenderer::isPlaying()
+{
+    return m_Outputs.front().renderer->isPlaying();
+}
+
+bool MultiRenderer::hasBufferSpace(uint32_t dataSize)
+{
+    return std::all_of(m_Outputs.begin(), m_Outputs.end(), [=] (Output& output) {
+        return output.renderer->hasBufferSpace(dataSize);
+    });
+}
+
+double MultiRenderer::getBufferDuration()
+{
+    // the output with the least audio buffered determines when more is needed
+    double duration = std::numeric_limits<double>::max();
+    for (auto& output : m_Outputs)
+    {
+        duration = std::min(duration, output.renderer->getBufferDuration());
+    }
+
+    return duration;
+}
+
+bool MultiRenderer::flushTail(double fadeDuration)
+{
+    // when one of the outputs does not support it the playback stops all outputs anyway
+    bool flushed = true;
+    for (auto& output : m_Outputs)
+    {
+        flushed = output.renderer->flushTail(fadeDuration) && flushed;
+    }
+
+    return flushed;
+}
+
+void MultiRenderer::setPreRoll(double duration)
+{
+    for (auto& output : m_Outputs)
+    {
+        output.renderer->setPreRoll(duration);
+    }
+}
+
+void MultiRenderer::flushBuffers()
+{
+    for (auto& output : m_Outputs)
+    {
+        output.renderer->flushBuffers();
+    }
+
+    auto& master = *m_Outputs.front().renderer;
+    if (m_Outputs.size() > 1 && master.isPlaying())
+    {
+        double masterPts = master.getCurrentPts();
+        for (auto iter = m_Outputs.begin() + 1; iter != m_Outputs.end(); ++iter)
+        {
+            measureDrift(*iter, masterPts);
+        }
+    }
+}
+
+void MultiRenderer::queueFrame(const Frame& frame)
+{
+    m_Metrics.bytesQueued.increment(frame.getDataSize());
+    m_Outputs.front().renderer->queueFrame(frame);
+
+    for (auto iter = m_Outputs.begin() + 1; iter != m_Outputs.end(); ++iter)
+    {
+        auto& output = *iter;
+        if (!output.resampler.isSupported())
+        {
+            output.renderer->queueFrame(frame);
+            continue;
+        }
+
+        output.resampler.process(frame.getFrameData(), frame.getDataSize(), output.ratio, output.buffer);
+        if (output.buffer.empty())
+        {
+            continue;
+        }
+
+        m_Frame.setFrameData(output.buffer.data());
+        m_Frame.setDataSize(output.buffer.size());
+        m_Frame.setPts(frame.getPts());
+        output.renderer->queueFrame(m_Frame);
+    }
+}
+
+double MultiRenderer::getCurrentPts()
+{
+    return m_Outputs.front().renderer->getCurrentPts();
+}
+
+PlaybackPosition MultiRenderer::getPlaybackPosition() const
+{
+    return m_Outputs.front().renderer->getPlaybackPosition();
+}
+
+void MultiRenderer::getMetrics(MetricsSnapshot& snapshot, const std::string& prefix) const
+{
+    // the metrics per output, the underruns of all outputs are summed up
+    m_Metrics.snapshot(snapshot, prefix);
+
+    uint64_t underruns = 0;
+    for (size_t i = 0; i < m_Outputs.size(); ++i)
+    {
+        auto outputPrefix = prefix + "output" + std::to_string(i) + ".";
+        m_Outputs[i].renderer->getMetrics(snapshot, outputPrefix);
+        underruns += snapshot.counters[outputPrefix + "underruns"];
+    }
+
+    snapshot.counters[prefix + "underruns"] = underruns;
+}
+
+void MultiRenderer::measureDrift(Output& output, double masterPts)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now < output.nextMeasurement || !output.renderer->isPlaying() || !output.resampler.isSupported())
+    {
+        return;
+    }
+
+    // positive when the output is ahead of the master
+    double error = output.renderer->getCurrentPts() - masterPts;
+    if (std::abs(error) > MAX_ERROR)
+    {
+        log::debug("MultiRenderer: output is {:.3f}s off, realigning", error);
+        output.resampler.skip(-error * m_Format.rate);
+        output.error    = 0.0;
+        output.measured = false;
+
+        // the correction is only audible after the buffered audio is played
+        auto buffered = std::chrono::duration<double>(output.renderer->getBufferDuration());
+        output.nextMeasurement = now + DRIFT_INTERVAL + std::chrono::duration_cast<std::chrono::steady_clock::duration>(buffered);
+        return;
+    }
+
+    output.error    = output.measured ? output.error + ERROR_SMOOTHING * (error - output.error) : error;
+    output.measured = true;
+
+    double interval    = std::chrono::duration<double>(DRIFT_INTERVAL).count();
+    double maxIntegral = MAX_CORRECTION / INTEGRAL_GAIN;
+    output.integral = std::clamp(output.integral + output.error * interval, -maxIntegral, maxIntegral);
+
+    // an output that is ahead receives more samples so it slows down
+    double correction = PROPORTIONAL_GAIN * output.error + INTEGRAL_GAIN * output.integral;
+    output.ratio = 1.0 + std::clamp(correction, -MAX_CORRECTION, MAX_CORRECTION);
+    output.nextMeasurement = now + DRIFT_INTERVAL;
+}
+
+}
@@ -0,0 +1,106 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef MULTI_RENDERER_H
+#define MULTI_RENDERER_H
+
+#include "audio/audioformat.h"
+#include "audio/audioframe.h"
+#include "audio/audiorenderer.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace audio
+{
+
+// Plays the same audio on several renderers
+// The first renderer is the master, the other outputs are kept aligned to it
+// by measuring their position and slightly resampling the audio they receive.
+class MultiRenderer : public IRenderer
+{
+public:
+    MultiRenderer(std::vector<std::unique_ptr<IRenderer>> outputs);
+    ~MultiRenderer();
+
+    void setFormat(const Format& format) override;
+
+    void play() override;
+    void pause() override;
+    void resume() override;
+    void stop(bool drain) override;
+    void setVolume(int32_t volume) override;
+    int32_t getVolume() override;
+    void setMute(bool enabled) override;
+    bool getMute() override;
+
+    bool isPlaying() override;
+
+    bool hasBufferSpace(uint32_t dataSize) override;
+    double getBufferDuration() override;
+    void flushBuffers() override;
+    void queueFrame(const Frame& frame) override;
+    bool flushTail(double fadeDuration) override;
+    void setPreRoll(double duration) override;
+
+    double getCurrentPts() override;
+    PlaybackPosition getPlaybackPosition() const override;
+    void getMetrics(MetricsSnapshot& snapshot, const std::string& prefix) const override;
+
+private:
+    // Stateful linear interpolation resampler for small rate corrections
+    class DriftResampler
+    {
+    public:
+        void setFormat(const Format& format);
+        bool isSupported() const;
+        void reset();
+        // positive: drop frames, negative: insert silence
+        void skip(double frames);
+        void process(const uint8_t* pData, size_t dataSize, double ratio, std::vector<uint8_t>& output);
+
+    private:
+        template <typename T>
+        void process(const T* pInput, size_t numFrames, double step, std::vector<uint8_t>& output);
+
+        Format              m_Format;
+        double              m_Position = 0.0;
+        std::vector<float>  m_LastFrame;
+    };
+
+    struct Output
+    {
+        std::unique_ptr<IRenderer>  renderer;
+        DriftResampler              resampler;
+        std::vector<uint8_t>        buffer;
+        double                      ratio = 1.0;
+        double                      error = 0.0;
+        double                      integral = 0.0;
+        bool                        measured = false;
+        std::chrono::steady_clock::time_point nextMeasurement;
+    };
+
+    void measureDrift(Output& output, double masterPts);
+
+    std::vector<Output>     m_Outputs;
+    Format                  m_Format;
+    Frame                   m_Frame;
+};
+
+}
+
+#endif
@@ -0,0 +1,331 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "audionullrenderer.h"
+
+#include "audio/audioframe.h"
+#include "utils/log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+using namespace utils;
+
+namespace audio
+{
+
+// amount of audio that is buffered when pacing at real time
+static const double BUFFER_DURATION = 0.5;
+
+NullRenderer::NullRenderer(Pacing pacing)
+: m_Pacing(pacing)
+, m_BytesPerSecond(0)
+, m_Volume(100)
+, m_Muted(false)
+, m_Playing(false)
+, m_QueuedBytes(0)
+, m_ConsumedFromFront(0)
+, m_CurrentPts(0.0)
+, m_Remainder(0.0)
+, m_Starved(false)
+, m_LastConsume(Clock::now())
+, m_LatencySum(0.0)
+{
+}
+
+NullRenderer::~NullRenderer()
+{
+    log::info("NullRenderer: frames ({}) bytes ({}) underruns ({}) underrun duration ({:.3f}s) latency min ({:.3f}s) max ({:.3f}s) avg ({:.3f}s)",
+        m_Stats.framesQueued, m_Stats.bytesQueued, m_Stats.underruns, m_Stats.underrunDuration,
+        m_Stats.minLatency, m_Stats.maxLatency, m_Stats.averageLatency);
+}
+
+void NullRenderer::setFormat(const Format& format)
+{
+    if (format.rate == 0 || format.numChannels == 0 || format.bits == 0)
+    {
+        throw std::logic_error("NullRenderer: invalid audio format");
+    }
+
+    if (!(format == m_Format))
+    {
+        // queued audio of the previous format is considered played
+        m_Queue.clear();
+        m_QueuedBytes       = 0;
+        m_ConsumedFromFront = 0;
+    }
+
+    m_Format         = format;
+    m_BytesPerSecond = format.rate * format.numChannels * (format.bits / 8);
+    m_Clock.setSampleRate(format.rate);
+}
+
+void NullRenderer::play()
+{
+    if (!m_Playing)
+    {
+        m_LastConsume = Clock::now();
+        m_Playing     = true;
+        m_Clock.setRunning(true);
+    }
+}
+
+void NullRenderer::pause()
+{
+    consume();
+    m_Playing = false;
+    m_Clock.setRunning(false);
+}
+
+void NullRenderer::resume()
+{
+    play();
+}
+
+void NullRenderer::stop(bool drain)
+{
+    if (drain && m_Playing)
+    {
+        // behave like a device that plays out its buffer
+        consume();
+        std::this_thread::sleep_for(std::chrono::duration<double>(bytesToSeconds(m_QueuedBytes)));
+    }
+
+    m_Playing = false;
+    m_Queue.clear();
+    m_QueuedBytes       = 0;
+    m_ConsumedFromFront = 0;
+    m_CurrentPts        = 0.0;
+    m_Remainder         = 0.0;
+    m_Starved           = false;
+    m_Clock.reset();
+}
+
+void NullRenderer::setVolume(int32_t volume)
+{
+    m_Volume = std::clamp(volume, 0, 100);
+}
+
+int32_t NullRenderer::getVolume()
+{
+    return m_Volume;
+}
+
+void NullRenderer::setMute(bool enabled)
+{
+    m_Muted = enabled;
+}
+
+bool NullRenderer::getMute()
+{
+    return m_Muted;
+}
+
+bool NullRenderer::isPlaying()
+{
+    return m_Playing;
+}
+
+bool NullRenderer::hasBufferSpace(uint32_t /*dataSize*/)
+{
+    if (m_Pacing == Pacing::Unbounded)
+    {
+        return true;
+    }
+
+    consume();
+    return bytesToSeconds(m_QueuedBytes) < BUFFER_DURATION;
+}
+
+double NullRenderer::getBufferDuration()
+{
+    return bytesToSeconds(m_QueuedBytes);
+}
+
+void NullRenderer::flushBuffers()
+{
+    consume();
+}
+
+void NullRenderer::queueFrame(const Frame& frame)
+{
+    if (m_BytesPerSecond == 0)
+    {
+        throw std::logic_error("NullRenderer: no format set before queueing audio");
+    }
+
+    double latency = bytesToSeconds(m_QueuedBytes);
+    std::unique_lock<std::mutex> lock(m_StatsMutex);
+    m_Stats.minLatency = m_Stats.framesQueued == 0 ? latency : std::min(m_Stats.minLatency, latency);
+    m_Stats.maxLatency = std::max(m_Stats.maxLatency, latency);
+    m_LatencySum += latency;
+
+    ++m_Stats.framesQueued;
+    m_Stats.bytesQueued += frame.getDataSize();
+    m_Metrics.bytesQueued.increment(frame.getDataSize());
+    m_Stats.averageLatency = m_LatencySum / m_Stats.framesQueued;
+    lock.unlock();
+
+    double endPts = frame.getPts() + bytesToSeconds(frame.getDataSize());
+    m_Clock.setLimit(endPts);
+
+    if (m_Pacing == Pacing::Unbounded)
+    {
+        // consumed immediately
+        m_CurrentPts = endPts;
+        m_Clock.update(m_CurrentPts, false);
+        return;
+    }
+
+    m_Queue.push_back({frame.getPts(), static_cast<uint32_t>(frame.getDataSize())});
+    m_QueuedBytes += frame.getDataSize();
+    m_Starved = false;
+}
+
+bool NullRenderer::flushTail(double fadeDuration)
+{
+    // there is no audio data to fade, only the amount that is kept matters
+    consume();
+
+    uint64_t frameSize = m_Format.numChannels * (m_Format.bits / 8);
+    uint64_t keep = static_cast<uint64_t>(fadeDuration * m_Format.rate) * frameSize;
+    uint64_t kept = 0;
+    size_t count = 0;
+
+    for (auto& chunk : m_Queue)
+    {
+        if (kept >= keep)
+        {
+            break;
+        }
+
+        uint64_t available = chunk.size - (count == 0 ? m_ConsumedFromFront : 0);
+        if (kept + available > keep)
+        {
+            chunk.size -= static_cast<uint32_t>(kept + available - keep);
+            available = keep - kept;
+        }
+
+        kept += available;
+        ++count;
+    }
+
+    m_Queue.resize(count);
+    m_QueuedBytes = kept;
+
+    if (m_Queue.empty())
+    {
+        m_ConsumedFromFront = 0;
+    }
+    else
+    {
+        m_Clock.setLimit(m_Queue.back().pts + bytesToSeconds(m_Queue.back().size));
+    }
+
+    return true;
+}
+
+double NullRenderer::getCurrentPts()
+{
+    consume();
+    return m_CurrentPts;
+}
+
+void NullRenderer::getMetrics(MetricsSnapshot& snapshot, const std::string& prefix) const
+{
+    m_Metrics.snapshot(snapshot, prefix);
+
+    auto stats = getStatistics();
+    auto toMicroseconds = [] (double seconds) { return static_cast<uint64_t>(std::llround(seconds * 1e6)); };
+
+    snapshot.counters[prefix + "underruns"]             = stats.underruns;
+    snapshot.counters[prefix + "bytes_queued"]          = stats.bytesQueued;
+    snapshot.counters[prefix + "frames_queued"]         = stats.framesQueued;
+    snapshot.counters[prefix + "underrun_duration_us"]  = toMicroseconds(stats.underrunDuration);
+    snapshot.counters[prefix + "latency_min_us"]        = toMicroseconds(stats.minLatency);
+    snapshot.counters[prefix + "latency_max_us"]        = toMicroseconds(stats.maxLatency);
+    snapshot.counters[prefix + "latency_avg_us"]        = toMicroseconds(stats.averageLatency);
+}
+
+NullRenderer::Statistics NullRenderer::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_StatsMutex);
+    return m_Stats;
+}
+
+void NullRenderer::consume()
+{
+    if (m_Pacing == Pacing::Unbounded || m_BytesPerSecond == 0)
+    {
+        return;
+    }
+
+    auto now = Clock::now();
+    std::chrono::duration<double> elapsed = now - m_LastConsume;
+    m_LastConsume = now;
+
+    if (!m_Playing)
+    {
+        return;
+    }
+
+    double bytes = elapsed.count() * m_BytesPerSecond + m_Remainder;
+    auto toConsume = static_cast<uint64_t>(bytes);
+    m_Remainder = bytes - toConsume;
+
+    while (toConsume > 0 && !m_Queue.empty())
+    {
+        auto& chunk = m_Queue.front();
+        auto size = std::min<uint64_t>(toConsume, chunk.size - m_ConsumedFromFront);
+
+        m_ConsumedFromFront += size;
+        m_QueuedBytes       -= size;
+        toConsume           -= size;
+        m_CurrentPts         = chunk.pts + bytesToSeconds(m_ConsumedFromFront);
+
+        if (m_ConsumedFromFront == chunk.size)
+        {
+            m_Queue.pop_front();
+            m_ConsumedFromFront = 0;
+        }
+    }
+
+    if (toConsume > 0)
+    {
+        // the device would have played silence
+        std::lock_guard<std::mutex> lock(m_StatsMutex);
+        if (!m_Starved)
+        {
+            ++m_Stats.underruns;
+            m_Metrics.underruns.increment();
+            m_Starved = true;
+        }
+
+        m_Stats.underrunDuration += bytesToSeconds(toConsume);
+        m_Remainder = 0.0;
+    }
+
+    m_Clock.update(m_CurrentPts, !m_Starved);
+}
+
+double NullRenderer::bytesToSeconds(uint64_t bytes) const
+{
+    return m_BytesPerSecond == 0 ? 0.0 : bytes / static_cast<double>(m_BytesPerSecond);
+}
+
+}
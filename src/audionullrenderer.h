@@ -0,0 +1,118 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef NULL_RENDERER_H
+#define NULL_RENDERER_H
+
+#include "audio/audioformat.h"
+#include "audio/audiorenderer.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+namespace audio
+{
+
+// Renderer that does not need an audio device, the audio is consumed
+// at real time speed or as fast as it is queued
+class NullRenderer : public IRenderer
+{
+public:
+    enum class Pacing
+    {
+        RealTime,
+        Unbounded
+    };
+
+    struct Statistics
+    {
+        uint64_t    framesQueued = 0;
+        uint64_t    bytesQueued = 0;
+        uint32_t    underruns = 0;
+        double      underrunDuration = 0.0; // seconds of audio that could not be played
+        double      minLatency = 0.0;       // buffered audio at the time a frame was queued
+        double      maxLatency = 0.0;
+        double      averageLatency = 0.0;
+    };
+
+    NullRenderer(Pacing pacing);
+    ~NullRenderer();
+
+    void setFormat(const Format& format) override;
+
+    void play() override;
+    void pause() override;
+    void resume() override;
+    void stop(bool drain) override;
+    void setVolume(int32_t volume) override;
+    int32_t getVolume() override;
+    void setMute(bool enabled) override;
+    bool getMute() override;
+
+    bool isPlaying() override;
+
+    bool hasBufferSpace(uint32_t dataSize) override;
+    double getBufferDuration() override;
+    void flushBuffers() override;
+    void queueFrame(const Frame& frame) override;
+    bool flushTail(double fadeDuration) override;
+
+    double getCurrentPts() override;
+
+    // The statistics are also part of the metrics (e.g. renderer.latency_max_us), so they are available
+    // through IPlayback::getMetrics, they are collected even when Metrics are disabled
+    void getMetrics(MetricsSnapshot& snapshot, const std::string& prefix) const override;
+
+    // Safe to call from any thread
+    Statistics getStatistics() const;
+
+private:
+    struct Chunk
+    {
+        double      pts;
+        uint32_t    size;
+    };
+
+    void consume();
+    double bytesToSeconds(uint64_t bytes) const;
+
+    using Clock = std::chrono::steady_clock;
+
+    Pacing              m_Pacing;
+    Format              m_Format;
+    uint32_t            m_BytesPerSecond;
+    int32_t             m_Volume;
+    bool                m_Muted;
+    std::atomic<bool>   m_Playing;
+
+    std::deque<Chunk>   m_Queue;
+    uint64_t            m_QueuedBytes;
+    uint64_t            m_ConsumedFromFront;
+    double              m_CurrentPts;
+    double              m_Remainder; // fraction of a byte that is consumed in the next update
+    bool                m_Starved;
+    Clock::time_point   m_LastConsume;
+
+    Statistics          m_Stats;
+    double              m_LatencySum;
+    mutable std::mutex  m_StatsMutex;
+};
+
+}
+
+#endif
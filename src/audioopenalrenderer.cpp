@@ -35,17 +35,29 @@ using namespace utils;
 namespace audio
 {
 
-OpenALRenderer::OpenALRenderer()
+OpenALRenderer::OpenALRenderer(uint32_t numBuffers, uint32_t chunkDuration)
 : m_pAudioDevice(nullptr)
 , m_pAlcContext(nullptr)
 , m_AudioSource(0)
-, m_CurrentBuffer(0)
+, m_AudioBuffers(numBuffers)
 , m_Volume(100)
 , m_Muted(false)
 , m_FloatingPoint(false)
 , m_AudioFormat(AL_FORMAT_STEREO16)
 , m_Frequency(0)
+, m_ChunkDuration(chunkDuration)
+, m_ChunkSize(0)
+, m_OutputFrameSize(0)
+, m_SampleSize(0)
+, m_PendingPts(0.0)
+, m_Started(false)
+, m_Starved(false)
 {
+    if (numBuffers < 2 || chunkDuration == 0)
+    {
+        throw logic_error(fmt::format("OpenAlRenderer: invalid buffer configuration ({} buffers of {} ms)", numBuffers, chunkDuration));
+    }
+
     m_pAudioDevice = alcOpenDevice(nullptr);
 
     if (m_pAudioDevice)
@@ -60,15 +72,17 @@ OpenALRenderer::OpenALRenderer()
         log::warn("Openal creation error {}", err);
     }
 
-    alGenBuffers(NUM_BUFFERS, m_AudioBuffers);
+    alGenBuffers(static_cast<ALsizei>(m_AudioBuffers.size()), m_AudioBuffers.data());
     alGenSources(1, &m_AudioSource);
+    m_FreeBuffers.assign(m_AudioBuffers.begin(), m_AudioBuffers.end());
 }
 
 OpenALRenderer::~OpenALRenderer()
 {
     alSourceStop(m_AudioSource);
+    alSourcei(m_AudioSource, AL_BUFFER, 0);
     alDeleteSources(1, &m_AudioSource);
-    alDeleteBuffers(NUM_BUFFERS, m_AudioBuffers);
+    alDeleteBuffers(static_cast<ALsizei>(m_AudioBuffers.size()), m_AudioBuffers.data());
 
     if (m_pAudioDevice)
     {
@@ -80,9 +94,18 @@ OpenALRenderer::~OpenALRenderer()
 
 void OpenALRenderer::setFormat(const Format& format)
 {
+    // the pending data of the previous format has to be submitted using that format
+    submitChunks(true);
+    if (!m_PendingData.empty())
+    {
+        log::debug("OpenalRenderer: format change, dropping {} bytes of pending audio", m_PendingData.size());
+        m_PendingData.clear();
+    }
+
     m_FloatingPoint = false;
     m_Frequency     = format.rate;
     m_SampleSize    = format.bits / 8;
+    m_Clock.setSampleRate(format.rate);
 
 #ifdef HAVE_FFMPEG
     m_resampler.reset();
@@ -117,67 +140,129 @@ void OpenALRenderer::setFormat(const Format& format)
     default:
         throw logic_error(fmt::format("OpenAlRenderer: unsupported format bitdepth ({})", format.bits));
     }
+
+    m_OutputFrameSize = m_SampleSize * format.numChannels;
+    m_ChunkSize       = (format.rate * m_ChunkDuration / 1000) * m_OutputFrameSize;
+    m_PendingData.reserve(m_ChunkSize * 2);
 }
 
 bool OpenALRenderer::hasBufferSpace(uint32_t /*dataSize*/)
 {
-    int queued = 0;
-    alGetSourcei(m_AudioSource, AL_BUFFERS_QUEUED, &queued);
+    reclaimBuffers();
 
-    if (queued == 0)
+    if (m_ChunkQueue.empty() && m_Started && !m_Starved)
     {
         log::debug("OpenalRenderer: xrun");
+        m_Metrics.underruns.increment();
+        m_Starved = true;
     }
 
-    return queued < NUM_BUFFERS;
+    return !m_FreeBuffers.empty() && m_PendingData.size() < m_ChunkSize;
 }
 
 double OpenALRenderer::getBufferDuration()
 {
-    int queued = 0;
-    alGetSourcei(m_AudioSource, AL_BUFFERS_QUEUED, &queued);
+    double duration = 0.0;
+    for (auto& chunk : m_ChunkQueue)
+    {
+        duration += chunk.duration;
+    }
+
+    if (m_OutputFrameSize > 0)
+    {
+        duration += m_PendingData.size() / static_cast<double>(m_OutputFrameSize * m_Frequency);
+    }
 
-    double singleBufferDuration = static_cast<double>(m_FrameSize / static_cast<double>(m_SampleSize)) / m_Frequency;
-    return queued * singleBufferDuration;
+    return duration;
 }
 
 void OpenALRenderer::queueFrame(const Frame& frame)
 {
+    m_Metrics.bytesQueued.increment(frame.getDataSize());
+    appendFrameData(frame);
+    submitChunks(false);
+}
+
+void OpenALRenderer::appendFrameData(const Frame& frame)
+{
+    if (m_PendingData.empty())
+    {
+        m_PendingPts = frame.getPts();
+    }
+
 #ifdef HAVE_FFMPEG
     if (m_resampler)
     {
         auto frameData = m_resampler->resample(frame.getFrameData(), frame.getDataSize());
-        alBufferData(m_AudioBuffers[m_CurrentBuffer], m_AudioFormat, frameData.data(), static_cast<ALsizei>(frameData.size()), m_Frequency);
+        m_PendingData.insert(m_PendingData.end(), frameData.begin(), frameData.end());
     }
     else
 #endif
         if (m_FloatingPoint)
     {
-        std::vector<int16_t> frameData;
-        frameData.resize(frame.getDataSize() / sizeof(float));
+        auto numSamples = frame.getDataSize() / sizeof(float);
+        auto offset     = m_PendingData.size();
+        m_PendingData.resize(offset + numSamples * sizeof(int16_t));
 
         auto pData = reinterpret_cast<const float*>(frame.getFrameData());
-        for (auto i = 0u; i < frameData.size(); ++i)
+        auto pDest = reinterpret_cast<int16_t*>(m_PendingData.data() + offset);
+        for (auto i = 0u; i < numSamples; ++i)
         {
             float sample = std::clamp(*pData++, -1.f, 1.f);
-            frameData[i] = static_cast<int16_t>(sample * 32768.f);
+            *pDest++ = static_cast<int16_t>(sample * 32767.f);
         }
-
-        alBufferData(m_AudioBuffers[m_CurrentBuffer], m_AudioFormat, frameData.data(), static_cast<ALsizei>(frameData.size() * sizeof(uint16_t)), m_Frequency);
-        m_FrameSize = static_cast<uint32_t>(frameData.size());
     }
     else
     {
         assert(frame.getFrameData());
-        alBufferData(m_AudioBuffers[m_CurrentBuffer], m_AudioFormat, frame.getFrameData(), static_cast<ALsizei>(frame.getDataSize()), m_Frequency);
-        m_FrameSize = static_cast<uint32_t>(frame.getDataSize());
+        m_PendingData.insert(m_PendingData.end(), frame.getFrameData(), frame.getFrameData() + frame.getDataSize());
+    }
+}
+
+void OpenALRenderer::submitChunks(bool allowPartial)
+{
+    if (m_OutputFrameSize == 0)
+    {
+        return;
+    }
+
+    double bytesPerSecond = static_cast<double>(m_OutputFrameSize * m_Frequency);
+
+    size_t offset = 0;
+    while (!m_FreeBuffers.empty())
+    {
+        auto size = std::min<size_t>(m_ChunkSize, m_PendingData.size() - offset);
+        if (size < m_ChunkSize && !allowPartial)
+        {
+            break;
+        }
+
+        size -= size % m_OutputFrameSize;
+        if (size == 0)
+        {
+            break;
+        }
+
+        ALuint buffer = m_FreeBuffers.front();
+        m_FreeBuffers.pop_front();
+
+        alBufferData(buffer, m_AudioFormat, m_PendingData.data() + offset, static_cast<ALsizei>(size), m_Frequency);
+        alSourceQueueBuffers(m_AudioSource, 1, &buffer);
+
+        double duration = size / bytesPerSecond;
+        m_ChunkQueue.push_back({m_PendingPts, duration});
+        m_PendingPts += duration;
+        offset += size;
     }
 
-    alSourceQueueBuffers(m_AudioSource, 1, &m_AudioBuffers[m_CurrentBuffer]);
-    m_PtsQueue.push_back(frame.getPts());
+    if (offset == 0)
+    {
+        return;
+    }
 
-    ++m_CurrentBuffer;
-    m_CurrentBuffer %= NUM_BUFFERS;
+    m_PendingData.erase(m_PendingData.begin(), m_PendingData.begin() + offset);
+    m_Clock.setLimit(m_PendingPts);
+    m_Starved = false;
 
     ALenum err = alGetError();
     if (err != AL_NO_ERROR)
@@ -186,16 +271,17 @@ void OpenALRenderer::queueFrame(const Frame& frame)
     }
 }
 
-void OpenALRenderer::flushBuffers()
+void OpenALRenderer::reclaimBuffers()
 {
     int processed = 0;
     alGetSourcei(m_AudioSource, AL_BUFFERS_PROCESSED, &processed);
 
-    while (processed--)
+    while (processed-- > 0 && !m_ChunkQueue.empty())
     {
         ALuint buffer;
         alSourceUnqueueBuffers(m_AudioSource, 1, &buffer);
-        m_PtsQueue.pop_front();
+        m_FreeBuffers.push_back(buffer);
+        m_ChunkQueue.pop_front();
 
         ALenum err = alGetError();
         if (err != AL_NO_ERROR)
@@ -205,6 +291,31 @@ void OpenALRenderer::flushBuffers()
     }
 }
 
+void OpenALRenderer::flushBuffers()
+{
+    reclaimBuffers();
+
+    // don't wait for a full chunk when the source is about to run dry
+    submitChunks(m_ChunkQueue.size() < 2);
+    updateClock();
+}
+
+double OpenALRenderer::updateClock()
+{
+    if (m_ChunkQueue.empty() || m_Frequency == 0)
+    {
+        return m_Clock.getPosition().pts;
+    }
+
+    // the sample offset is relative to the first buffer that is still queued
+    ALint offset = 0;
+    alGetSourcei(m_AudioSource, AL_SAMPLE_OFFSET, &offset);
+
+    double pts = m_ChunkQueue.front().pts + (offset / static_cast<double>(m_Frequency));
+    m_Clock.update(pts, isPlaying());
+    return pts;
+}
+
 bool OpenALRenderer::isPlaying()
 {
     ALenum state;
@@ -215,9 +326,16 @@ bool OpenALRenderer::isPlaying()
 
 void OpenALRenderer::play()
 {
-    if (!isPlaying() && !m_PtsQueue.empty())
+    if (m_ChunkQueue.empty())
+    {
+        submitChunks(true);
+    }
+
+    if (!isPlaying() && !m_ChunkQueue.empty())
     {
         alSourcePlay(m_AudioSource);
+        m_Clock.setRunning(true);
+        m_Started = true;
     }
 }
 
@@ -226,7 +344,10 @@ void OpenALRenderer::pause()
     if (isPlaying())
     {
         alSourcePause(m_AudioSource);
+        m_Clock.setRunning(false);
     }
+
+    m_Started = false;
 }
 
 void OpenALRenderer::resume()
@@ -237,7 +358,15 @@ void OpenALRenderer::resume()
 void OpenALRenderer::stop(bool /*drain*/)
 {
     alSourceStop(m_AudioSource);
-    flushBuffers();
+
+    // detach all buffers from the source
+    alSourcei(m_AudioSource, AL_BUFFER, 0);
+    m_FreeBuffers.assign(m_AudioBuffers.begin(), m_AudioBuffers.end());
+    m_ChunkQueue.clear();
+    m_PendingData.clear();
+    m_Clock.reset();
+    m_Started = false;
+    m_Starved = false;
 }
 
 void OpenALRenderer::setVolume(int32_t volume)
@@ -273,6 +402,6 @@ bool OpenALRenderer::getMute()
 
 double OpenALRenderer::getCurrentPts()
 {
-    return m_PtsQueue.empty() ? 0 : m_PtsQueue.front();
+    return updateClock();
 }
 }
@@ -22,11 +22,10 @@
 
 #include <deque>
 #include <memory>
+#include <vector>
 #include "audio/audiorenderer.h"
 #include "audioconfig.h"
 
-#define NUM_BUFFERS 100
-
 namespace audio
 {
 
@@ -37,7 +36,12 @@ struct Format;
 class OpenALRenderer : public IRenderer
 {
 public:
-    OpenALRenderer();
+    static const uint32_t DEFAULT_NUM_BUFFERS    = 10;
+    static const uint32_t DEFAULT_CHUNK_DURATION = 50; // milliseconds
+
+    // Decoded frames are coalesced in chunks of chunkDuration milliseconds,
+    // every chunk is submitted in a single OpenAL buffer
+    OpenALRenderer(uint32_t numBuffers = DEFAULT_NUM_BUFFERS, uint32_t chunkDuration = DEFAULT_CHUNK_DURATION);
     virtual ~OpenALRenderer();
 
     // IRenderer
@@ -58,20 +62,37 @@ public:
     double getCurrentPts() override;
 
 private:
+    struct Chunk
+    {
+        double  pts;
+        double  duration;
+    };
+
+    void appendFrameData(const Frame& frame);
+    void submitChunks(bool allowPartial);
+    void reclaimBuffers();
+    double updateClock();
+
     ALCdevice*                  m_pAudioDevice;
     ALCcontext*                 m_pAlcContext;
     ALuint                      m_AudioSource;
-    ALuint                      m_AudioBuffers[NUM_BUFFERS];
-    int32_t                     m_CurrentBuffer;
+    std::vector<ALuint>         m_AudioBuffers;
+    std::deque<ALuint>          m_FreeBuffers;
     int32_t                     m_Volume;
     bool                        m_Muted;
     bool                        m_FloatingPoint;
     ALenum                      m_AudioFormat;
     ALsizei                     m_Frequency;
-    uint32_t                    m_FrameSize; //size one queued audio frame
+    uint32_t                    m_ChunkDuration; //milliseconds
+    uint32_t                    m_ChunkSize; //size of one chunk in bytes
+    uint32_t                    m_OutputFrameSize; //size of one sample frame passed to openal
     uint32_t                    m_SampleSize; //size one audio sample
 
-    std::deque<double>          m_PtsQueue;
+    std::vector<uint8_t>        m_PendingData; //converted audio that is not yet submitted
+    double                      m_PendingPts;
+    std::deque<Chunk>           m_ChunkQueue;
+    bool                        m_Started; //play was called, not paused or stopped since
+    bool                        m_Starved; //the source ran out of queued audio while started
 
 #ifdef HAVE_FFMPEG
     std::unique_ptr<Resampler>  m_resampler;
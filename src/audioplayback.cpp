@@ -25,11 +25,14 @@
 #include "audio/audiodecoder.h"
 #include "audio/audiodecoderfactory.h"
 #include "audio/audioformat.h"
+#include "audio/audioplaybackengine.h"
 #include "audio/audioframe.h"
 #include "audio/audioplaylistinterface.h"
 #include "audio/audiorenderer.h"
 #include "audio/audiorendererfactory.h"
 #include "audio/audiotrackinterface.h"
+#include "audiofade.h"
+#include "audiotracepoints.h"
 #include "utils/log.h"
 #include "utils/timeoperations.h"
 
@@ -40,94 +43,409 @@ using namespace utils;
 namespace audio
 {
 
-Playback::Playback(IPlaylist& playlist, const std::string& appName, const std::string& audioOutput, const std::string& deviceName)
+// maximum time spent decoding in a single step, gives other sessions of an engine a chance to run
+static const auto MAX_DECODE_SLICE = std::chrono::milliseconds(20);
+// number of upcoming tracks that are opened in advance
+static const size_t PREFETCH_TRACKS = 2;
+// duration of the fade out of the old audio and of the fade in of the new audio that follows it when seeking
+static const double SEEK_FADE_DURATION = 0.03;
+
+Playback::Playback(IPlaylist& playlist, const std::string& appName, const std::string& audioOutput, const std::string& deviceName, PlaybackEngine* pEngine)
 : m_Playlist(playlist)
+, m_pEngine(pEngine)
 , m_Destroy(false)
-, m_Stop(false)
 , m_NewTrackStarted(false)
 , m_State(PlaybackState::Stopped)
-, m_SkipTrack(false)
 , m_SeekOccured(false)
-, m_CurrentPts(0)
+, m_CurrentPts(0.0)
+, m_Duration(0.0)
+, m_RendererPlaying(false)
+, m_Volume(100)
+, m_Mute(false)
 , m_AvailableActions(std::set<PlaybackAction>{PlaybackAction::Play})
-, m_PlaybackThread(&Playback::playbackLoop, this)
+, m_SeekTarget(0.0)
+, m_SeekPending(false)
+, m_FadeInFrames(0)
+, m_FadeInPosition(0)
+, m_Buffering(false)
+, m_RendererHeld(false)
+, m_TrackStartPending(false)
+, m_CommandPending(false)
+, m_WakeUp(false)
 {
     try
     {
         m_pAudioRenderer.reset(audio::RendererFactory::create(appName, audioOutput, deviceName));
-        m_pAudioRenderer->VolumeChanged.connect([this](int32_t volume) { VolumeChanged(volume); }, this);
+        m_pAudioRenderer->VolumeChanged.connect([this](int32_t volume) { m_Volume = volume; VolumeChanged(volume); }, this);
+        m_pAudioRenderer->SpaceAvailable.connect([this]() { wakeUp(); }, this);
+        updateRendererState();
     }
     catch (std::exception&)
     {
         log::error("Failed to create audio renderer, sound is disabled");
     }
 
-#ifdef DUMP_TO_WAVE
-    log::critical("Dumping to wave is enabled, we are debugging right?");
-    writeWaveHeader();
-#endif
+    // start the thread when the renderer is available
+    if (m_pEngine)
+    {
+        m_pEngine->addSession(this);
+    }
+    else
+    {
+        m_PlaybackThread = std::thread(&Playback::playbackLoop, this);
+    }
 }
 
 Playback::~Playback()
 {
-    stop();
+    if (m_pEngine)
+    {
+        // once removed the engine no longer runs this session, so finish it on this thread
+        m_pEngine->removeSession(this);
+        postCommand(CommandType::Stop);
+        processCommands();
+    }
+    else
+    {
+        postCommand(CommandType::Stop);
+        postCommand(CommandType::Destroy);
+    }
 
-#ifdef DUMP_TO_WAVE
-    updateWaveHeaderSize();
-#endif
+    if (m_PlaybackThread.joinable())
+    {
+        log::debug("Waiting for playback thread");
+        m_PlaybackThread.join();
+        log::debug("Done waiting");
+    }
+
+    // the background seek wakes us up when it finishes
+    if (m_SeekResult.valid())
+    {
+        m_SeekResult.wait();
+    }
 
     if (m_pAudioRenderer)
     {
         m_pAudioRenderer->VolumeChanged.disconnect(this);
+        m_pAudioRenderer->SpaceAvailable.disconnect(this);
     }
+}
 
+std::future<void> Playback::postCommand(Command command)
+{
+    auto future = command.completion.get_future();
+
+    // the queue is lock free, the mutex is only taken to wake up the playback thread
+    m_Commands.push(std::move(command));
+    m_CommandPending = true;
+    wakeUp();
+
+    return future;
+}
+
+std::future<void> Playback::postCommand(CommandType type)
+{
+    Command command;
+    command.type = type;
+    return postCommand(std::move(command));
+}
+
+void Playback::wakeUp()
+{
+    if (m_pEngine)
+    {
+        m_pEngine->wakeUp(this);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_PlaybackMutex);
+    m_WakeUp = true;
+    m_PlaybackCondition.notify_one();
+}
+
+void Playback::processCommands()
+{
+    // commands that are pushed after clearing the flag set it again
+    m_CommandPending = false;
+
+    Command command;
+    while (m_Commands.pop(command))
+    {
+        m_Metrics.commands.increment();
+
+        if (command.type == CommandType::Seek)
+        {
+            // completed once the new position is playing
+            requestSeek(command.seekPosition, std::move(command.completion));
+            continue;
+        }
+
+        try
+        {
+            executeCommand(command);
+            // the caller sees the effect of the command once it completes
+            updateRendererState();
+            command.completion.set_value();
+        }
+        catch (exception& e)
+        {
+            log::error("Playback error: {}", e.what());
+            command.completion.set_exception(std::current_exception());
+        }
+    }
+}
+
+void Playback::executeCommand(const Command& command)
+{
+    if (command.type == CommandType::Destroy)
     {
-        std::lock_guard<std::mutex> lock(m_PlaybackMutex);
         m_Destroy = true;
-        m_PlaybackCondition.notify_one();
+        return;
     }
 
-    if (m_PlaybackThread.joinable())
+    if (!m_pAudioRenderer)
     {
-        log::debug("Waiting for playback thread");
-        m_PlaybackThread.join();
-        log::debug("Done waiting");
+        return;
+    }
+
+    switch (command.type)
+    {
+    case CommandType::Play:
+        if (m_State == PlaybackState::Stopped)
+        {
+            setPlaybackState(PlaybackState::Playing);
+            startNewTrack();
+        }
+        else if (m_State == PlaybackState::Paused)
+        {
+            // after a seek or while rebuffering the renderer is restarted once it has been filled
+            if (!m_SeekOccured && !m_RendererHeld)
+            {
+                m_pAudioRenderer->resume();
+            }
+
+            m_SeekOccured = false;
+            setPlaybackState(PlaybackState::Playing);
+        }
+        break;
+    case CommandType::Pause:
+        if (m_State == PlaybackState::Playing)
+        {
+            m_pAudioRenderer->pause();
+            setPlaybackState(PlaybackState::Paused);
+        }
+        break;
+    case CommandType::Stop:
+        stopPlayback(false);
+        break;
+    case CommandType::Next:
+        if (m_State != PlaybackState::Stopped)
+        {
+            m_pAudioRenderer->stop(false);
+            m_pAudioRenderer->flushBuffers();
+            m_CurrentPts = 0.0;
+            m_SeekOccured = false;
+            m_RendererHeld = false;
+
+            setPlaybackState(PlaybackState::Playing);
+            startNewTrack();
+        }
+        break;
+    case CommandType::SetVolume:
+        m_pAudioRenderer->setVolume(command.volume);
+        VolumeChanged(m_pAudioRenderer->getVolume());
+        break;
+    case CommandType::SetMute:
+        m_pAudioRenderer->setMute(command.mute);
+        break;
+    case CommandType::SetBufferPolicy:
+        m_pAudioRenderer->setPreRoll(std::chrono::duration<double>(command.bufferPolicy.preRoll).count());
+        {
+            std::lock_guard<std::mutex> lock(m_PlaybackMutex);
+            m_BufferPolicy = command.bufferPolicy;
+        }
+        break;
+    default:
+        break;
     }
 }
 
-bool Playback::startNewTrack()
+void Playback::requestSeek(double position, std::promise<void> completion)
 {
-    auto track = m_Playlist.dequeueNextTrack();
-    if (!track || m_Stop)
+    if (!m_pAudioRenderer || !m_pAudioDecoder || m_State == PlaybackState::Stopped)
     {
-        stopPlayback(true);
-        return false;
+        completion.set_value();
+        return;
+    }
+
+    m_Metrics.seeks.increment();
+    m_SeekTarget  = position;
+    m_SeekPending = true;
+    m_SeekCompletions.push_back(std::move(completion));
+
+    if (!m_SeekResult.valid())
+    {
+        launchSeek(std::move(m_SpareDecoder));
     }
+}
+
+void Playback::launchSeek(std::unique_ptr<IDecoder> decoder)
+{
+    auto uri      = m_CurrentTrack->getUri();
+    auto position = m_SeekTarget;
+
+    m_SeekResult = std::async(std::launch::async, [this, uri, position, decoder = std::move(decoder)] () mutable {
+        SeekResult result;
+        result.uri      = uri;
+        result.position = position;
+
+        try
+        {
+            if (!decoder)
+            {
+                // only the first seek of a track opens the file again
+                decoder.reset(DecoderFactory::create(uri));
+            }
+
+            decoder->seekAbsolute(position);
+            result.decoder = std::move(decoder);
+        }
+        catch (std::exception&)
+        {
+            result.error = std::current_exception();
+        }
 
-    m_CurrentPts = 0.0;
+        wakeUp();
+        return result;
+    });
+}
 
+void Playback::updateSeek()
+{
+    if (!m_SeekResult.valid() || m_SeekResult.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
     {
-        std::lock_guard<std::recursive_mutex> lock(m_DecodeMutex);
+        return;
+    }
+
+    auto result = m_SeekResult.get();
+    if (!m_SeekPending)
+    {
+        // cancelled by a track change
+        return;
+    }
+
+    if (result.error)
+    {
+        for (auto& completion : m_SeekCompletions)
+        {
+            completion.set_exception(result.error);
+        }
+
+        m_SeekCompletions.clear();
+        m_SeekPending = false;
+        return;
+    }
+
+    bool sameTrack = result.uri == m_CurrentTrack->getUri();
+    if (!sameTrack || result.position != m_SeekTarget)
+    {
+        // the target changed while seeking (scrubbing), continue with the latest target
+        launchSeek(sameTrack ? std::move(result.decoder) : nullptr);
+        return;
+    }
+
+    if (m_State != PlaybackState::Playing || !m_pAudioRenderer->isPlaying() || !m_pAudioRenderer->flushTail(SEEK_FADE_DURATION))
+    {
+        m_pAudioRenderer->stop(false);
+        m_pAudioRenderer->flushBuffers();
+        m_SeekOccured  = m_State == PlaybackState::Paused;
+        m_RendererHeld = false;
+    }
+
+    {
+        // the decoder metrics are read with the mutex locked
+        std::lock_guard<std::mutex> lock(m_PlaybackMutex);
+        retireDecoderMetrics();
+        m_SpareDecoder  = std::move(m_pAudioDecoder);
+        m_pAudioDecoder = std::move(result.decoder);
+    }
+
+    // the old audio that is still queued fades out, then the new audio fades in
+    m_FadeInFrames    = static_cast<uint32_t>(SEEK_FADE_DURATION * m_pAudioDecoder->getAudioFormat().rate);
+    m_FadeInPosition  = 0;
+    m_NewTrackStarted = false;
+    m_SeekPending     = false;
+
+    for (auto& completion : m_SeekCompletions)
+    {
+        completion.set_value();
+    }
+
+    m_SeekCompletions.clear();
+}
+
+void Playback::cancelSeek()
+{
+    // a background seek that is still running is discarded when it finishes
+    m_SeekPending = false;
+    m_SpareDecoder.reset();
+
+    for (auto& completion : m_SeekCompletions)
+    {
+        completion.set_value();
+    }
+
+    m_SeekCompletions.clear();
+}
+
+bool Playback::startNewTrack()
+{
+    AUDIO_TRACE_SCOPE("startNewTrack");
+    cancelSeek();
+    m_FadeInFrames      = 0;
+    m_TrackStartTime    = std::chrono::steady_clock::now();
+    m_TrackStartPending = true;
+
+    std::shared_ptr<ITrack> track;
+    std::unique_ptr<IDecoder> decoder;
+
+    while (!decoder)
+    {
+        // the upcoming tracks are opened in parallel, including the one we are about to dequeue
+        m_Prefetcher.prefetch(m_Playlist.peekNextTracks(PREFETCH_TRACKS + 1));
+
+        track = m_Playlist.dequeueNextTrack();
+        if (!track)
+        {
+            stopPlayback(true);
+            return false;
+        }
+
+        m_CurrentPts = 0.0;
+
         try
         {
             log::info("Play track: {}", track->getUri());
-            m_pAudioDecoder.reset(audio::DecoderFactory::create(track->getUri()));
-            m_CurrentTrack = track;
+            decoder = m_Prefetcher.takeDecoder(*track);
         }
         catch (logic_error& e)
         {
+            // skip it, the next track is probably already opened
             log::error("Failed to play audio file: {}", e.what());
-            m_pAudioDecoder.reset();
-            return startNewTrack();
         }
     }
 
-    auto duration = static_cast<uint32_t>(m_pAudioDecoder->getDuration());
-    if (duration != 0)
     {
-        m_Duration = duration;
+        std::lock_guard<std::mutex> lock(m_PlaybackMutex);
+        retireDecoderMetrics();
+        m_pAudioDecoder = std::move(decoder);
+        m_CurrentTrack  = track;
     }
 
+    m_Metrics.tracksStarted.increment();
+
+    m_Duration = static_cast<double>(m_pAudioDecoder->getDuration());
+
     NewTrackStarted(track);
     m_NewTrackStarted = true;
 
@@ -144,100 +462,183 @@ bool Playback::startNewTrack()
     return true;
 }
 
-void Playback::playback(std::unique_lock<std::mutex>& lock)
+Playback::TimePoint Playback::step()
 {
-    if (!startNewTrack())
+    m_Metrics.wakeUps.increment();
+    processCommands();
+    updateSeek();
+
+    // nothing to do until a command arrives
+    auto deadline = TimePoint::max();
+    if (!m_Destroy && m_State == PlaybackState::Playing && m_pAudioDecoder)
     {
-        return;
+        try
+        {
+            deadline = render();
+        }
+        catch (exception& e)
+        {
+            log::error("Playback error: {}", e.what());
+            stopPlayback(false);
+        }
+    }
+
+    updateRendererState();
+    return deadline;
+}
+
+void Playback::updateRendererState()
+{
+    if (m_pAudioRenderer)
+    {
+        m_RendererPlaying = m_pAudioRenderer->isPlaying();
+        m_Volume          = m_pAudioRenderer->getVolume();
+        m_Mute            = m_pAudioRenderer->getMute();
     }
+}
 
-    assert(m_pAudioDecoder);
+Playback::TimePoint Playback::render()
+{
+    // don't hold on to the thread forever when the renderer never runs out of space (file output)
+    auto sliceEnd     = std::chrono::steady_clock::now() + MAX_DECODE_SLICE;
+    bool sliceExpired = false;
 
-    bool frameDecoded = false;
-    bool firstFrame   = true;
+    double highWatermark = std::chrono::duration<double>(m_BufferPolicy.highWatermark).count();
+    auto belowHighWatermark = [&] () {
+        return highWatermark == 0.0 || m_pAudioRenderer->getBufferDuration() < highWatermark;
+    };
 
-    while (!m_Stop)
+    bool bufferFull = false;
+    while (!m_CommandPending)
     {
-        while (!m_Stop && !isPaused() && rendererHasSpace(m_AudioFrame.getDataSize()))
+        if (!m_pAudioRenderer->hasBufferSpace(static_cast<uint32_t>(m_AudioFrame.getDataSize())) || !belowHighWatermark())
         {
-            {
-                // decode the first frame
-                std::lock_guard<std::recursive_mutex> lock(m_DecodeMutex);
-                frameDecoded = m_pAudioDecoder->decodeAudioFrame(m_AudioFrame);
-            }
-
-            if (!frameDecoded)
-            {
-                // we could not decode a frame, end of file probably
-                break;
-            }
+            bufferFull = true;
+            break;
+        }
 
-            if (m_SkipTrack)
-            {
-                if (!startNewTrack())
-                {
-                    return;
-                }
+        if (std::chrono::steady_clock::now() > sliceEnd)
+        {
+            sliceExpired = true;
+            break;
+        }
 
-                firstFrame  = true;
-                m_SkipTrack = false;
-            }
+        bool decoded = false;
+        {
+            AUDIO_TRACE_SCOPE("decodeAudioFrame");
+            decoded = m_pAudioDecoder->decodeAudioFrame(m_AudioFrame);
+        }
 
-            if (isPaused())
+        if (!decoded)
+        {
+            // we could not decode a frame, end of file probably
+            if (!startNewTrack())
             {
-                break;
+                return TimePoint::max();
             }
 
-            m_pAudioRenderer->queueFrame(m_AudioFrame);
-
-#ifdef DUMP_TO_WAVE
-            dumpToWav(m_AudioFrame);
-#endif
+            continue;
         }
 
-        if (firstFrame)
+        if (m_FadeInPosition < m_FadeInFrames)
         {
-            // Start the renderer after adding the first frame
-            firstFrame = false;
-            m_pAudioRenderer->play();
+            auto format = m_pAudioDecoder->getAudioFormat();
+            auto dataSize = static_cast<uint32_t>(m_AudioFrame.getDataSize());
+            applyFade(m_AudioFrame.getFrameData(), dataSize, format, m_FadeInPosition, m_FadeInFrames, FadeDirection::In);
+            m_FadeInPosition += dataSize / (format.numChannels * (format.bits / 8));
         }
 
-        sendProgressIfNeeded();
+        {
+            AUDIO_TRACE_SCOPE("queueFrame");
+            m_pAudioRenderer->queueFrame(m_AudioFrame);
+        }
 
-        if (!frameDecoded && !startNewTrack())
+        if (m_TrackStartPending)
         {
-            log::debug("Stop it {}", frameDecoded);
-            return;
+            m_TrackStartPending = false;
+            m_Metrics.trackStartLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_TrackStartTime).count());
         }
+    }
+
+    updateBuffering(bufferFull);
 
+    {
+        AUDIO_TRACE_SCOPE("flushBuffers");
         m_pAudioRenderer->flushBuffers();
+    }
 
-        if (m_State == PlaybackState::Playing && !m_pAudioRenderer->isPlaying())
-        {
-            log::debug("Kick renderer");
-            m_pAudioRenderer->play();
-        }
-        else
+    sendProgressIfNeeded();
+
+    if (sliceExpired)
+    {
+        return std::chrono::steady_clock::now();
+    }
+
+    // renderers that emit SpaceAvailable wake us up sooner
+    auto wait = std::chrono::duration<double>(m_pAudioRenderer->getBufferDuration() / 3);
+    return std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(wait);
+}
+
+void Playback::updateBuffering(bool bufferFull)
+{
+    double buffered = m_pAudioRenderer->getBufferDuration();
+    m_Metrics.bufferFill.record(static_cast<uint64_t>(buffered * 1000));
+
+    if (m_pAudioRenderer->isPlaying())
+    {
+        double lowWatermark = std::chrono::duration<double>(m_BufferPolicy.lowWatermark).count();
+        if (lowWatermark > 0.0 && buffered < lowWatermark)
         {
-            // don't busy wait
-            m_PlaybackCondition.wait_for(lock, std::chrono::milliseconds(static_cast<long>(m_pAudioRenderer->getBufferDuration() * 1000 / 3)));
+            // the decoder can not keep up, rather pause once than stutter
+            log::warn("Playback: underrun imminent ({:.3f}s buffered), rebuffering", buffered);
+            m_pAudioRenderer->pause();
+            m_RendererHeld = true;
+            m_Metrics.rebuffers.increment();
+            setBuffering(true);
         }
+
+        return;
+    }
+
+    double preRoll = std::chrono::duration<double>(m_BufferPolicy.preRoll).count();
+    if (bufferFull || (preRoll > 0.0 && buffered >= preRoll))
+    {
+        startRenderer();
+    }
+    else
+    {
+        setBuffering(true);
     }
 }
 
-bool Playback::rendererHasSpace(size_t dataSize)
+void Playback::startRenderer()
 {
-    if (m_pAudioRenderer)
+    if (m_RendererHeld)
     {
-        return m_pAudioRenderer->hasBufferSpace(static_cast<uint32_t>(dataSize));
+        m_pAudioRenderer->resume();
+        m_RendererHeld = false;
     }
 
-    return false;
+    if (!m_pAudioRenderer->isPlaying())
+    {
+        m_pAudioRenderer->play();
+    }
+
+    setBuffering(false);
+}
+
+void Playback::setBuffering(bool buffering)
+{
+    if (m_Buffering != buffering)
+    {
+        m_Buffering = buffering;
+        BufferingChanged(buffering);
+    }
 }
 
 void Playback::sendProgressIfNeeded()
 {
-    double pts = m_pAudioRenderer->getCurrentPts();
+    double pts = m_pAudioRenderer->getPlaybackPosition().pts;
 
     if (pts <= 2.0 && m_NewTrackStarted)
     {
@@ -253,45 +654,23 @@ void Playback::sendProgressIfNeeded()
     if ((static_cast<int>(pts) != static_cast<int>(m_CurrentPts)))
     {
         m_CurrentPts = pts;
-        ProgressChanged(m_CurrentPts);
+        ProgressChanged(pts);
     }
 }
 
-void Playback::play()
+std::future<void> Playback::play()
 {
-    std::lock_guard<std::mutex> lock(m_PlaybackMutex);
-
-    if (!m_pAudioRenderer || m_State == PlaybackState::Playing)
-    {
-        return;
-    }
-
-    if (m_State == PlaybackState::Stopped)
-    {
-        m_PlaybackCondition.notify_one();
-    }
-    else if (m_State == PlaybackState::Paused)
-    {
-        m_SeekOccured ? m_pAudioRenderer->play() : m_pAudioRenderer->resume();
-    }
-
-    setPlaybackState(PlaybackState::Playing);
+    return postCommand(CommandType::Play);
 }
 
-void Playback::pause()
+std::future<void> Playback::pause()
 {
-    if (m_pAudioRenderer)
-    {
-        std::lock_guard<std::mutex> lock(m_PlaybackMutex);
-        m_pAudioRenderer->pause();
-        setPlaybackState(PlaybackState::Paused);
-    }
+    return postCommand(CommandType::Pause);
 }
 
-void Playback::stop()
+std::future<void> Playback::stop()
 {
-    std::lock_guard<std::mutex> lock(m_PlaybackMutex);
-    stopPlayback(false);
+    return postCommand(CommandType::Stop);
 }
 
 void Playback::stopPlayback(bool drain)
@@ -299,36 +678,34 @@ void Playback::stopPlayback(bool drain)
     if (m_pAudioRenderer && m_State != PlaybackState::Stopped)
     {
         m_CurrentPts = 0.0;
-        m_Stop       = true;
+
+        if (drain && m_State == PlaybackState::Playing)
+        {
+            // the end of the playlist can be reached before the pre roll was buffered
+            startRenderer();
+        }
 
         m_pAudioRenderer->stop(drain);
+        m_RendererHeld = false;
+        setBuffering(false);
+        cancelSeek();
         setPlaybackState(PlaybackState::Stopped);
         m_SeekOccured     = false;
         m_NewTrackStarted = false;
-        m_PlaybackCondition.notify_one();
     }
 }
 
-void Playback::next()
+std::future<void> Playback::next()
 {
-    if (!m_pAudioRenderer || m_SkipTrack || m_State == PlaybackState::Stopped)
-    {
-        //previous skip not processed yet or we are stopped
-        return;
-    }
-
-    std::lock_guard<std::mutex> lock(m_PlaybackMutex);
-
-    m_SkipTrack = true;
-    m_pAudioRenderer->stop(false);
-    m_pAudioRenderer->flushBuffers();
-    setPlaybackState(PlaybackState::Playing);
-
-    m_CurrentPts = 0.0;
+    return postCommand(CommandType::Next);
 }
 
-void Playback::prev()
+std::future<void> Playback::prev()
 {
+    // not supported, completes immediately
+    std::promise<void> completion;
+    completion.set_value();
+    return completion.get_future();
 }
 
 bool Playback::isPaused() const
@@ -338,35 +715,15 @@ bool Playback::isPaused() const
 
 bool Playback::isPlaying() const
 {
-    return m_pAudioRenderer ? m_pAudioRenderer->isPlaying() : false;
+    return m_RendererPlaying;
 }
 
-void Playback::seek(double seconds)
+std::future<void> Playback::seek(double seconds)
 {
-    if (!m_pAudioDecoder || !m_pAudioRenderer)
-    {
-        return;
-    }
-
-    std::lock_guard<std::mutex> playbackLock(m_PlaybackMutex);
-    m_pAudioRenderer->stop(false);
-    m_pAudioRenderer->flushBuffers();
-
-    {
-        std::lock_guard<std::recursive_mutex> decodeLock(m_DecodeMutex);
-        m_pAudioDecoder->seekAbsolute(static_cast<double>(seconds));
-    }
-
-    if (!isPaused())
-    {
-        m_pAudioRenderer->play();
-    }
-    else
-    {
-        m_SeekOccured = true;
-    }
-
-    m_NewTrackStarted = false;
+    Command command;
+    command.type         = CommandType::Seek;
+    command.seekPosition = seconds;
+    return postCommand(std::move(command));
 }
 
 double Playback::getCurrentTime() const
@@ -374,9 +731,14 @@ double Playback::getCurrentTime() const
     return m_CurrentPts;
 }
 
+PlaybackPosition Playback::getPlaybackPosition() const
+{
+    return m_pAudioRenderer ? m_pAudioRenderer->getPlaybackPosition() : PlaybackPosition();
+}
+
 double Playback::getDuration() const
 {
-    return m_pAudioDecoder ? static_cast<double>(m_pAudioDecoder->getDuration()) : 0.0;
+    return m_Duration;
 }
 
 PlaybackState Playback::getState() const
@@ -384,39 +746,35 @@ PlaybackState Playback::getState() const
     return m_State;
 }
 
-void Playback::setVolume(int32_t volume)
+std::future<void> Playback::setVolume(int32_t volume)
 {
-    if (m_pAudioRenderer)
-    {
-        std::lock_guard<std::mutex> lock(m_PlaybackMutex);
-        m_pAudioRenderer->setVolume(volume);
-        VolumeChanged(volume);
-    }
+    Command command;
+    command.type   = CommandType::SetVolume;
+    command.volume = volume;
+    return postCommand(std::move(command));
 }
 
 int32_t Playback::getVolume() const
 {
-    std::lock_guard<std::mutex> lock(m_PlaybackMutex);
-    return m_pAudioRenderer ? m_pAudioRenderer->getVolume() : 100;
+    return m_Volume;
 }
 
-void Playback::setMute(bool enabled)
+std::future<void> Playback::setMute(bool enabled)
 {
-    if (m_pAudioRenderer)
-    {
-        std::lock_guard<std::mutex> lock(m_PlaybackMutex);
-        m_pAudioRenderer->setMute(enabled);
-    }
+    Command command;
+    command.type = CommandType::SetMute;
+    command.mute = enabled;
+    return postCommand(std::move(command));
 }
 
 bool Playback::getMute() const
 {
-    std::lock_guard<std::mutex> lock(m_PlaybackMutex);
-    return m_pAudioRenderer ? m_pAudioRenderer->getMute() : false;
+    return m_Mute;
 }
 
 std::shared_ptr<ITrack> Playback::getTrack() const
 {
+    std::lock_guard<std::mutex> lock(m_PlaybackMutex);
     return m_CurrentTrack;
 }
 
@@ -426,29 +784,86 @@ std::set<PlaybackAction> Playback::getAvailableActions() const
     return m_AvailableActions;
 }
 
+std::future<void> Playback::setBufferPolicy(const BufferPolicy& policy)
+{
+    Command command;
+    command.type         = CommandType::SetBufferPolicy;
+    command.bufferPolicy = policy;
+    return postCommand(std::move(command));
+}
+
+BufferPolicy Playback::getBufferPolicy() const
+{
+    std::lock_guard<std::mutex> lock(m_PlaybackMutex);
+    return m_BufferPolicy;
+}
+
+bool Playback::isBuffering() const
+{
+    return m_Buffering;
+}
+
+MetricsSnapshot Playback::getMetrics() const
+{
+    MetricsSnapshot snapshot;
+    m_Metrics.snapshot(snapshot, "playback.");
+
+    if (m_pAudioRenderer)
+    {
+        m_pAudioRenderer->getMetrics(snapshot, "renderer.");
+    }
+
+    // the totals of all decoders, the metrics of a single decoder would restart on every track and seek
+    std::lock_guard<std::mutex> lock(m_PlaybackMutex);
+    snapshot.add(m_DecoderMetrics);
+    if (m_pAudioDecoder)
+    {
+        MetricsSnapshot decoder;
+        m_pAudioDecoder->getMetrics(decoder, "decoder.");
+        snapshot.add(decoder);
+    }
+
+    return snapshot;
+}
+
+void Playback::retireDecoderMetrics()
+{
+    if (!m_pAudioDecoder)
+    {
+        return;
+    }
+
+    // the decoder can be reused by a seek, it starts counting from zero again
+    MetricsSnapshot decoder;
+    m_pAudioDecoder->getMetrics(decoder, "decoder.");
+    m_DecoderMetrics.add(decoder);
+    m_pAudioDecoder->resetMetrics();
+}
+
 void Playback::playbackLoop()
 {
     while (!m_Destroy)
     {
-        log::debug("Wait {}", m_Destroy);
-        std::unique_lock<std::mutex> lock(m_PlaybackMutex);
-        m_PlaybackCondition.wait(lock);
-        log::debug("Condition signaled playback (stop = {})", m_Stop);
-
+        auto deadline = step();
         if (m_Destroy)
         {
             break;
         }
 
-        try
+        // sleep until a command arrives, the renderer signals space or the deadline expires
+        AUDIO_TRACE_SCOPE("wait");
+        std::unique_lock<std::mutex> lock(m_PlaybackMutex);
+        auto hasWork = [this] () { return m_WakeUp; };
+        if (deadline == TimePoint::max())
         {
-            m_Stop = m_SkipTrack = false;
-            playback(lock);
+            m_PlaybackCondition.wait(lock, hasWork);
         }
-        catch (exception& e)
+        else
         {
-            log::error("Playback error: {}", e.what());
+            m_PlaybackCondition.wait_until(lock, deadline, hasWork);
         }
+
+        m_WakeUp = false;
     }
 }
 
@@ -489,63 +904,13 @@ void Playback::setPlaybackState(PlaybackState state)
             break;
         }
 
-        m_AvailableActions = availableActions;
-        AvailableActionsChanged(availableActions);
-    }
-}
-
-#ifdef DUMP_TO_WAVE
+        {
+            std::lock_guard<std::mutex> lock(m_PlaybackMutex);
+            m_AvailableActions = availableActions;
+        }
 
-void Playback::writeWaveHeader()
-{
-    m_WaveFile.open("/tmp/dump.wav", ios_base::binary);
-    if (!m_WaveFile.is_open())
-    {
-        return;
+        AvailableActionsChanged(availableActions);
     }
-
-    uint16_t bps           = 16;
-    uint32_t subchunk1Size = 16; //16 for PCM
-    uint16_t audioFormat   = 1;  //PCM
-    uint16_t channels      = 2;
-    uint32_t sampleRate    = 44100;
-    uint32_t byteRate      = 44100 * 2 * (bps / 8);
-    uint16_t blockAlign    = 2 * (bps / 8);
-
-    //don't know yet
-    m_WaveBytes = 0;
-
-    m_WaveFile.write("RIFF", 4);
-    m_WaveFile.write((char*)&m_WaveBytes, 4);
-    m_WaveFile.write("WAVEfmt ", 8);
-    m_WaveFile.write((char*)&subchunk1Size, 4);
-    m_WaveFile.write((char*)&audioFormat, 2);
-    m_WaveFile.write((char*)&channels, 2);
-    m_WaveFile.write((char*)&sampleRate, 4);
-    m_WaveFile.write((char*)&byteRate, 4);
-    m_WaveFile.write((char*)&blockAlign, 2);
-    m_WaveFile.write((char*)&bps, 2);
-    m_WaveFile.write("data", 4);
-    m_WaveFile.write((char*)&m_WaveBytes, 4);
-}
-
-void Playback::updateWaveHeaderSize()
-{
-    m_WaveFile.seekp(4, ios_base::beg);
-    m_WaveFile.write((char*)&m_WaveBytes + 36, 4);
-
-    m_WaveFile.seekp(40, ios_base::beg);
-    m_WaveFile.write((char*)&m_WaveBytes, 4);
-
-    m_WaveFile.close();
-}
-
-void Playback::dumpToWav(Frame& frame)
-{
-    assert(m_WaveFile.is_open());
-    m_WaveFile.write(reinterpret_cast<char*>(frame.getFrameData()), frame.getDataSize());
-    m_WaveBytes += frame.getDataSize();
 }
 
-#endif
 }
@@ -18,6 +18,9 @@
 #define AUDIO_PLAYBACK_H
 
 #include <set>
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <string>
 #include <vector>
 #include <mutex>
@@ -27,10 +30,8 @@
 
 #include "audio/audioframe.h"
 #include "audio/audioplaybackinterface.h"
-
-
-//#define DUMP_TO_WAVE
-//#include <fstream>
+#include "audiompscqueue.h"
+#include "audiotrackprefetcher.h"
 
 namespace audio
 {
@@ -39,72 +40,156 @@ class IDecoder;
 class IRenderer;
 class IPlaylist;
 class ITrack;
+class PlaybackEngine;
 
 class Playback : public IPlayback
 {
 public:
-    Playback(IPlaylist& playlist, const std::string& appName, const std::string& audioOutput, const std::string& deviceName);
+    // Without an engine the playback runs on its own thread
+    Playback(IPlaylist& playlist, const std::string& appName, const std::string& audioOutput, const std::string& deviceName, PlaybackEngine* pEngine = nullptr);
     virtual ~Playback();
 
-    void play();
-    void pause();
-    void stop();
-    void prev();
-    void next();
+    std::future<void> play();
+    std::future<void> pause();
+    std::future<void> stop();
+    std::future<void> prev();
+    std::future<void> next();
     bool isPaused() const;
     bool isPlaying() const;
 
-    void seek(double seconds);
+    std::future<void> seek(double seconds);
     double getCurrentTime() const;
     double getDuration() const;
+    PlaybackPosition getPlaybackPosition() const;
     PlaybackState getState() const;
 
-    void setVolume(int32_t volume);
+    std::future<void> setVolume(int32_t volume);
     int32_t getVolume() const;
-    void setMute(bool enabled);
+    std::future<void> setMute(bool enabled);
     bool getMute() const;
 
     std::shared_ptr<ITrack> getTrack() const;
     std::set<PlaybackAction> getAvailableActions() const;
 
+    std::future<void> setBufferPolicy(const BufferPolicy& policy);
+    BufferPolicy getBufferPolicy() const;
+    bool isBuffering() const;
+
+    MetricsSnapshot getMetrics() const;
+
 private:
+    friend class PlaybackEngine;
+
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    enum class CommandType
+    {
+        Play,
+        Pause,
+        Stop,
+        Next,
+        Seek,
+        SetVolume,
+        SetMute,
+        SetBufferPolicy,
+        Destroy
+    };
+
+    struct Command
+    {
+        CommandType         type = CommandType::Play;
+        double              seekPosition = 0.0;
+        int32_t             volume = 0;
+        bool                mute = false;
+        BufferPolicy        bufferPolicy;
+        std::promise<void>  completion;
+    };
+
+    struct SeekResult
+    {
+        std::string                 uri;
+        double                      position = 0.0;
+        std::unique_ptr<IDecoder>   decoder;
+        std::exception_ptr          error;
+    };
+
+    std::future<void> postCommand(Command command);
+    std::future<void> postCommand(CommandType type);
+    void wakeUp();
+    void processCommands();
+    void executeCommand(const Command& command);
+
+    // Seeks are decoded on a second decoder in the background while the current audio keeps playing,
+    // requests that arrive while a seek is in progress are coalesced into the latest target.
+    // The queued old audio is faded out and the new audio is faded in after it, the two are not mixed.
+    // The decoder that was replaced by a seek is kept and positioned again by the next seek of the track.
+    void requestSeek(double position, std::promise<void> completion);
+    void launchSeek(std::unique_ptr<IDecoder> decoder);
+    void updateSeek();
+    void cancelSeek();
+
+    // Process the pending commands and do the decoding work that is needed now,
+    // returns the time at which it needs to run again (TimePoint::max() when idle)
+    TimePoint step();
+    TimePoint render();
+    // Starts, pauses or resumes the renderer depending on the buffer policy
+    void updateBuffering(bool bufferFull);
+    void startRenderer();
+    void setBuffering(bool buffering);
+    // The getters run on other threads, they read this snapshot instead of the renderer
+    void updateRendererState();
+    // Adds the metrics of the current decoder to the totals before it is replaced, call with the playback mutex locked
+    void retireDecoderMetrics();
+
     void stopPlayback(bool drain);
     bool startNewTrack();
     void sendProgressIfNeeded();
-    void playback(std::unique_lock<std::mutex>& lock);
     void playbackLoop();
-    bool rendererHasSpace(size_t dataSize);
     void setPlaybackState(PlaybackState state);
 
     std::unique_ptr<IDecoder>               m_pAudioDecoder;
+    MetricsSnapshot                         m_DecoderMetrics; // of the replaced decoders, guarded by the playback mutex
     std::unique_ptr<IRenderer>              m_pAudioRenderer;
+    TrackPrefetcher                         m_Prefetcher;
 
     IPlaylist&                              m_Playlist;
+    PlaybackEngine*                         m_pEngine;
     bool                                    m_Destroy;
-    bool                                    m_Stop;
     bool                                    m_NewTrackStarted;
-    PlaybackState                           m_State;
-    bool                                    m_SkipTrack;
+    std::atomic<PlaybackState>              m_State;
     bool                                    m_SeekOccured;
-    double                                  m_CurrentPts;
-    double                                  m_Duration;
+    std::atomic<double>                     m_CurrentPts;
+    std::atomic<double>                     m_Duration;
+    std::atomic<bool>                       m_RendererPlaying;
+    std::atomic<int32_t>                    m_Volume;
+    std::atomic<bool>                       m_Mute;
     Frame                                   m_AudioFrame;
     std::set<PlaybackAction>                m_AvailableActions;
     std::shared_ptr<ITrack>                 m_CurrentTrack;
 
+    std::future<SeekResult>                 m_SeekResult;
+    std::vector<std::promise<void>>         m_SeekCompletions;
+    std::unique_ptr<IDecoder>               m_SpareDecoder; // replaced by the last seek, reused by the next one
+    double                                  m_SeekTarget;
+    bool                                    m_SeekPending;
+    uint32_t                                m_FadeInFrames;
+    uint32_t                                m_FadeInPosition;
+
+    BufferPolicy                            m_BufferPolicy; // only modified with the playback mutex locked
+    std::atomic<bool>                       m_Buffering;
+    bool                                    m_RendererHeld; // paused to rebuffer
+
+    PlaybackMetrics                         m_Metrics;
+    TimePoint                               m_TrackStartTime;
+    bool                                    m_TrackStartPending;
+
+    MpscQueue<Command>                      m_Commands;
+    std::atomic<bool>                       m_CommandPending;
+    bool                                    m_WakeUp; // only accessed with the playback mutex locked
+
     std::condition_variable                 m_PlaybackCondition;
     mutable std::mutex                      m_PlaybackMutex;
-    mutable std::recursive_mutex            m_DecodeMutex;
     std::thread                             m_PlaybackThread;
-
-#ifdef DUMP_TO_WAVE
-    std::ofstream                           m_WaveFile;
-    uint32_t                                m_WaveBytes;
-
-    void writeWaveHeader();
-    void updateWaveHeaderSize();
-    void dumpToWav(Frame& frame);
-#endif
 };
 
 }
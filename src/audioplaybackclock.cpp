@@ -0,0 +1,187 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "audio/audioplaybackclock.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace audio
+{
+
+// Device updates that are behind the interpolated clock by less than this
+// are considered jitter, the clock is slowed down instead of jumping back
+static const double MAX_JITTER = 0.1;
+static const double SLEW_SPEED = 0.95;
+
+PlaybackClock::PlaybackClock()
+: m_Sequence(0)
+, m_Pts(0.0)
+, m_Time(now())
+, m_Limit(0.0)
+, m_Speed(1.0)
+, m_Running(false)
+, m_SampleRate(0)
+{
+}
+
+void PlaybackClock::setSampleRate(uint32_t rate)
+{
+    m_SampleRate = rate;
+}
+
+void PlaybackClock::update(double pts, bool running)
+{
+    std::lock_guard<std::mutex> lock(m_WriteMutex);
+
+    auto anchor  = readAnchor();
+    auto time    = now();
+    double current = interpolate(anchor, time);
+
+    anchor.speed = 1.0;
+    if (anchor.running && running && pts < current && (current - pts) < MAX_JITTER)
+    {
+        // never go back in time, let the device catch up
+        pts = current;
+        anchor.speed = SLEW_SPEED;
+    }
+
+    anchor.pts     = pts;
+    anchor.time    = time;
+    anchor.limit   = std::max(anchor.limit, pts);
+    anchor.running = running;
+    writeAnchor(anchor);
+}
+
+void PlaybackClock::setRunning(bool running)
+{
+    std::lock_guard<std::mutex> lock(m_WriteMutex);
+
+    auto anchor = readAnchor();
+    if (anchor.running == running)
+    {
+        return;
+    }
+
+    auto time      = now();
+    anchor.pts     = interpolate(anchor, time);
+    anchor.time    = time;
+    anchor.running = running;
+    writeAnchor(anchor);
+}
+
+void PlaybackClock::setLimit(double pts)
+{
+    std::lock_guard<std::mutex> lock(m_WriteMutex);
+
+    auto anchor  = readAnchor();
+    anchor.limit = pts;
+    writeAnchor(anchor);
+}
+
+void PlaybackClock::reset(double pts)
+{
+    std::lock_guard<std::mutex> lock(m_WriteMutex);
+
+    Anchor anchor;
+    anchor.pts     = pts;
+    anchor.time    = now();
+    anchor.limit   = pts;
+    anchor.speed   = 1.0;
+    anchor.running = false;
+    writeAnchor(anchor);
+}
+
+PlaybackPosition PlaybackClock::getPosition() const
+{
+    auto anchor = readAnchor();
+    auto time   = now();
+
+    PlaybackPosition pos;
+    pos.timestamp = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(time));
+
+    uint32_t rate = m_SampleRate;
+    double pts    = interpolate(anchor, time);
+    if (rate > 0)
+    {
+        // round down to a sample boundary
+        pos.frames = static_cast<int64_t>(std::floor(pts * rate));
+        pos.pts    = static_cast<double>(pos.frames) / rate;
+    }
+    else
+    {
+        pos.pts = pts;
+    }
+
+    return pos;
+}
+
+PlaybackClock::Anchor PlaybackClock::readAnchor() const
+{
+    Anchor anchor;
+
+    uint32_t sequence;
+    do
+    {
+        sequence = m_Sequence.load(std::memory_order_acquire);
+
+        anchor.pts     = m_Pts.load(std::memory_order_relaxed);
+        anchor.time    = m_Time.load(std::memory_order_relaxed);
+        anchor.limit   = m_Limit.load(std::memory_order_relaxed);
+        anchor.speed   = m_Speed.load(std::memory_order_relaxed);
+        anchor.running = m_Running.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    while ((sequence & 1) || sequence != m_Sequence.load(std::memory_order_relaxed));
+
+    return anchor;
+}
+
+void PlaybackClock::writeAnchor(const Anchor& anchor)
+{
+    // must be called with the write mutex locked
+    auto sequence = m_Sequence.load(std::memory_order_relaxed);
+    m_Sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_Pts.store(anchor.pts, std::memory_order_relaxed);
+    m_Time.store(anchor.time, std::memory_order_relaxed);
+    m_Limit.store(anchor.limit, std::memory_order_relaxed);
+    m_Speed.store(anchor.speed, std::memory_order_relaxed);
+    m_Running.store(anchor.running, std::memory_order_relaxed);
+
+    m_Sequence.store(sequence + 2, std::memory_order_release);
+}
+
+double PlaybackClock::interpolate(const Anchor& anchor, int64_t time)
+{
+    if (!anchor.running)
+    {
+        return anchor.pts;
+    }
+
+    double elapsed = std::max<int64_t>(0, time - anchor.time) / 1000000000.0;
+    return std::min(anchor.pts + elapsed * anchor.speed, std::max(anchor.pts, anchor.limit));
+}
+
+int64_t PlaybackClock::now()
+{
+    // steady_clock is CLOCK_MONOTONIC on linux
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
@@ -0,0 +1,185 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "audio/audioplaybackengine.h"
+
+#include "audioplayback.h"
+#include "audiotracepoints.h"
+#include "utils/log.h"
+
+#include <stdexcept>
+
+using namespace utils;
+
+namespace audio
+{
+
+PlaybackEngine::PlaybackEngine(uint32_t numThreads)
+: m_Stop(false)
+, m_Generation(0)
+{
+    if (numThreads == 0)
+    {
+        throw std::logic_error("PlaybackEngine: at least one thread is required");
+    }
+
+    for (uint32_t i = 0; i < numThreads; ++i)
+    {
+        m_Threads.emplace_back(&PlaybackEngine::workerThread, this);
+    }
+}
+
+PlaybackEngine::~PlaybackEngine()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_Sessions.empty())
+        {
+            log::warn("PlaybackEngine: destroyed while {} sessions are still active", m_Sessions.size());
+        }
+
+        m_Stop = true;
+        m_Condition.notify_all();
+    }
+
+    for (auto& thread : m_Threads)
+    {
+        thread.join();
+    }
+}
+
+IPlayback* PlaybackEngine::createPlayback(IPlaylist& playlist, const std::string& appName, const std::string& audioOutput, const std::string& deviceName)
+{
+    return new Playback(playlist, appName, audioOutput, deviceName, this);
+}
+
+void PlaybackEngine::addSession(Playback* pSession)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Sessions[pSession] = Session();
+}
+
+void PlaybackEngine::removeSession(Playback* pSession)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    auto iter = m_Sessions.find(pSession);
+    if (iter == m_Sessions.end())
+    {
+        return;
+    }
+
+    // wait for the worker that is running the session, queued entries become stale
+    m_SessionDone.wait(lock, [&] () { return !iter->second.running; });
+    m_Sessions.erase(iter);
+}
+
+void PlaybackEngine::wakeUp(Playback* pSession)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto iter = m_Sessions.find(pSession);
+    if (iter == m_Sessions.end())
+    {
+        return;
+    }
+
+    auto& session = iter->second;
+    if (session.running)
+    {
+        // rescheduled immediately when the current step finishes
+        session.wakeUp = true;
+    }
+    else
+    {
+        schedule(pSession, session, std::chrono::steady_clock::now());
+    }
+}
+
+void PlaybackEngine::schedule(Playback* pSession, Session& session, TimePoint deadline)
+{
+    // must be called with the mutex locked
+    if (deadline >= session.deadline)
+    {
+        // an earlier entry is already queued
+        return;
+    }
+
+    session.deadline   = deadline;
+    session.generation = ++m_Generation;
+
+    if (deadline != TimePoint::max())
+    {
+        m_Queue.push({deadline, pSession, session.generation});
+        m_Condition.notify_one();
+    }
+}
+
+void PlaybackEngine::workerThread()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while (!m_Stop)
+    {
+        if (m_Queue.empty())
+        {
+            m_Condition.wait(lock);
+            continue;
+        }
+
+        auto entry = m_Queue.top();
+        auto iter  = m_Sessions.find(entry.pSession);
+        if (iter == m_Sessions.end() || iter->second.generation != entry.generation || iter->second.running)
+        {
+            // removed or rescheduled in the meantime
+            m_Queue.pop();
+            continue;
+        }
+
+        if (entry.deadline > std::chrono::steady_clock::now())
+        {
+            m_Condition.wait_until(lock, entry.deadline);
+            continue;
+        }
+
+        m_Queue.pop();
+
+        auto& session    = iter->second;
+        session.running  = true;
+        session.wakeUp   = false;
+        session.deadline = TimePoint::max();
+
+        lock.unlock();
+        TimePoint deadline;
+        {
+            AUDIO_TRACE_SCOPE("step");
+            deadline = entry.pSession->step();
+        }
+        lock.lock();
+
+        // the session can not be removed while it is running, so the reference is still valid
+        session.running = false;
+        if (session.wakeUp)
+        {
+            deadline = std::chrono::steady_clock::now();
+        }
+
+        schedule(entry.pSession, session, deadline);
+        m_SessionDone.notify_all();
+    }
+}
+
+}
@@ -0,0 +1,322 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audio/audioplaylistparser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+namespace audio
+{
+
+static const std::string_view UTF8_BOM = "\xEF\xBB\xBF";
+static const std::string_view WHITESPACE = " \t\r";
+
+static std::string_view trim(std::string_view value)
+{
+    auto start = value.find_first_not_of(WHITESPACE);
+    if (start == std::string_view::npos)
+    {
+        return std::string_view();
+    }
+
+    auto end = value.find_last_not_of(WHITESPACE);
+    return value.substr(start, end - start + 1);
+}
+
+// Removes the next line from the contents and returns it trimmed
+static std::string_view nextLine(std::string_view& contents)
+{
+    auto end = contents.find('\n');
+    auto line = contents.substr(0, end);
+    contents.remove_prefix(end == std::string_view::npos ? contents.size() : end + 1);
+    return trim(line);
+}
+
+static bool startsWithIgnoreCase(std::string_view value, std::string_view prefix)
+{
+    if (value.size() < prefix.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < prefix.size(); ++i)
+    {
+        if (std::tolower(static_cast<unsigned char>(value[i])) != std::tolower(static_cast<unsigned char>(prefix[i])))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool equalsIgnoreCase(std::string_view value, std::string_view other)
+{
+    return value.size() == other.size() && startsWithIgnoreCase(value, other);
+}
+
+static std::string_view skipBom(std::string_view contents)
+{
+    if (contents.compare(0, UTF8_BOM.size(), UTF8_BOM) == 0)
+    {
+        contents.remove_prefix(UTF8_BOM.size());
+    }
+
+    return contents;
+}
+
+// Parses a decimal number without requiring a terminated string, returns false if there is none
+static bool parseNumber(std::string_view value, double& number)
+{
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < value.size() && (value[pos] == '-' || value[pos] == '+'))
+    {
+        negative = value[pos] == '-';
+        ++pos;
+    }
+
+    bool digits = false;
+    double result = 0.0;
+    for (; pos < value.size() && std::isdigit(static_cast<unsigned char>(value[pos])); ++pos)
+    {
+        result = result * 10.0 + (value[pos] - '0');
+        digits = true;
+    }
+
+    if (pos < value.size() && value[pos] == '.')
+    {
+        double scale = 0.1;
+        for (++pos; pos < value.size() && std::isdigit(static_cast<unsigned char>(value[pos])); ++pos)
+        {
+            result += (value[pos] - '0') * scale;
+            scale /= 10.0;
+            digits = true;
+        }
+    }
+
+    if (!digits)
+    {
+        return false;
+    }
+
+    number = negative ? -result : result;
+    return true;
+}
+
+// #EXTINF:<duration> [attributes],<title>
+// the attributes can contain quoted commas
+static void parseExtInf(std::string_view info, PlaylistEntry& entry)
+{
+    double duration;
+    if (parseNumber(info, duration) && duration >= 0.0)
+    {
+        entry.duration = duration;
+    }
+
+    bool quoted = false;
+    for (size_t i = 0; i < info.size(); ++i)
+    {
+        if (info[i] == '"')
+        {
+            quoted = !quoted;
+        }
+        else if (info[i] == ',' && !quoted)
+        {
+            entry.title = trim(info.substr(i + 1));
+            break;
+        }
+    }
+}
+
+uint64_t PlaylistParser::parse(std::string_view contents, const EntryCallback& onEntry)
+{
+    auto start = skipBom(contents);
+    start = start.substr(std::min(start.size(), start.find_first_not_of(" \t\r\n")));
+
+    if (startsWithIgnoreCase(start, "[playlist]"))
+    {
+        return parsePls(contents, onEntry);
+    }
+
+    return parseM3u(contents, onEntry);
+}
+
+uint64_t PlaylistParser::parseM3u(std::string_view contents, const EntryCallback& onEntry)
+{
+    contents = skipBom(contents);
+
+    uint64_t count = 0;
+    PlaylistEntry entry;
+    while (!contents.empty())
+    {
+        auto line = nextLine(contents);
+        if (line.empty())
+        {
+            continue;
+        }
+
+        if (line.front() == '#')
+        {
+            // the info applies to the next path, other directives are ignored
+            if (startsWithIgnoreCase(line, "#EXTINF:"))
+            {
+                parseExtInf(line.substr(8), entry);
+            }
+
+            continue;
+        }
+
+        entry.path = line;
+        onEntry(entry);
+        entry = PlaylistEntry();
+        ++count;
+    }
+
+    return count;
+}
+
+uint64_t PlaylistParser::parsePls(std::string_view contents, const EntryCallback& onEntry)
+{
+    contents = skipBom(contents);
+
+    // the keys of an entry (FileN, TitleN, LengthN) can appear anywhere in the file,
+    // so the entries are collected by number and passed on in that order at the end
+    std::map<uint64_t, PlaylistEntry> entries;
+    while (!contents.empty())
+    {
+        auto line = nextLine(contents);
+        if (line.empty() || line.front() == '[' || line.front() == ';' || line.front() == '#')
+        {
+            continue;
+        }
+
+        auto separator = line.find('=');
+        if (separator == std::string_view::npos)
+        {
+            continue;
+        }
+
+        auto key = trim(line.substr(0, separator));
+        auto value = trim(line.substr(separator + 1));
+
+        auto numberStart = key.find_first_of("0123456789");
+        if (numberStart == std::string_view::npos)
+        {
+            // NumberOfEntries, Version
+            continue;
+        }
+
+        auto name = key.substr(0, numberStart);
+        uint64_t number = 0;
+        auto result = std::from_chars(key.data() + numberStart, key.data() + key.size(), number);
+        if (result.ec != std::errc() || result.ptr != key.data() + key.size())
+        {
+            continue;
+        }
+
+        auto& entry = entries[number];
+        if (equalsIgnoreCase(name, "File"))
+        {
+            entry.path = value;
+        }
+        else if (equalsIgnoreCase(name, "Title"))
+        {
+            entry.title = value;
+        }
+        else if (equalsIgnoreCase(name, "Length"))
+        {
+            double duration;
+            if (parseNumber(value, duration) && duration >= 0.0)
+            {
+                entry.duration = duration;
+            }
+        }
+    }
+
+    uint64_t count = 0;
+    for (auto& [number, entry] : entries)
+    {
+        if (!entry.path.empty())
+        {
+            onEntry(entry);
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+uint64_t PlaylistParser::parseFile(const std::string& path, const ResolvedEntryCallback& onEntry)
+{
+    // read with a single call instead of mapping it, playlists are often rewritten in place
+    // and a mapping of a file that gets truncated faults on access
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    auto size = stream.tellg();
+    if (!stream || size < 0)
+    {
+        throw std::logic_error("Failed to open file: " + path);
+    }
+
+    std::string contents(static_cast<size_t>(size), '\0');
+    stream.seekg(0);
+    stream.read(&contents[0], static_cast<std::streamsize>(contents.size()));
+    if (stream.bad())
+    {
+        throw std::logic_error("Failed to read file: " + path);
+    }
+
+    // the file can shrink between obtaining the size and reading it
+    contents.resize(static_cast<size_t>(stream.gcount()));
+
+    return parse(contents, [&] (const PlaylistEntry& entry) {
+        onEntry(entry, resolvePath(path, entry.path));
+    });
+}
+
+std::string PlaylistParser::resolvePath(std::string_view playlistPath, std::string_view entryPath)
+{
+    bool isUri = entryPath.find("://") != std::string_view::npos;
+    bool isAbsolute = !entryPath.empty() && (entryPath.front() == '/' || entryPath.front() == '\\');
+    bool hasDrive = entryPath.size() > 1 && entryPath[1] == ':' && std::isalpha(static_cast<unsigned char>(entryPath[0]));
+
+    auto directoryEnd = playlistPath.find_last_of("/\\");
+    if (isUri || isAbsolute || hasDrive || directoryEnd == std::string_view::npos)
+    {
+        return std::string(entryPath);
+    }
+
+    std::string resolved;
+    resolved.reserve(directoryEnd + 1 + entryPath.size());
+    resolved.append(playlistPath.substr(0, directoryEnd + 1));
+
+    // ./ has no meaning once the directory is prepended
+    while (entryPath.size() > 2 && entryPath[0] == '.' && (entryPath[1] == '/' || entryPath[1] == '\\'))
+    {
+        entryPath.remove_prefix(2);
+    }
+
+    resolved.append(entryPath);
+    return resolved;
+}
+
+}
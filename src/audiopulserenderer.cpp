@@ -15,10 +15,12 @@
 //    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "audiopulserenderer.h"
+#include "audiofade.h"
 
 #include "audio/audioframe.h"
 #include "utils/log.h"
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 #include <string>
@@ -31,6 +33,8 @@ using namespace utils;
 namespace audio
 {
 
+static const pa_usec_t TARGET_LATENCY = 100000; // 100 ms of audio in the server buffer
+
 PulseRenderer::PulseRenderer(const std::string& name)
 : m_pPulseContext(nullptr)
 , m_pPulseLoop(nullptr)
@@ -42,6 +46,8 @@ PulseRenderer::PulseRenderer(const std::string& name)
 , m_IsPlaying(false)
 , m_LastPts(0.0)
 , m_Latency(0)
+, m_Starved(false)
+, m_SpaceSignaled(false)
 , m_FrameSize(0)
 , m_HWBufferSize(0)
 , m_Buffer(256 * 1024)
@@ -137,6 +143,7 @@ void PulseRenderer::setFormat(const Format& format)
     }
 
     m_Format = format;
+    m_Clock.setSampleRate(format.rate);
 }
 
 bool PulseRenderer::hasBufferSpace(uint32_t dataSize)
@@ -146,11 +153,14 @@ bool PulseRenderer::hasBufferSpace(uint32_t dataSize)
     
 double PulseRenderer::getBufferDuration()
 {
-    pa_threaded_mainloop_lock(m_pPulseLoop);
-    size_t bytesInBuffer = pa_stream_writable_size(m_pStream);
-    pa_threaded_mainloop_unlock(m_pPulseLoop);
-    
-    return static_cast<double>((m_HWBufferSize - bytesInBuffer) / (m_Format.bits / 8.0)) / m_Format.rate;
+    if (m_FrameSize == 0)
+    {
+        return 0.0;
+    }
+
+    // no need to take the mainloop lock, updateClock stores the latency on every stream write callback
+    double bufferDelay = m_Buffer.bytesUsed() / static_cast<double>(m_FrameSize * m_Format.rate);
+    return bufferDelay + (m_Latency / 1000000.0);
 }
 
 bool PulseRenderer::pulseIsReady()
@@ -164,23 +174,113 @@ bool PulseRenderer::pulseIsReady()
 void PulseRenderer::queueFrame(const Frame& frame)
 {
     m_Buffer.writeData(frame.getFrameData(), frame.getDataSize());
-    m_LastPts = frame.getPts();
+    m_Metrics.bytesQueued.increment(frame.getDataSize());
+    m_SpaceSignaled = false;
+    // pts of the end of the queued data
+    m_LastPts = frame.getPts() + (frame.getDataSize() / static_cast<double>(m_FrameSize * m_Format.rate));
+    m_Clock.setLimit(m_LastPts);
+}
+
+bool PulseRenderer::flushTail(double fadeDuration)
+{
+    if (!m_IsPlaying || !m_pStream || m_FrameSize == 0)
+    {
+        return false;
+    }
+
+    // with the mainloop lock held the write callback can not read from the buffer,
+    // the audio in the server buffer is kept
+    pa_threaded_mainloop_lock(m_pPulseLoop);
+
+    uint32_t used = m_Buffer.bytesUsed();
+    uint32_t keep = std::min(used, static_cast<uint32_t>(fadeDuration * m_Format.rate) * m_FrameSize);
+    m_Buffer.truncate(keep);
+
+    uint32_t offset = 0;
+    while (offset < keep)
+    {
+        uint8_t* pData = nullptr;
+        uint32_t size = m_Buffer.peek(offset, pData);
+        applyFade(pData, size, m_Format, offset / m_FrameSize, keep / m_FrameSize, FadeDirection::Out);
+        offset += size;
+    }
+
+    m_LastPts = m_LastPts - ((used - keep) / static_cast<double>(m_FrameSize * m_Format.rate));
+    m_Clock.setLimit(m_LastPts);
+    m_SpaceSignaled = false;
+
+    pa_threaded_mainloop_unlock(m_pPulseLoop);
+    return true;
 }
 
 void PulseRenderer::flushBuffers()
 {
-    if (m_IsPlaying && m_pStream)
+    // The data is pulled from the buffer by the write callback on the mainloop thread.
+    // Only when the callback ran out of data the server stops requesting more, in that
+    // case we have to push the data ourselves
+    if (m_IsPlaying && m_pStream && m_Starved.exchange(false))
     {
         pa_threaded_mainloop_lock(m_pPulseLoop);
-        size_t available = pa_stream_writable_size(m_pStream);
-        if (available > 0 && m_Buffer.bytesUsed() > 0)
+        writeFromBuffer(pa_stream_writable_size(m_pStream));
+        pa_threaded_mainloop_unlock(m_pPulseLoop);
+    }
+}
+
+void PulseRenderer::writeFromBuffer(size_t bytesRequested)
+{
+    // must be called with the mainloop lock held
+    size_t bytesToWrite = std::min<size_t>(bytesRequested, m_Buffer.bytesUsed());
+    bytesToWrite -= bytesToWrite % m_FrameSize;
+
+    size_t bytesWritten = 0;
+    while (bytesWritten < bytesToWrite)
+    {
+        void* pData = nullptr;
+        size_t size = bytesToWrite - bytesWritten;
+
+        // write directly in the server memory block to avoid an extra copy
+        if (pa_stream_begin_write(m_pStream, &pData, &size) < 0 || pData == nullptr)
         {
-            uint32_t size = available;
-            uint8_t* pData = m_Buffer.getData(size);
-            pa_stream_write(m_pStream, reinterpret_cast<const void*>(pData), size, nullptr, 0, PA_SEEK_RELATIVE);
+            log::warn("Pulseaudio: Failed to begin write: {}", pa_strerror(pa_context_errno(m_pPulseContext)));
+            break;
         }
-        pa_threaded_mainloop_unlock(m_pPulseLoop);
+
+        size = std::min(size, bytesToWrite - bytesWritten);
+        size -= size % m_FrameSize;
+        if (size == 0)
+        {
+            pa_stream_cancel_write(m_pStream);
+            break;
+        }
+
+        size = m_Buffer.readData(reinterpret_cast<uint8_t*>(pData), static_cast<uint32_t>(size));
+        if (pa_stream_write(m_pStream, pData, size, nullptr, 0, PA_SEEK_RELATIVE) < 0)
+        {
+            log::warn("Pulseaudio: Failed to write data: {}", pa_strerror(pa_context_errno(m_pPulseContext)));
+            break;
+        }
+
+        bytesWritten += size;
     }
+
+    if (bytesWritten < bytesRequested)
+    {
+        m_Starved = true;
+    }
+
+    // wake up the producer once, when the buffer is half empty
+    if (bytesWritten > 0 && m_Buffer.bytesFree() >= m_Buffer.size() / 2 && !m_SpaceSignaled.exchange(true))
+    {
+        SpaceAvailable();
+    }
+
+    updateClock();
+}
+
+void PulseRenderer::streamWriteCb(pa_stream* /*pStream*/, size_t bytes, void* pData)
+{
+    PulseRenderer* pRenderer = reinterpret_cast<PulseRenderer*>(pData);
+    pRenderer->writeFromBuffer(bytes);
 }
 
 bool PulseRenderer::isPlaying()
@@ -198,7 +298,18 @@ void PulseRenderer::play()
         
         pa_stream_set_state_callback(m_pStream, PulseRenderer::streamStateCb, this);
         pa_stream_set_underflow_callback(m_pStream, PulseRenderer::streamUnderflowCb, this);
-        if (pa_stream_connect_playback(m_pStream, nullptr, nullptr, static_cast<pa_stream_flags_t>(0), pa_cvolume_set(&m_Volume, m_SampleFormat.channels, m_VolumeInt * PA_VOLUME_NORM / 100), nullptr))
+        pa_stream_set_write_callback(m_pStream, PulseRenderer::streamWriteCb, this);
+
+        pa_buffer_attr bufferAttr;
+        bufferAttr.maxlength = static_cast<uint32_t>(-1);
+        bufferAttr.tlength   = static_cast<uint32_t>(pa_usec_to_bytes(TARGET_LATENCY, &m_SampleFormat));
+        bufferAttr.prebuf    = static_cast<uint32_t>(-1);
+        bufferAttr.minreq    = static_cast<uint32_t>(-1);
+        bufferAttr.fragsize  = static_cast<uint32_t>(-1);
+
+        m_Starved = false;
+        auto flags = static_cast<pa_stream_flags_t>(PA_STREAM_ADJUST_LATENCY | PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE);
+        if (pa_stream_connect_playback(m_pStream, nullptr, &bufferAttr, flags, pa_cvolume_set(&m_Volume, m_SampleFormat.channels, m_VolumeInt * PA_VOLUME_NORM / 100), nullptr))
         {
             throw logic_error("Failed to start pulseaudio playback");
         }
@@ -209,7 +320,6 @@ void PulseRenderer::play()
             pa_stream_state_t state = pa_stream_get_state(m_pStream);
             if (state == PA_STREAM_READY)
             {
-                writeSilentData();
                 m_IsPlaying = true;
                 break;
             }
@@ -240,6 +350,7 @@ void PulseRenderer::pause()
     pa_operation_unref(pOp);
 
     m_IsPlaying = false;
+    m_Clock.setRunning(false);
     pa_threaded_mainloop_unlock(m_pPulseLoop);
 }
 
@@ -266,14 +377,16 @@ void PulseRenderer::resume()
     pa_operation_unref(pOp);
 
     m_IsPlaying = true;
+    m_Clock.setRunning(true);
     pa_threaded_mainloop_unlock(m_pPulseLoop);
 }
 
 void PulseRenderer::stop(bool drain)
 {
-    if (m_pStream && m_IsPlaying)
+    if (m_pStream)
     {
         pa_threaded_mainloop_lock(m_pPulseLoop);
+        pa_stream_set_write_callback(m_pStream, nullptr, nullptr);
         pa_stream_disconnect(m_pStream);
         pa_stream_unref(m_pStream);
         m_pStream = nullptr;
@@ -281,7 +394,10 @@ void PulseRenderer::stop(bool drain)
         m_IsPlaying = false;
     }
 
+    // the write callback is disconnected, so it is safe to clear the buffer
     m_Buffer.clear();
+    m_Starved = false;
+    m_Clock.reset();
 }
 
 void PulseRenderer::setVolume(int32_t volume)
@@ -382,32 +498,36 @@ void PulseRenderer::sinkInputInfoCb(pa_context* pContext, const pa_sink_input_in
     }
 }
 
-void PulseRenderer::streamUpdateTimingCb(pa_stream* pStream, int success, void* pData)
+double PulseRenderer::updateClock()
 {
-    PulseRenderer* pRenderer = reinterpret_cast<PulseRenderer*>(pData);
-
-    int negative;
-    if (pa_stream_get_latency(pStream, &pRenderer->m_Latency, &negative) < 0)
+    // must be called with the mainloop lock held
+    // the stream interpolates the timing info, so this does not cause a server roundtrip
+    int negative = 0;
+    pa_usec_t latency = 0;
+    if (pa_stream_get_latency(m_pStream, &latency, &negative) < 0 || negative)
     {
-        log::debug("Failed to get latency: %s", pa_strerror(pa_context_errno(pRenderer->m_pPulseContext)));
-        pRenderer->m_Latency = 0;
+        latency = 0;
     }
+
+    m_Latency = latency;
+
+    double bufferDelay = m_Buffer.bytesUsed() / static_cast<double>(m_FrameSize * m_Format.rate);
+    double pts = std::max(0.0, m_LastPts - (latency / 1000000.0) - bufferDelay);
+    m_Clock.update(pts, pa_stream_is_corked(m_pStream) == 0);
+    return pts;
 }
 
 double PulseRenderer::getCurrentPts()
 {
-    pa_threaded_mainloop_lock(m_pPulseLoop);
-
-    assert(m_pStream);
-    pa_operation* pOp = pa_stream_update_timing_info(m_pStream, streamUpdateTimingCb, this);
-    if (pOp)
+    if (!m_pStream)
     {
-        pa_operation_unref(pOp);
+        return m_Clock.getPosition().pts;
     }
 
+    pa_threaded_mainloop_lock(m_pPulseLoop);
+    double pts = updateClock();
     pa_threaded_mainloop_unlock(m_pPulseLoop);
-    double bufferDelay = m_Buffer.bytesUsed() / static_cast<double>(m_FrameSize * m_Format.rate);
-    return std::max(0.0, m_LastPts - (m_Latency / 1000000.0) - bufferDelay);
+    return pts;
 }
 
 void PulseRenderer::contextStateCb(pa_context* pContext, void* pData)
@@ -466,20 +586,13 @@ void PulseRenderer::streamSuccessCb(pa_stream* pStream, int success, void* pData
     pa_threaded_mainloop_signal(pRenderer->m_pPulseLoop, 0);
 }
 
-void PulseRenderer::writeSilentData()
-{
-    pa_threaded_mainloop_lock(m_pPulseLoop);
-    size_t available = pa_stream_writable_size(m_pStream);
-    vector<uint8_t> buf(available, 0);
-    pa_stream_write(m_pStream, reinterpret_cast<const void*>(&buf.front()), available, nullptr, 0, PA_SEEK_RELATIVE);
-    pa_threaded_mainloop_unlock(m_pPulseLoop);
-}
-
 void PulseRenderer::streamUnderflowCb(pa_stream* pStream, void* pData)
 {
     assert(pStream);
     PulseRenderer* pRenderer = reinterpret_cast<PulseRenderer*>(pData);
     log::debug("PulseRenderer: XRUN %d %d", pa_stream_writable_size(pStream), pRenderer->m_Buffer.bytesUsed());
+    pRenderer->m_Starved = true;
+    pRenderer->m_Metrics.underruns.increment();
 }
 
 }
@@ -17,11 +17,12 @@
 #ifndef PULSE_RENDERER_H
 #define PULSE_RENDERER_H
 
+#include <atomic>
 #include <deque>
 #include <vector>
 #include <pulse/pulseaudio.h>
 
-#include "audiobuffer.h"
+#include "audioringbuffer.h"
 #include "audio/audioformat.h"
 #include "audio/audiorenderer.h"
 
@@ -54,6 +55,7 @@ public:
     double getBufferDuration() override;
     void flushBuffers() override;
     void queueFrame(const Frame& frame) override;
+    bool flushTail(double fadeDuration) override;
     double getCurrentPts() override;
 
 private:
@@ -63,9 +65,10 @@ private:
     static void streamUnderflowCb(pa_stream* pStream, void* pData);
     static void sinkInputInfoCb(pa_context* pContext, const pa_sink_input_info* pInfo, int eol, void* pData);
     static void streamSuccessCb(pa_stream* pStream, int success, void* pData);
-    static void streamUpdateTimingCb(pa_stream* pStream, int success, void* pData);
+    static void streamWriteCb(pa_stream* pStream, size_t bytes, void* pData);
 
-    void writeSilentData();
+    void writeFromBuffer(size_t bytesRequested);
+    double updateClock();
 
     bool pulseIsReady();
 
@@ -82,12 +85,14 @@ private:
     bool                        m_Muted;
     bool                        m_IsPlaying;
 
-    double                      m_LastPts;
-    pa_usec_t                   m_Latency;
+    std::atomic<double>         m_LastPts;
+    std::atomic<pa_usec_t>      m_Latency;
+    std::atomic<bool>           m_Starved;
+    std::atomic<bool>           m_SpaceSignaled;
     uint32_t                    m_FrameSize;
     uint32_t                    m_HWBufferSize;
 
-    Buffer                      m_Buffer;
+    RingBuffer                  m_Buffer;
 };
 
 }
@@ -0,0 +1,53 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audioreaderfactory.h"
+
+#include "audiohttprangereader.h"
+#include "audiocachingreader.h"
+#include "audiomemorymappedreader.h"
+#include "audio/audiodecoderfactory.h"
+#include "audio/audiostreamcache.h"
+#include "utils/readerfactory.h"
+
+namespace audio
+{
+
+std::unique_ptr<utils::IReader> createReader(const std::string& uri, uint32_t bufferSize)
+{
+    if (uri.compare(0, 7, "http://") == 0)
+    {
+        // fetches in large chunks itself, an extra buffer would only add a copy
+        auto reader = std::make_unique<HttpRangeReader>();
+        if (auto cache = StreamCache::getDefault())
+        {
+            return std::make_unique<CachingReader>(std::move(cache), std::move(reader));
+        }
+
+        return reader;
+    }
+
+    if (uri.find("://") == std::string::npos && DecoderFactory::useMemoryMappedFiles())
+    {
+        // local file, the decoders can use the mapping without copying
+        return std::make_unique<MemoryMappedReader>();
+    }
+
+    return utils::ReaderFactory::createBuffered(uri, bufferSize);
+}
+
+}
@@ -0,0 +1,38 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_READER_FACTORY_H
+#define AUDIO_READER_FACTORY_H
+
+#include <cinttypes>
+#include <memory>
+#include <string>
+
+#include "utils/readerinterface.h"
+
+namespace audio
+{
+
+// Reader used by the decoders for the given uri, the reader still needs to be opened
+// http uris use range requests with prefetching and go through the default stream cache if there is one,
+// local files are memory mapped when enabled with DecoderFactory::setMemoryMappedFiles,
+// other uris use a buffered utils reader
+std::unique_ptr<utils::IReader> createReader(const std::string& uri, uint32_t bufferSize);
+
+}
+
+#endif
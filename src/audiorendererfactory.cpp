@@ -30,17 +30,65 @@
 #include "audiopulserenderer.h"
 #endif
 
+#include "audionullrenderer.h"
+#include "audiofilerenderer.h"
+#include "audiomultirenderer.h"
+
+#include "utils/stringoperations.h"
+
+#include <limits>
+#include <memory>
 #include <stdexcept>
+#include <vector>
+
+using namespace utils;
 
 namespace audio
 {
 
+#if HAVE_OPENAL
+static OpenALRenderer* createOpenALRenderer(const std::string& deviceName)
+{
+    // deviceName optionally configures the buffering as "numBuffers,chunkDuration" (e.g. "16,20")
+    // the chunk duration is in milliseconds, an empty name or "Default" keeps the defaults
+    if (deviceName.empty() || deviceName == "Default")
+    {
+        return new OpenALRenderer();
+    }
+
+    auto settings = str::split(deviceName, ',');
+    if (settings.size() != 2)
+    {
+        throw std::logic_error("AudioRendererFactory: invalid OpenAL configuration: " + deviceName);
+    }
+
+    unsigned long numBuffers = 0, chunkDuration = 0;
+    try
+    {
+        numBuffers    = std::stoul(settings[0]);
+        chunkDuration = std::stoul(settings[1]);
+    }
+    catch (const std::logic_error&)
+    {
+        // std::invalid_argument or std::out_of_range
+        throw std::logic_error("AudioRendererFactory: invalid OpenAL configuration: " + deviceName);
+    }
+
+    if (numBuffers > std::numeric_limits<uint32_t>::max() || chunkDuration > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::logic_error("AudioRendererFactory: invalid OpenAL configuration: " + deviceName);
+    }
+
+    return new OpenALRenderer(static_cast<uint32_t>(numBuffers), static_cast<uint32_t>(chunkDuration));
+}
+#endif
+
 IRenderer* RendererFactory::create(const std::string& applicationName, const std::string& audioBackend, const std::string& deviceName)
 {
     if (audioBackend == "OpenAL")
     {
 #if HAVE_OPENAL
-        return new OpenALRenderer();
+        return createOpenALRenderer(deviceName);
 #else
         throw std::logic_error("AudioRendererFactory: package was not compiled with OpenAl support");
 #endif
@@ -66,6 +114,40 @@ IRenderer* RendererFactory::create(const std::string& applicationName, const std
 #endif
     }
 
+    if (audioBackend == "Null")
+    {
+        // deviceName selects the pacing: "Unbounded" consumes audio as fast as it is queued
+        return new NullRenderer(deviceName == "Unbounded" ? NullRenderer::Pacing::Unbounded : NullRenderer::Pacing::RealTime);
+    }
+
+    if (audioBackend == "File")
+    {
+        // deviceName is the output path, a .wav extension results in a wave file, raw pcm otherwise
+        return new FileRenderer(deviceName);
+    }
+
+    if (audioBackend == "Multi")
+    {
+        // deviceName contains the outputs separated by ';' as backend:device (e.g. "Alsa:hw:0,0;Alsa:hw:1,0")
+        // the first output is the master clock
+        std::vector<std::unique_ptr<IRenderer>> outputs;
+        for (auto& output : str::split(deviceName, ';'))
+        {
+            auto pos     = output.find(':');
+            auto backend = output.substr(0, pos);
+            auto device  = pos == std::string::npos ? std::string() : output.substr(pos + 1);
+
+            if (backend == "Multi")
+            {
+                throw std::logic_error("AudioRendererFactory: Multi outputs can not be nested");
+            }
+
+            outputs.emplace_back(create(applicationName, backend, device));
+        }
+
+        return new MultiRenderer(std::move(outputs));
+    }
+
     throw std::logic_error("AudioRendererFactory: Unsupported audio output type provided: " + audioBackend);
 }
 
@@ -0,0 +1,120 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "audioringbuffer.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+namespace audio
+{
+
+RingBuffer::RingBuffer(uint32_t size)
+: m_Size(size)
+, m_pAudioBuffer(new uint8_t[size])
+, m_ReadPos(0)
+, m_WritePos(0)
+{
+}
+
+RingBuffer::~RingBuffer()
+{
+    delete[] m_pAudioBuffer;
+}
+
+void RingBuffer::writeData(const uint8_t* pData, uint32_t size)
+{
+    auto writePos = m_WritePos.load(std::memory_order_relaxed);
+    auto readPos  = m_ReadPos.load(std::memory_order_acquire);
+
+    if (size > m_Size - static_cast<uint32_t>(writePos - readPos))
+    {
+        throw std::logic_error("Not enough room in audio buffer to write data");
+    }
+
+    uint32_t offset    = static_cast<uint32_t>(writePos % m_Size);
+    uint32_t firstSize = std::min(size, m_Size - offset);
+
+    memcpy(m_pAudioBuffer + offset, pData, firstSize);
+    memcpy(m_pAudioBuffer, pData + firstSize, size - firstSize);
+
+    m_WritePos.store(writePos + size, std::memory_order_release);
+}
+
+uint32_t RingBuffer::readData(uint8_t* pData, uint32_t size)
+{
+    auto readPos  = m_ReadPos.load(std::memory_order_relaxed);
+    auto writePos = m_WritePos.load(std::memory_order_acquire);
+
+    size = std::min(size, static_cast<uint32_t>(writePos - readPos));
+
+    uint32_t offset    = static_cast<uint32_t>(readPos % m_Size);
+    uint32_t firstSize = std::min(size, m_Size - offset);
+
+    memcpy(pData, m_pAudioBuffer + offset, firstSize);
+    memcpy(pData + firstSize, m_pAudioBuffer, size - firstSize);
+
+    m_ReadPos.store(readPos + size, std::memory_order_release);
+    return size;
+}
+
+uint32_t RingBuffer::bytesFree() const
+{
+    return m_Size - bytesUsed();
+}
+
+uint32_t RingBuffer::bytesUsed() const
+{
+    auto readPos  = m_ReadPos.load(std::memory_order_acquire);
+    auto writePos = m_WritePos.load(std::memory_order_acquire);
+    return static_cast<uint32_t>(writePos - readPos);
+}
+
+uint32_t RingBuffer::size() const
+{
+    return m_Size;
+}
+
+void RingBuffer::clear()
+{
+    m_ReadPos.store(m_WritePos.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+void RingBuffer::truncate(uint32_t size)
+{
+    auto readPos = m_ReadPos.load(std::memory_order_acquire);
+    if (size < bytesUsed())
+    {
+        m_WritePos.store(readPos + size, std::memory_order_release);
+    }
+}
+
+uint32_t RingBuffer::peek(uint32_t offset, uint8_t*& pData)
+{
+    auto used = bytesUsed();
+    if (offset >= used)
+    {
+        pData = nullptr;
+        return 0;
+    }
+
+    uint32_t start = static_cast<uint32_t>((m_ReadPos.load(std::memory_order_acquire) + offset) % m_Size);
+    pData = m_pAudioBuffer + start;
+    return std::min(used - offset, m_Size - start);
+}
+
+}
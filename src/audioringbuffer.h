@@ -0,0 +1,63 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef AUDIO_RING_BUFFER_H
+#define AUDIO_RING_BUFFER_H
+
+#include <atomic>
+#include <cinttypes>
+
+namespace audio
+{
+
+// Single producer, single consumer ring buffer
+// writeData may only be called from the producer thread, readData only from the consumer thread
+class RingBuffer
+{
+public:
+    RingBuffer(uint32_t size);
+    ~RingBuffer();
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    void writeData(const uint8_t* pData, uint32_t size);
+    uint32_t readData(uint8_t* pData, uint32_t size);
+
+    uint32_t bytesFree() const;
+    uint32_t bytesUsed() const;
+    uint32_t size() const;
+
+    // Not safe to call while the consumer is reading
+    void clear();
+    // Keep the first size bytes of the buffered data, the rest is discarded
+    // Not safe to call while the consumer is reading
+    void truncate(uint32_t size);
+    // Contiguous block of buffered data starting at offset from the read position, returns its size
+    // Not safe to call while the consumer is reading
+    uint32_t peek(uint32_t offset, uint8_t*& pData);
+
+private:
+    uint32_t                m_Size;
+    uint8_t*                m_pAudioBuffer;
+
+    std::atomic<uint64_t>   m_ReadPos;
+    std::atomic<uint64_t>   m_WritePos;
+};
+
+}
+
+#endif
@@ -0,0 +1,483 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audio/audiostreamcache.h"
+#include "audiohash.h"
+
+#include "utils/format.h"
+#include "utils/log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+using namespace utils;
+
+namespace audio
+{
+
+static const char INDEX_MAGIC[4] = { 'A', 'S', 'T', 'C' };
+static const uint32_t INDEX_VERSION = 1;
+
+struct IndexHeader
+{
+    char        magic[4];
+    uint32_t    version;
+    uint64_t    contentLength;
+    uint64_t    lastUse;
+    uint32_t    uriSize;
+    uint32_t    chunkCount;
+};
+
+const uint64_t StreamCache::ChunkSize;
+
+std::shared_ptr<StreamCache> StreamCache::s_Default;
+std::mutex StreamCache::s_DefaultMutex;
+
+static uint64_t hashUri(const std::string& uri)
+{
+    return hashData(uri.data(), uri.size());
+}
+
+StreamCache::StreamCache(const std::string& directory, uint64_t maxSize)
+: m_Directory(directory)
+, m_MaxSize(maxSize)
+, m_Size(0)
+, m_UseCounter(0)
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_Directory, error);
+    if (error)
+    {
+        throw std::logic_error("Failed to create stream cache directory: " + m_Directory);
+    }
+
+    std::vector<std::filesystem::path> dataFiles;
+    for (auto& entry : std::filesystem::directory_iterator(m_Directory, error))
+    {
+        auto extension = entry.path().extension();
+        if (extension == ".index")
+        {
+            loadIndex(entry.path().string());
+        }
+        else if (extension == ".data")
+        {
+            dataFiles.push_back(entry.path());
+        }
+        else if (extension == ".tmp")
+        {
+            // left behind by an interrupted write
+            std::filesystem::remove(entry.path(), error);
+        }
+    }
+
+    // data without an index can not be used
+    for (auto& path : dataFiles)
+    {
+        auto key = std::strtoull(path.stem().string().c_str(), nullptr, 16);
+        if (m_Entries.find(key) == m_Entries.end())
+        {
+            std::filesystem::remove(path, error);
+        }
+    }
+
+    log::debug("Stream cache {}: {} tracks, {} bytes", m_Directory, m_Entries.size(), m_Size);
+    makeRoom(0);
+}
+
+void StreamCache::setDefault(std::shared_ptr<StreamCache> cache)
+{
+    std::lock_guard<std::mutex> lock(s_DefaultMutex);
+    s_Default = std::move(cache);
+}
+
+std::shared_ptr<StreamCache> StreamCache::getDefault()
+{
+    std::lock_guard<std::mutex> lock(s_DefaultMutex);
+    return s_Default;
+}
+
+uint64_t StreamCache::acquire(const std::string& uri)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto& entry = getEntry(uri);
+    ++entry.users;
+    entry.lastUse = ++m_UseCounter;
+    return entry.contentLength;
+}
+
+void StreamCache::release(const std::string& uri)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto key = hashUri(uri);
+    auto iter = m_Entries.find(key);
+    if (iter == m_Entries.end() || iter->second.users == 0)
+    {
+        return;
+    }
+
+    auto& entry = iter->second;
+    --entry.users;
+
+    if (entry.contentLength == 0)
+    {
+        // nothing was cached
+        if (entry.users == 0)
+        {
+            m_Entries.erase(iter);
+        }
+
+        return;
+    }
+
+    // persist the use for the eviction order
+    saveIndex(key, entry);
+    makeRoom(0);
+}
+
+void StreamCache::setContentLength(const std::string& uri, uint64_t length)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto& entry = getEntry(uri);
+    if (entry.contentLength == length)
+    {
+        return;
+    }
+
+    if (entry.contentLength != 0)
+    {
+        // the remote file changed, the cached data is stale
+        log::debug("Stream cache: size of {} changed, discarding cached data", uri);
+        m_Size -= cachedSize(entry);
+        std::error_code error;
+        std::filesystem::remove(dataPath(hashUri(uri)), error);
+    }
+
+    ++entry.generation;
+    entry.contentLength = length;
+    entry.chunks.assign(static_cast<size_t>((length + ChunkSize - 1) / ChunkSize), false);
+}
+
+bool StreamCache::readChunk(const std::string& uri, uint64_t index, std::vector<uint8_t>& data)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    auto key = hashUri(uri);
+    auto iter = m_Entries.find(key);
+    if (iter == m_Entries.end() || index >= iter->second.chunks.size() || !iter->second.chunks[index])
+    {
+        return false;
+    }
+
+    // the file is read without holding the lock, the extra user keeps the entry from being evicted
+    auto& entry = iter->second;
+    auto size = chunkSize(entry, index);
+    auto generation = entry.generation;
+    ++entry.users;
+    lock.unlock();
+
+    data.resize(static_cast<size_t>(size));
+    std::ifstream stream(dataPath(key), std::ios::binary);
+    stream.seekg(static_cast<std::streamoff>(index * ChunkSize));
+    stream.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+
+    lock.lock();
+    --entry.users;
+
+    if (entry.generation != generation)
+    {
+        // the cached data was discarded while reading
+        return false;
+    }
+
+    if (!stream)
+    {
+        log::warn("Stream cache: failed to read chunk {} of {}", index, uri);
+        if (entry.chunks[index])
+        {
+            entry.chunks[index] = false;
+            m_Size -= size;
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+void StreamCache::writeChunk(const std::string& uri, uint64_t index, const uint8_t* pData, uint64_t size)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    auto key = hashUri(uri);
+    auto iter = m_Entries.find(key);
+    if (iter == m_Entries.end() || iter->second.users == 0 || index >= iter->second.chunks.size() || iter->second.chunks[index])
+    {
+        return;
+    }
+
+    auto& entry = iter->second;
+    if (size != chunkSize(entry, index))
+    {
+        return;
+    }
+
+    makeRoom(size);
+    if (m_Size + size > m_MaxSize)
+    {
+        // everything that is left is in use
+        return;
+    }
+
+    auto path = dataPath(key);
+    if (!std::filesystem::exists(path))
+    {
+        std::ofstream create(path, std::ios::binary);
+    }
+
+    // the space is reserved and the file is written without holding the lock
+    auto generation = entry.generation;
+    m_Size += size;
+    ++entry.users;
+    lock.unlock();
+
+    // chunks are written at their offset, the gaps of missing chunks stay sparse
+    std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+    stream.seekp(static_cast<std::streamoff>(index * ChunkSize));
+    stream.write(reinterpret_cast<const char*>(pData), static_cast<std::streamsize>(size));
+    stream.flush();
+
+    lock.lock();
+    --entry.users;
+
+    if (entry.generation != generation || !stream || entry.chunks[index])
+    {
+        if (!stream)
+        {
+            log::warn("Stream cache: failed to write chunk {} of {}", index, uri);
+        }
+
+        // failed, another reader stored the same chunk or the cached data was discarded in the meantime
+        m_Size -= size;
+        return;
+    }
+
+    entry.chunks[index] = true;
+
+    // the data is written before the index, so the index never refers to missing data
+    saveIndex(key, entry);
+}
+
+uint64_t StreamCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Size;
+}
+
+StreamCache::Entry& StreamCache::getEntry(const std::string& uri)
+{
+    auto key = hashUri(uri);
+    auto iter = m_Entries.find(key);
+    if (iter != m_Entries.end() && iter->second.uri != uri)
+    {
+        // hash collision, the old track makes way unless it is playing
+        if (iter->second.users > 0)
+        {
+            throw std::logic_error("Stream cache entry in use by another uri: " + uri);
+        }
+
+        removeEntry(key);
+        iter = m_Entries.end();
+    }
+
+    if (iter == m_Entries.end())
+    {
+        Entry entry;
+        entry.uri = uri;
+        iter = m_Entries.emplace(key, std::move(entry)).first;
+    }
+
+    return iter->second;
+}
+
+uint64_t StreamCache::chunkSize(const Entry& entry, uint64_t index) const
+{
+    auto offset = index * ChunkSize;
+    return offset < entry.contentLength ? std::min(ChunkSize, entry.contentLength - offset) : 0;
+}
+
+uint64_t StreamCache::cachedSize(const Entry& entry) const
+{
+    uint64_t size = 0;
+    for (size_t i = 0; i < entry.chunks.size(); ++i)
+    {
+        if (entry.chunks[i])
+        {
+            size += chunkSize(entry, i);
+        }
+    }
+
+    return size;
+}
+
+void StreamCache::loadIndex(const std::string& path)
+{
+    std::error_code error;
+    auto fileSize = std::filesystem::file_size(path, error);
+    std::ifstream stream(path, std::ios::binary);
+
+    IndexHeader header;
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    Entry entry;
+    entry.contentLength = header.contentLength;
+    entry.lastUse = header.lastUse;
+
+    std::vector<uint8_t> bitmap;
+    if (stream &&
+        memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+        header.version == INDEX_VERSION &&
+        header.chunkCount == (header.contentLength + ChunkSize - 1) / ChunkSize &&
+        !error && fileSize == sizeof(header) + header.uriSize + (header.chunkCount + 7ull) / 8)
+    {
+        // the sizes are checked against the file first, a corrupt header can not cause huge allocations
+        entry.uri.resize(header.uriSize);
+        stream.read(&entry.uri[0], header.uriSize);
+        bitmap.resize((header.chunkCount + 7) / 8);
+        stream.read(reinterpret_cast<char*>(bitmap.data()), static_cast<std::streamsize>(bitmap.size()));
+    }
+
+    auto key = hashUri(entry.uri);
+    if (!stream ||
+        std::filesystem::path(path).filename() != std::filesystem::path(indexPath(key)).filename() ||
+        !std::filesystem::exists(dataPath(key)))
+    {
+        log::warn("Ignoring invalid stream cache index: {}", path);
+        std::filesystem::remove(path, error);
+        return;
+    }
+
+    entry.chunks.resize(header.chunkCount);
+    for (size_t i = 0; i < entry.chunks.size(); ++i)
+    {
+        entry.chunks[i] = (bitmap[i / 8] & (1 << (i % 8))) != 0;
+    }
+
+    m_Size += cachedSize(entry);
+    m_UseCounter = std::max(m_UseCounter, entry.lastUse);
+    m_Entries.emplace(key, std::move(entry));
+}
+
+void StreamCache::saveIndex(uint64_t key, const Entry& entry)
+{
+    IndexHeader header;
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version          = INDEX_VERSION;
+    header.contentLength    = entry.contentLength;
+    header.lastUse          = entry.lastUse;
+    header.uriSize          = static_cast<uint32_t>(entry.uri.size());
+    header.chunkCount       = static_cast<uint32_t>(entry.chunks.size());
+
+    std::vector<uint8_t> bitmap((entry.chunks.size() + 7) / 8, 0);
+    for (size_t i = 0; i < entry.chunks.size(); ++i)
+    {
+        if (entry.chunks[i])
+        {
+            bitmap[i / 8] |= static_cast<uint8_t>(1 << (i % 8));
+        }
+    }
+
+    // write and rename so an interrupted write keeps the previous index
+    auto path = indexPath(key);
+    auto tempPath = path + ".tmp";
+    {
+        std::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(entry.uri.data(), static_cast<std::streamsize>(entry.uri.size()));
+        stream.write(reinterpret_cast<const char*>(bitmap.data()), static_cast<std::streamsize>(bitmap.size()));
+        if (!stream)
+        {
+            log::warn("Failed to write stream cache index: {}", tempPath);
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        log::warn("Failed to replace stream cache index: {}", path);
+        std::filesystem::remove(tempPath, error);
+    }
+}
+
+void StreamCache::removeEntry(uint64_t key)
+{
+    auto iter = m_Entries.find(key);
+    if (iter == m_Entries.end())
+    {
+        return;
+    }
+
+    m_Size -= cachedSize(iter->second);
+    m_Entries.erase(iter);
+
+    std::error_code error;
+    std::filesystem::remove(indexPath(key), error);
+    std::filesystem::remove(dataPath(key), error);
+}
+
+void StreamCache::makeRoom(uint64_t size)
+{
+    while (m_Size + size > m_MaxSize)
+    {
+        // least recently used track that is not being played
+        auto lru = m_Entries.end();
+        for (auto iter = m_Entries.begin(); iter != m_Entries.end(); ++iter)
+        {
+            if (iter->second.users == 0 && (lru == m_Entries.end() || iter->second.lastUse < lru->second.lastUse))
+            {
+                lru = iter;
+            }
+        }
+
+        if (lru == m_Entries.end())
+        {
+            break;
+        }
+
+        log::debug("Stream cache: evict {}", lru->second.uri);
+        removeEntry(lru->first);
+    }
+}
+
+std::string StreamCache::dataPath(uint64_t key) const
+{
+    return fmt::format("{}/{:016x}.data", m_Directory, key);
+}
+
+std::string StreamCache::indexPath(uint64_t key) const
+{
+    return fmt::format("{}/{:016x}.index", m_Directory, key);
+}
+
+}
@@ -0,0 +1,63 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audio/audiostringarena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace audio
+{
+
+StringArena::StringArena(size_t blockSize)
+: m_BlockSize(blockSize)
+, m_Used(0)
+{
+}
+
+std::string_view StringArena::add(std::string_view value)
+{
+    if (value.empty())
+    {
+        return std::string_view();
+    }
+
+    if (m_Blocks.empty() || m_Blocks.back().size - m_Used < value.size())
+    {
+        // strings that do not fit in a block get a block of their own
+        auto size = std::max(m_BlockSize, value.size());
+        m_Blocks.push_back({ std::make_unique<char[]>(size), size });
+        m_Used = 0;
+    }
+
+    char* pData = m_Blocks.back().data.get() + m_Used;
+    memcpy(pData, value.data(), value.size());
+    m_Used += value.size();
+    return std::string_view(pData, value.size());
+}
+
+void StringArena::clear()
+{
+    if (m_Blocks.size() > 1)
+    {
+        m_Blocks.erase(m_Blocks.begin() + 1, m_Blocks.end());
+    }
+
+    m_Used = 0;
+}
+
+}
@@ -18,6 +18,8 @@
 
 #include "utils/readerfactory.h"
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 using namespace TagLib;
@@ -25,9 +27,18 @@ using namespace TagLib;
 namespace audio
 {
 
+static const uint64_t BLOCK_SIZE = 64 * 1024;
+static const uint64_t HEAD_BLOCKS = 2;
+static const uint64_t TAIL_BLOCKS = 1;
+static const uint64_t MAX_BLOCKS = 32;
+
 TaglibIOStream::TaglibIOStream(const std::string& url)
 : m_Reader(utils::ReaderFactory::create(url))
 , m_Uri(url)
+, m_Position(0)
+, m_Length(0)
+, m_LengthKnown(false)
+, m_UseCounter(0)
 {
     m_Reader->open(url);
 }
@@ -35,6 +46,10 @@ TaglibIOStream::TaglibIOStream(const std::string& url)
 TaglibIOStream::TaglibIOStream(const std::string& url, uint32_t bufferSize)
 : m_Reader(utils::ReaderFactory::createBuffered(url, bufferSize))
 , m_Uri(url)
+, m_Position(0)
+, m_Length(0)
+, m_LengthKnown(false)
+, m_UseCounter(0)
 {
     m_Reader->open(url);
 }
@@ -50,13 +65,141 @@ FileName TaglibIOStream::name() const
 
 ByteVector TaglibIOStream::readBlock(ulong readLength)
 {
-    ByteVector data;
-    data.resize(static_cast<uint>(readLength));
-    data.resize(static_cast<uint>(m_Reader->read(reinterpret_cast<uint8_t*>(data.data()), static_cast<uint>(readLength))));
+    uint64_t length = contentLength();
+    uint64_t size = readLength;
+    if (length > 0)
+    {
+        size = m_Position < length ? std::min<uint64_t>(size, length - m_Position) : 0;
+    }
+
+    ByteVector data(static_cast<uint>(size), 0);
+    if (size == 0)
+    {
+        return data;
+    }
+
+    if (size > (MAX_BLOCKS / 2) * BLOCK_SIZE)
+    {
+        // large reads would only flush the cache
+        m_Reader->seekAbsolute(m_Position);
+        size = m_Reader->read(reinterpret_cast<uint8_t*>(data.data()), size);
+        data.resize(static_cast<uint>(size));
+        m_Position += size;
+        return data;
+    }
+
+    uint64_t copied = 0;
+    while (copied < size)
+    {
+        uint64_t position = m_Position + copied;
+        auto* pBlock = getBlock(position / BLOCK_SIZE, m_Position + size);
 
+        uint64_t offset = position % BLOCK_SIZE;
+        if (offset >= pBlock->data.size())
+        {
+            // end of the data
+            break;
+        }
+
+        auto count = std::min(size - copied, pBlock->data.size() - offset);
+        memcpy(data.data() + copied, pBlock->data.data() + offset, count);
+        copied += count;
+    }
+
+    data.resize(static_cast<uint>(copied));
+    m_Position += copied;
     return data;
 }
 
+const TaglibIOStream::Block* TaglibIOStream::getBlock(uint64_t index, uint64_t readEnd)
+{
+    auto findBlock = [this] (uint64_t blockIndex) {
+        return std::find_if(m_Blocks.begin(), m_Blocks.end(), [blockIndex] (const Block& block) { return block.index == blockIndex; });
+    };
+
+    auto iter = findBlock(index);
+    if (iter == m_Blocks.end())
+    {
+        // fetch all the blocks of the read that are missing in one request,
+        // a miss in the head or tail region fetches the complete region
+        uint64_t last = (readEnd - 1) / BLOCK_SIZE;
+        uint64_t first = index;
+        if (first < HEAD_BLOCKS)
+        {
+            first = 0;
+            last = std::max(last, HEAD_BLOCKS - 1);
+        }
+
+        uint64_t length = contentLength();
+        if (length > 0)
+        {
+            uint64_t lastBlock = (length - 1) / BLOCK_SIZE;
+            uint64_t tailStart = lastBlock >= TAIL_BLOCKS ? lastBlock - TAIL_BLOCKS + 1 : 0;
+            if (last >= tailStart)
+            {
+                first = std::min(first, tailStart);
+                last = lastBlock;
+            }
+
+            last = std::min(last, lastBlock);
+        }
+
+        loadBlocks(first, last);
+        iter = findBlock(index);
+    }
+
+    iter->lastUse = ++m_UseCounter;
+    return &(*iter);
+}
+
+void TaglibIOStream::loadBlocks(uint64_t first, uint64_t last)
+{
+    // blocks that are already cached are not fetched again
+    while (first < last && std::any_of(m_Blocks.begin(), m_Blocks.end(), [first] (const Block& block) { return block.index == first; }))
+    {
+        ++first;
+    }
+
+    std::vector<uint8_t> data((last - first + 1) * BLOCK_SIZE);
+    m_Reader->seekAbsolute(first * BLOCK_SIZE);
+    auto size = m_Reader->read(data.data(), data.size());
+
+    for (uint64_t index = first; index <= last; ++index)
+    {
+        uint64_t offset = (index - first) * BLOCK_SIZE;
+        auto count = offset < size ? std::min(BLOCK_SIZE, size - offset) : 0;
+
+        auto iter = std::find_if(m_Blocks.begin(), m_Blocks.end(), [index] (const Block& block) { return block.index == index; });
+        if (iter == m_Blocks.end())
+        {
+            if (m_Blocks.size() >= MAX_BLOCKS)
+            {
+                // evict the least recently used block
+                iter = std::min_element(m_Blocks.begin(), m_Blocks.end(), [] (const Block& lhs, const Block& rhs) { return lhs.lastUse < rhs.lastUse; });
+            }
+            else
+            {
+                iter = m_Blocks.insert(m_Blocks.end(), Block());
+            }
+        }
+
+        iter->index = index;
+        iter->data.assign(data.begin() + offset, data.begin() + offset + count);
+        iter->lastUse = ++m_UseCounter;
+    }
+}
+
+uint64_t TaglibIOStream::contentLength()
+{
+    if (!m_LengthKnown)
+    {
+        m_Length = m_Reader->getContentLength();
+        m_LengthKnown = true;
+    }
+
+    return m_Length;
+}
+
 void TaglibIOStream::writeBlock(const TagLib::ByteVector&)
 {
     throw std::logic_error("Writing is not supported");
@@ -84,16 +227,17 @@ bool TaglibIOStream::isOpen() const
 
 void TaglibIOStream::seek(long offset, Position position)
 {
+    // only the position is updated, the reader is positioned when data is fetched
     switch (position)
     {
         case Beginning:
-            m_Reader->seekAbsolute(offset);
+            m_Position = std::max(0l, offset);
             break;
         case Current:
-            m_Reader->seekRelative(offset);
+            m_Position = std::max(0l, static_cast<long>(m_Position) + offset);
             break;
         case End:
-            m_Reader->seekAbsolute((length() - 1) + offset);
+            m_Position = std::max(0l, length() + offset);
             break;
         default:
             throw std::logic_error("Invalid seek position");
@@ -107,12 +251,12 @@ void TaglibIOStream::clear()
 
 long TaglibIOStream::tell() const
 {
-    return static_cast<long>(m_Reader->currentPosition());
+    return static_cast<long>(m_Position);
 }
 
 long TaglibIOStream::length()
 {
-    return static_cast<long>(m_Reader->getContentLength());
+    return static_cast<long>(contentLength());
 }
 
 void TaglibIOStream::truncate(long /*length*/)
@@ -22,12 +22,17 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "utils/readerinterface.h"
 
 namespace audio
 {
 
+// Read only stream for taglib on top of the utils readers
+// Taglib does many small reads and seeks, mostly at the start and the end of the file.
+// The data is cached in blocks and a miss at the start or the end of the file fetches
+// the whole head or tail region, so a remote file typically costs two range requests.
 class TaglibIOStream : public TagLib::IOStream
 {
 public:
@@ -51,8 +56,24 @@ public:
     virtual void truncate(long length);
     
 private:
+    struct Block
+    {
+        uint64_t                index;
+        std::vector<uint8_t>    data;
+        uint64_t                lastUse;
+    };
+
+    const Block* getBlock(uint64_t index, uint64_t readEnd);
+    void loadBlocks(uint64_t first, uint64_t last);
+    uint64_t contentLength();
+
     std::unique_ptr<utils::IReader> m_Reader;
     std::string                     m_Uri;
+    std::vector<Block>              m_Blocks;
+    uint64_t                        m_Position;
+    uint64_t                        m_Length;
+    bool                            m_LengthKnown;
+    uint64_t                        m_UseCounter;
 };
 
 }
@@ -0,0 +1,598 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audiotagreader.h"
+#include "audio/audiometadata.h"
+#include "audio/audiompegutils.h"
+#include "audio/audiostringarena.h"
+
+#include "utils/fileoperations.h"
+#include "utils/readerfactory.h"
+#include "utils/stringoperations.h"
+
+#include <cctype>
+#include <cstring>
+#include <vector>
+
+using namespace utils;
+
+namespace audio
+{
+namespace TagReader
+{
+
+// large enough to contain the tags of most files, so they are read in one go
+static const uint32_t READ_BUFFER_SIZE = 64 * 1024;
+
+static const char* s_Genres[] = {
+    "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge", "Hip-Hop", "Jazz", "Metal",
+    "New Age", "Oldies", "Other", "Pop", "R&B", "Rap", "Reggae", "Rock", "Techno", "Industrial",
+    "Alternative", "Ska", "Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient", "Trip-Hop", "Vocal", "Jazz+Funk",
+    "Fusion", "Trance", "Classical", "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+    "Alternative Rock", "Bass", "Soul", "Punk", "Space", "Meditative", "Instrumental Pop", "Instrumental Rock", "Ethnic", "Gothic",
+    "Darkwave", "Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream", "Southern Rock", "Comedy", "Cult", "Gangsta",
+    "Top 40", "Christian Rap", "Pop/Funk", "Jungle", "Native American", "Cabaret", "New Wave", "Psychedelic", "Rave", "Showtunes",
+    "Trailer", "Lo-Fi", "Tribal", "Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll", "Hard Rock",
+    "Folk", "Folk/Rock", "National Folk", "Swing", "Fusion", "Bebob", "Latin", "Revival", "Celtic", "Bluegrass",
+    "Avantgarde", "Gothic Rock", "Progressive Rock", "Psychedelic Rock", "Symphonic Rock", "Slow Rock", "Big Band", "Chorus", "Easy Listening", "Acoustic",
+    "Humour", "Speech", "Chanson", "Opera", "Chamber Music", "Sonata", "Symphony", "Booty Bass", "Primus", "Porn Groove",
+    "Satire", "Slow Jam", "Club", "Tango", "Samba", "Folklore", "Ballad", "Power Ballad", "Rhythmic Soul", "Freestyle",
+    "Duet", "Punk Rock", "Drum Solo", "A Cappella", "Euro-House", "Dance Hall", "Goa", "Drum & Bass", "Club-House", "Hardcore",
+    "Terror", "Indie", "BritPop", "Negerpunk", "Polsk Punk", "Beat", "Christian Gangsta Rap", "Heavy Metal", "Black Metal", "Crossover",
+    "Contemporary Christian", "Christian Rock", "Merengue", "Salsa", "Thrash Metal", "Anime", "Jpop", "Synthpop"
+};
+
+static uint32_t readSynchsafe(const uint8_t* pData)
+{
+    return (pData[0] & 0x7F) << 21 | (pData[1] & 0x7F) << 14 | (pData[2] & 0x7F) << 7 | (pData[3] & 0x7F);
+}
+
+static uint32_t readBigEndian(const uint8_t* pData, uint32_t size)
+{
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        value = (value << 8) | pData[i];
+    }
+
+    return value;
+}
+
+static uint32_t readLittleEndian32(const uint8_t* pData)
+{
+    return pData[0] | pData[1] << 8 | pData[2] << 16 | static_cast<uint32_t>(pData[3]) << 24;
+}
+
+// Leading number of the value, e.g. 3 for "3/12" or 2004 for "2004-05-01"
+static uint32_t parseNumber(const std::string& value)
+{
+    uint32_t number = 0;
+    size_t i = value.find_first_not_of(" \t");
+    for (; i < value.size() && value[i] >= '0' && value[i] <= '9'; ++i)
+    {
+        number = number * 10 + (value[i] - '0');
+    }
+
+    return number;
+}
+
+static bool equalsIgnoreCase(const uint8_t* pData, size_t size, const char* pKey)
+{
+    auto keySize = strlen(pKey);
+    if (size != keySize)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (toupper(pData[i]) != pKey[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void appendUtf8(std::string& output, uint32_t codePoint)
+{
+    if (codePoint < 0x80)
+    {
+        output += static_cast<char>(codePoint);
+    }
+    else if (codePoint < 0x800)
+    {
+        output += static_cast<char>(0xC0 | (codePoint >> 6));
+        output += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000)
+    {
+        output += static_cast<char>(0xE0 | (codePoint >> 12));
+        output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        output += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else
+    {
+        output += static_cast<char>(0xF0 | (codePoint >> 18));
+        output += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        output += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+// First string of an id3v2 text frame converted to utf-8
+static std::string decodeText(const uint8_t* pData, size_t size)
+{
+    std::string result;
+    if (size == 0)
+    {
+        return result;
+    }
+
+    uint8_t encoding = pData[0];
+    ++pData;
+    --size;
+
+    if (encoding == 0)
+    {
+        // latin1
+        for (size_t i = 0; i < size && pData[i] != 0; ++i)
+        {
+            appendUtf8(result, pData[i]);
+        }
+    }
+    else if (encoding == 3)
+    {
+        auto* pEnd = static_cast<const uint8_t*>(memchr(pData, 0, size));
+        result.assign(reinterpret_cast<const char*>(pData), pEnd ? pEnd - pData : size);
+    }
+    else if (encoding == 1 || encoding == 2)
+    {
+        // utf-16 with byte order mark or utf-16be
+        bool bigEndian = encoding == 2;
+        size_t i = 0;
+        if (encoding == 1 && size >= 2 && (pData[0] == 0xFE || pData[0] == 0xFF))
+        {
+            bigEndian = pData[0] == 0xFE;
+            i = 2;
+        }
+
+        auto readUnit = [&] (size_t offset) -> uint32_t {
+            return bigEndian ? (pData[offset] << 8 | pData[offset + 1]) : (pData[offset + 1] << 8 | pData[offset]);
+        };
+
+        for (; i + 1 < size; i += 2)
+        {
+            uint32_t unit = readUnit(i);
+            if (unit == 0)
+            {
+                break;
+            }
+
+            if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < size)
+            {
+                uint32_t low = readUnit(i + 2);
+                if (low >= 0xDC00 && low < 0xE000)
+                {
+                    unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                    i += 2;
+                }
+            }
+
+            appendUtf8(result, unit);
+        }
+    }
+
+    return result;
+}
+
+// Genres can be stored as id3v1 genre numbers: "17", "(17)" or "(17)Rock"
+static std::string resolveGenre(const std::string& genre)
+{
+    std::string number = genre;
+    if (genre.size() > 2 && genre[0] == '(')
+    {
+        auto end = genre.find(')');
+        if (end == std::string::npos)
+        {
+            return genre;
+        }
+
+        if (end + 1 < genre.size())
+        {
+            return genre.substr(end + 1);
+        }
+
+        number = genre.substr(1, end - 1);
+    }
+
+    if (number.empty() || number.find_first_not_of("0123456789") != std::string::npos)
+    {
+        return genre;
+    }
+
+    auto index = parseNumber(number);
+    return index < sizeof(s_Genres) / sizeof(s_Genres[0]) ? s_Genres[index] : genre;
+}
+
+static bool parseId3v2Frames(const std::vector<uint8_t>& tag, uint32_t version, StringArena& arena, MetadataFields& fields)
+{
+    struct TextFrame
+    {
+        const char*         id;
+        std::string_view*   pValue;
+    };
+
+    const TextFrame textFrames[] = {
+        { "TPE1", &fields.artist },
+        { "TIT2", &fields.title },
+        { "TALB", &fields.album },
+        { "TPE2", &fields.albumArtist },
+        { "TCON", &fields.genre },
+        { "TCOM", &fields.composer }
+    };
+
+    size_t pos = 0;
+    while (pos + 10 <= tag.size())
+    {
+        const uint8_t* pFrame = tag.data() + pos;
+        if (pFrame[0] == 0)
+        {
+            // start of the padding
+            break;
+        }
+
+        uint32_t frameSize = version == 4 ? readSynchsafe(pFrame + 4) : readBigEndian(pFrame + 4, 4);
+        uint32_t flags     = readBigEndian(pFrame + 8, 2);
+        pos += 10;
+
+        if (frameSize > tag.size() - pos)
+        {
+            return false;
+        }
+
+        const uint8_t* pData = tag.data() + pos;
+        pos += frameSize;
+
+        if (pFrame[0] != 'T')
+        {
+            continue;
+        }
+
+        const TextFrame* pTextFrame = nullptr;
+        for (auto& textFrame : textFrames)
+        {
+            if (memcmp(pFrame, textFrame.id, 4) == 0)
+            {
+                pTextFrame = &textFrame;
+                break;
+            }
+        }
+
+        bool isNumber = memcmp(pFrame, "TRCK", 4) == 0 || memcmp(pFrame, "TPOS", 4) == 0 ||
+                        memcmp(pFrame, "TYER", 4) == 0 || memcmp(pFrame, "TDRC", 4) == 0;
+        if (!pTextFrame && !isNumber)
+        {
+            continue;
+        }
+
+        // compressed, encrypted, grouped or unsynchronised frames can not be decoded here,
+        // the tag is left to the full parser so the field is not silently missing
+        bool unsupported = version == 4 ? (flags & 0x004F) != 0 : (flags & 0x00E0) != 0;
+        if (unsupported)
+        {
+            return false;
+        }
+
+        if (pTextFrame)
+        {
+            if (pTextFrame->pValue->empty())
+            {
+                auto value = str::trim(decodeText(pData, frameSize));
+                *pTextFrame->pValue = arena.add(pTextFrame->pValue == &fields.genre ? resolveGenre(value) : value);
+            }
+        }
+        else if (memcmp(pFrame, "TRCK", 4) == 0 && fields.trackNr == 0)
+        {
+            fields.trackNr = parseNumber(decodeText(pData, frameSize));
+        }
+        else if (memcmp(pFrame, "TPOS", 4) == 0 && fields.discNr == 0)
+        {
+            fields.discNr = parseNumber(decodeText(pData, frameSize));
+        }
+        else if ((memcmp(pFrame, "TYER", 4) == 0 || memcmp(pFrame, "TDRC", 4) == 0) && fields.year == 0)
+        {
+            fields.year = parseNumber(decodeText(pData, frameSize));
+        }
+    }
+
+    return true;
+}
+
+static bool readMpeg(IReader& reader, bool readAudioProperties, StringArena& arena, MetadataFields& fields)
+{
+    uint8_t header[10];
+    if (reader.read(header, sizeof(header)) != sizeof(header) || memcmp(header, "ID3", 3) != 0)
+    {
+        // no id3v2 tag, the tags could be anywhere else in the file
+        return false;
+    }
+
+    uint32_t version = header[3];
+    uint32_t flags   = header[5];
+    uint32_t tagSize = readSynchsafe(header + 6);
+
+    // whole tag unsynchronisation is rare, leave it to the full parser
+    if ((version != 3 && version != 4) || (flags & 0x80))
+    {
+        return false;
+    }
+
+    // the size comes from the file, don't allocate more than the file can contain
+    uint64_t contentLength = reader.getContentLength();
+    if (contentLength < sizeof(header) || tagSize > contentLength - sizeof(header))
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> tag(tagSize);
+    if (reader.read(tag.data(), tagSize) != tagSize)
+    {
+        return false;
+    }
+
+    if (flags & 0x40)
+    {
+        // extended header, its size excludes itself in version 3
+        if (tag.size() < 4)
+        {
+            return false;
+        }
+
+        uint32_t extendedSize = version == 4 ? readSynchsafe(tag.data()) : readBigEndian(tag.data(), 4) + 4;
+        if (extendedSize > tag.size())
+        {
+            return false;
+        }
+
+        tag.erase(tag.begin(), tag.begin() + extendedSize);
+    }
+
+    if (!parseId3v2Frames(tag, version, arena, fields))
+    {
+        return false;
+    }
+
+    if (!readAudioProperties)
+    {
+        return true;
+    }
+
+    uint32_t id3Size = 10 + tagSize + ((flags & 0x10) ? 10 : 0);
+    reader.seekAbsolute(id3Size);
+
+    uint32_t xingPos;
+    MpegUtils::MpegHeader mpegHeader;
+    if (MpegUtils::readMpegHeader(reader, mpegHeader, xingPos) == 0 || mpegHeader.sampleRate == 0)
+    {
+        return false;
+    }
+
+    fields.sampleRate   = mpegHeader.sampleRate;
+    fields.channels     = mpegHeader.numChannels;
+    fields.bitRate      = mpegHeader.bitRate;
+
+    MpegUtils::XingHeader xingHeader;
+    reader.seekAbsolute(id3Size + xingPos);
+    if (MpegUtils::readXingHeader(reader, xingHeader) > 0 && xingHeader.numFrames > 0)
+    {
+        double seconds = static_cast<double>(xingHeader.numFrames) * mpegHeader.samplesPerFrame / mpegHeader.sampleRate;
+        fields.duration = static_cast<uint32_t>(seconds);
+        if (xingHeader.numBytes > 0 && seconds > 0)
+        {
+            fields.bitRate = static_cast<uint32_t>(xingHeader.numBytes * 8 / seconds / 1000);
+        }
+    }
+    else if (mpegHeader.bitRate > 0)
+    {
+        fields.duration = static_cast<uint32_t>((reader.getContentLength() - id3Size) / (mpegHeader.bitRate * 125));
+    }
+
+    return true;
+}
+
+static bool parseVorbisComment(const std::vector<uint8_t>& block, StringArena& arena, MetadataFields& fields)
+{
+    struct Field
+    {
+        const char*         key;
+        std::string_view*   pValue;
+    };
+
+    const Field stringFields[] = {
+        { "ARTIST", &fields.artist },
+        { "TITLE", &fields.title },
+        { "ALBUM", &fields.album },
+        { "ALBUMARTIST", &fields.albumArtist },
+        { "GENRE", &fields.genre },
+        { "COMPOSER", &fields.composer }
+    };
+
+    size_t pos = 0;
+    auto readLength = [&] (uint32_t& length) {
+        if (pos + 4 > block.size())
+        {
+            return false;
+        }
+
+        length = readLittleEndian32(block.data() + pos);
+        pos += 4;
+        return length <= block.size() - pos;
+    };
+
+    uint32_t vendorLength, count;
+    if (!readLength(vendorLength))
+    {
+        return false;
+    }
+
+    pos += vendorLength;
+    if (pos + 4 > block.size())
+    {
+        return false;
+    }
+
+    count = readLittleEndian32(block.data() + pos);
+    pos += 4;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t length;
+        if (!readLength(length))
+        {
+            return false;
+        }
+
+        const uint8_t* pComment = block.data() + pos;
+        pos += length;
+
+        auto* pSeparator = static_cast<const uint8_t*>(memchr(pComment, '=', length));
+        if (!pSeparator)
+        {
+            continue;
+        }
+
+        size_t keySize = pSeparator - pComment;
+        std::string value(reinterpret_cast<const char*>(pSeparator + 1), length - keySize - 1);
+
+        for (auto& field : stringFields)
+        {
+            if (field.pValue->empty() && equalsIgnoreCase(pComment, keySize, field.key))
+            {
+                *field.pValue = arena.add(str::trim(value));
+            }
+        }
+
+        if (fields.year == 0 && equalsIgnoreCase(pComment, keySize, "DATE"))
+        {
+            fields.year = parseNumber(value);
+        }
+        else if (fields.trackNr == 0 && equalsIgnoreCase(pComment, keySize, "TRACKNUMBER"))
+        {
+            fields.trackNr = parseNumber(value);
+        }
+        else if (fields.discNr == 0 && equalsIgnoreCase(pComment, keySize, "DISCNUMBER"))
+        {
+            fields.discNr = parseNumber(value);
+        }
+    }
+
+    return true;
+}
+
+static bool readFlac(IReader& reader, bool readAudioProperties, StringArena& arena, MetadataFields& fields)
+{
+    uint8_t marker[4];
+    if (reader.read(marker, sizeof(marker)) != sizeof(marker) || memcmp(marker, "fLaC", 4) != 0)
+    {
+        // possibly preceded by an id3v2 tag
+        return false;
+    }
+
+    uint64_t totalSamples = 0;
+    bool lastBlock = false;
+    std::vector<uint8_t> block;
+
+    while (!lastBlock)
+    {
+        uint8_t blockHeader[4];
+        if (reader.read(blockHeader, sizeof(blockHeader)) != sizeof(blockHeader))
+        {
+            return false;
+        }
+
+        lastBlock       = (blockHeader[0] & 0x80) != 0;
+        uint32_t type   = blockHeader[0] & 0x7F;
+        uint32_t length = readBigEndian(blockHeader + 1, 3);
+
+        // only the streaminfo and vorbis comment blocks are read, pictures and seektables are skipped
+        if (type != 0 && type != 4)
+        {
+            reader.seekRelative(length);
+            continue;
+        }
+
+        block.resize(length);
+        if (reader.read(block.data(), length) != length)
+        {
+            return false;
+        }
+
+        if (type == 0 && length >= 18)
+        {
+            const uint8_t* pInfo = block.data();
+            fields.sampleRate = pInfo[10] << 12 | pInfo[11] << 4 | pInfo[12] >> 4;
+            fields.channels   = ((pInfo[12] >> 1) & 0x07) + 1;
+            totalSamples      = static_cast<uint64_t>(pInfo[13] & 0x0F) << 32 | readBigEndian(pInfo + 14, 4);
+        }
+        else if (type == 4 && !parseVorbisComment(block, arena, fields))
+        {
+            return false;
+        }
+    }
+
+    if (readAudioProperties && fields.sampleRate > 0 && totalSamples > 0)
+    {
+        double seconds  = static_cast<double>(totalSamples) / fields.sampleRate;
+        fields.duration = static_cast<uint32_t>(seconds);
+        fields.bitRate  = static_cast<uint32_t>((reader.getContentLength() - reader.currentPosition()) * 8 / seconds / 1000);
+    }
+
+    if (!readAudioProperties)
+    {
+        fields.sampleRate = 0;
+        fields.channels = 0;
+    }
+
+    return true;
+}
+
+bool isSupported(const std::string& filepath)
+{
+    auto ext = str::lowercase(fileops::getFileExtension(filepath));
+    return ext == "mp3" || ext == "flac";
+}
+
+bool read(const std::string& filepath, bool readAudioProperties, StringArena& arena, MetadataFields& fields)
+{
+    auto ext = str::lowercase(fileops::getFileExtension(filepath));
+    if (ext != "mp3" && ext != "flac")
+    {
+        return false;
+    }
+
+    auto reader = ReaderFactory::createBuffered(filepath, READ_BUFFER_SIZE);
+    reader->open(filepath);
+
+    fields = MetadataFields();
+    return ext == "mp3" ? readMpeg(*reader, readAudioProperties, arena, fields)
+                        : readFlac(*reader, readAudioProperties, arena, fields);
+}
+
+}
+}
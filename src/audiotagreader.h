@@ -0,0 +1,44 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_TAG_READER_H
+#define AUDIO_TAG_READER_H
+
+#include <string>
+
+namespace audio
+{
+
+struct MetadataFields;
+class StringArena;
+
+// Minimal tag readers for the common file types that do not need taglib
+// Only the tag region of the file is read and only the indexed fields are decoded:
+// id3v2.3/2.4 tags at the start of mp3 files and the streaminfo and vorbis comment
+// blocks of flac files. Files with other or unusual tags are left to the full parser.
+namespace TagReader
+{
+
+bool isSupported(const std::string& filepath);
+// Returns false if the file could not be handled, the fields are then incomplete
+bool read(const std::string& filepath, bool readAudioProperties, StringArena& arena, MetadataFields& fields);
+
+}
+
+}
+
+#endif
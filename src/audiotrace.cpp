@@ -0,0 +1,177 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "audio/audiotrace.h"
+#include "audiotracepoints.h"
+
+#ifdef HAVE_TRACING
+#include "utils/log.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#endif
+
+namespace audio
+{
+
+#ifdef HAVE_TRACING
+
+namespace
+{
+
+// number of events that are kept, older events are overwritten
+const size_t TRACE_CAPACITY = 16384;
+
+// The fields are atomics so a slot can be read while it is overwritten,
+// the sequence number tells the reader whether the slot was modified while reading
+struct Slot
+{
+    std::atomic<uint64_t>       sequence {0};
+    std::atomic<const char*>    pName {nullptr};
+    std::atomic<int64_t>        start {0};
+    std::atomic<int64_t>        duration {0};
+    std::atomic<uint32_t>       threadId {0};
+};
+
+struct Event
+{
+    const char* pName;
+    int64_t     start;
+    int64_t     duration;
+    uint32_t    threadId;
+};
+
+std::array<Slot, TRACE_CAPACITY>    s_Slots;
+std::atomic<uint64_t>               s_NextEvent(0);
+std::atomic<uint32_t>               s_NextThreadId(1);
+
+int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t currentThreadId()
+{
+    thread_local uint32_t threadId = s_NextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return threadId;
+}
+
+void record(const char* pName, int64_t start, int64_t duration)
+{
+    auto index = s_NextEvent.fetch_add(1, std::memory_order_relaxed);
+    auto& slot = s_Slots[index % TRACE_CAPACITY];
+
+    // odd while being written
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.pName.store(pName, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.duration.store(duration, std::memory_order_relaxed);
+    slot.threadId.store(currentThreadId(), std::memory_order_relaxed);
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+}
+
+TraceScope::TraceScope(const char* pName)
+: m_pName(pName)
+, m_Start(now())
+{
+}
+
+TraceScope::~TraceScope()
+{
+    record(m_pName, m_Start, now() - m_Start);
+}
+
+bool Trace::isSupported()
+{
+    return true;
+}
+
+std::string Trace::exportChromeJson()
+{
+    std::vector<Event> events;
+    events.reserve(TRACE_CAPACITY);
+
+    for (auto& slot : s_Slots)
+    {
+        auto sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == 0 || (sequence & 1))
+        {
+            // empty or being written
+            continue;
+        }
+
+        Event event;
+        event.pName    = slot.pName.load(std::memory_order_relaxed);
+        event.start    = slot.start.load(std::memory_order_relaxed);
+        event.duration = slot.duration.load(std::memory_order_relaxed);
+        event.threadId = slot.threadId.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == sequence && event.pName)
+        {
+            events.push_back(event);
+        }
+    }
+
+    std::sort(events.begin(), events.end(), [] (const Event& lhs, const Event& rhs) { return lhs.start < rhs.start; });
+
+    // complete events, timestamps are in microseconds
+    std::string json = "{\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        auto& event = events[i];
+        json += fmt::format("{}{{\"name\":\"{}\",\"cat\":\"audio\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":1,\"tid\":{}}}",
+                            i == 0 ? "" : ",", event.pName, event.start / 1000.0, event.duration / 1000.0, event.threadId);
+    }
+
+    json += "],\"displayTimeUnit\":\"ms\"}";
+    return json;
+}
+
+void Trace::clear()
+{
+    for (auto& slot : s_Slots)
+    {
+        slot.sequence.store(0, std::memory_order_relaxed);
+    }
+}
+
+#else
+
+bool Trace::isSupported()
+{
+    return false;
+}
+
+std::string Trace::exportChromeJson()
+{
+    return "{\"traceEvents\":[]}";
+}
+
+void Trace::clear()
+{
+}
+
+#endif
+
+}
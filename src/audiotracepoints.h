@@ -0,0 +1,58 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#ifndef AUDIO_TRACE_POINTS_H
+#define AUDIO_TRACE_POINTS_H
+
+#include "audioconfig.h"
+
+#include <cinttypes>
+
+namespace audio
+{
+
+#ifdef HAVE_TRACING
+
+// Records the duration of its scope, the name must be a string literal
+// Recording does not allocate or format strings, it is cheap enough for the hot path.
+class TraceScope
+{
+public:
+    TraceScope(const char* pName);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_pName;
+    int64_t     m_Start;
+};
+
+#define AUDIO_TRACE_CONCAT_IMPL(a, b) a##b
+#define AUDIO_TRACE_CONCAT(a, b) AUDIO_TRACE_CONCAT_IMPL(a, b)
+#define AUDIO_TRACE_SCOPE(name) audio::TraceScope AUDIO_TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#else
+
+#define AUDIO_TRACE_SCOPE(name)
+
+#endif
+
+}
+
+#endif
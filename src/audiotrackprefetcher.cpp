@@ -0,0 +1,101 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "audiotrackprefetcher.h"
+
+#include "audio/audiodecoder.h"
+#include "audio/audiodecoderfactory.h"
+#include "audio/audiotrackinterface.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace audio
+{
+
+TrackPrefetcher::~TrackPrefetcher()
+{
+    clear();
+}
+
+void TrackPrefetcher::prefetch(const std::vector<std::shared_ptr<ITrack>>& tracks)
+{
+    std::deque<Entry> entries;
+
+    for (auto& track : tracks)
+    {
+        auto uri  = track->getUri();
+        auto iter = std::find_if(m_Entries.begin(), m_Entries.end(), [&] (const Entry& entry) { return entry.uri == uri; });
+        if (iter != m_Entries.end())
+        {
+            entries.push_back(std::move(*iter));
+            m_Entries.erase(iter);
+            continue;
+        }
+
+        auto decoder = std::async(std::launch::async, [uri] () {
+            return std::unique_ptr<IDecoder>(DecoderFactory::create(uri));
+        });
+
+        entries.push_back({uri, std::move(decoder)});
+    }
+
+    // tracks that are no longer upcoming (playlist was modified)
+    for (auto& entry : m_Entries)
+    {
+        discard(std::move(entry.decoder));
+    }
+
+    m_Entries = std::move(entries);
+}
+
+std::unique_ptr<IDecoder> TrackPrefetcher::takeDecoder(const ITrack& track)
+{
+    auto uri  = track.getUri();
+    auto iter = std::find_if(m_Entries.begin(), m_Entries.end(), [&] (const Entry& entry) { return entry.uri == uri; });
+    if (iter == m_Entries.end())
+    {
+        return std::unique_ptr<IDecoder>(DecoderFactory::create(uri));
+    }
+
+    auto decoder = std::move(iter->decoder);
+    m_Entries.erase(iter);
+
+    // rethrows the exception if the track could not be opened
+    return decoder.get();
+}
+
+void TrackPrefetcher::clear()
+{
+    for (auto& entry : m_Entries)
+    {
+        discard(std::move(entry.decoder));
+    }
+
+    m_Entries.clear();
+    m_Discarded.clear();
+}
+
+void TrackPrefetcher::discard(DecoderFuture future)
+{
+    m_Discarded.erase(std::remove_if(m_Discarded.begin(), m_Discarded.end(), [] (DecoderFuture& discarded) {
+        return discarded.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }), m_Discarded.end());
+
+    m_Discarded.push_back(std::move(future));
+}
+
+}
@@ -0,0 +1,67 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef AUDIO_TRACK_PREFETCHER_H
+#define AUDIO_TRACK_PREFETCHER_H
+
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace audio
+{
+
+class IDecoder;
+class ITrack;
+
+// Opens the upcoming tracks of the playlist in parallel in the background,
+// so starting the next track does not have to wait for the file to be
+// opened and its header to be parsed, and unreadable tracks are known in advance.
+// Not thread safe, it is only used from the playback thread.
+class TrackPrefetcher
+{
+public:
+    TrackPrefetcher() = default;
+    ~TrackPrefetcher();
+
+    // Open these tracks in the background, tracks that are already being opened are kept
+    void prefetch(const std::vector<std::shared_ptr<ITrack>>& tracks);
+    // Returns the decoder of the track, if it was not prefetched it is opened now
+    // Throws when the track could not be opened
+    std::unique_ptr<IDecoder> takeDecoder(const ITrack& track);
+    void clear();
+
+private:
+    using DecoderFuture = std::future<std::unique_ptr<IDecoder>>;
+
+    struct Entry
+    {
+        std::string     uri;
+        DecoderFuture   decoder;
+    };
+
+    void discard(DecoderFuture future);
+
+    std::deque<Entry>           m_Entries;
+    // futures of std::async block on destruction, they are kept until they are ready
+    std::vector<DecoderFuture>  m_Discarded;
+};
+
+}
+
+#endif
@@ -0,0 +1,129 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "gmock/gmock.h"
+
+#include "audiofade.h"
+#include "audio/audioformat.h"
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using namespace testing;
+
+namespace audio
+{
+namespace test
+{
+
+static Format format(uint32_t bits, bool floatingPoint = false)
+{
+    Format format;
+    format.bits = bits;
+    format.rate = 44100;
+    format.numChannels = 2;
+    format.floatingPoint = floatingPoint;
+    return format;
+}
+
+template <typename T>
+static std::vector<T> scale(std::vector<T> samples, const Format& format, int32_t volume)
+{
+    applyVolume(reinterpret_cast<uint8_t*>(samples.data()), static_cast<uint32_t>(samples.size() * sizeof(T)), format, volume);
+    return samples;
+}
+
+TEST(ApplyVolumeTest, Int16)
+{
+    std::vector<int16_t> samples { 0, 1000, -1000, 32767, -32768 };
+    EXPECT_EQ(samples, scale(samples, format(16), 100));
+    EXPECT_EQ(std::vector<int16_t>({ 0, 500, -500, 16384, -16384 }), scale(samples, format(16), 50));
+    EXPECT_EQ(std::vector<int16_t>({ 0, 0, 0, 0, 0 }), scale(samples, format(16), 0));
+}
+
+TEST(ApplyVolumeTest, Int16Clamps)
+{
+    std::vector<int16_t> samples { 1000, -1000, 20000, -20000 };
+    EXPECT_EQ(std::vector<int16_t>({ 2000, -2000, 32767, -32768 }), scale(samples, format(16), 200));
+}
+
+TEST(ApplyVolumeTest, Int24In32)
+{
+    std::vector<int32_t> samples { 0, 0x400000, -0x400000, 0x7FFFFF, -0x800000 };
+    EXPECT_EQ(samples, scale(samples, format(24), 100));
+    EXPECT_EQ(std::vector<int32_t>({ 0, 0x200000, -0x200000, 0x400000, -0x400000 }), scale(samples, format(24), 50));
+    EXPECT_EQ(std::vector<int32_t>({ 0, 0, 0, 0, 0 }), scale(samples, format(24), 0));
+}
+
+TEST(ApplyVolumeTest, Int24In32Clamps)
+{
+    // the samples are clamped to the 24 bit range, not to the range of the container
+    std::vector<int32_t> samples { 0x100000, -0x100000, 0x600000, -0x600000 };
+    EXPECT_EQ(std::vector<int32_t>({ 0x200000, -0x200000, 0x7FFFFF, -0x800000 }), scale(samples, format(24), 200));
+}
+
+TEST(ApplyVolumeTest, Int32)
+{
+    std::vector<int32_t> samples { 0, 1 << 30, -(1 << 30), std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::min() };
+    EXPECT_EQ(samples, scale(samples, format(32), 100));
+    EXPECT_EQ(std::vector<int32_t>({ 0, 1 << 29, -(1 << 29), 1 << 30, -(1 << 30) }), scale(samples, format(32), 50));
+    EXPECT_EQ(std::vector<int32_t>({ 0, 0, 0, 0, 0 }), scale(samples, format(32), 0));
+}
+
+TEST(ApplyVolumeTest, Int32Clamps)
+{
+    std::vector<int32_t> samples { 1 << 20, 1 << 30, -(1 << 30), std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::min() };
+    auto max = std::numeric_limits<int32_t>::max();
+    auto min = std::numeric_limits<int32_t>::min();
+    EXPECT_EQ(std::vector<int32_t>({ 1 << 21, max, min, max, min }), scale(samples, format(32), 200));
+}
+
+TEST(ApplyVolumeTest, Float)
+{
+    std::vector<float> samples { 0.f, 0.5f, -0.5f, 1.f, -1.f };
+    EXPECT_EQ(samples, scale(samples, format(32, true), 100));
+    EXPECT_THAT(scale(samples, format(32, true), 50), ElementsAre(0.f, 0.25f, -0.25f, 0.5f, -0.5f));
+    EXPECT_THAT(scale(samples, format(32, true), 0), Each(0.f));
+
+    // float samples are not clamped, the device clips them
+    EXPECT_THAT(scale(samples, format(32, true), 200), ElementsAre(0.f, 1.f, -1.f, 2.f, -2.f));
+}
+
+TEST(ApplyVolumeTest, UnsupportedFormatsAreUntouched)
+{
+    std::vector<uint8_t> samples { 0, 64, 128, 255 };
+    EXPECT_EQ(samples, scale(samples, format(8), 50));
+
+    std::vector<double> doubles { 0.5, -0.5 };
+    EXPECT_EQ(doubles, scale(doubles, format(64, true), 50));
+}
+
+TEST(ApplyVolumeTest, PartialSampleIsUntouched)
+{
+    std::vector<int16_t> samples { 1000, 1000 };
+    applyVolume(reinterpret_cast<uint8_t*>(samples.data()), 3, format(16), 50);
+    EXPECT_EQ(500, samples[0]);
+
+    int16_t lastSample = 1000;
+    uint8_t lastBytes[2];
+    memcpy(lastBytes, &lastSample, sizeof(lastBytes));
+    EXPECT_EQ(0, memcmp(lastBytes, &samples[1], sizeof(lastBytes)));
+}
+
+}
+}
@@ -0,0 +1,268 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "gmock/gmock.h"
+
+#include "audio/audiometadatacache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace testing;
+
+namespace audio
+{
+namespace test
+{
+
+class MetadataCacheTest : public Test
+{
+protected:
+    void SetUp() override
+    {
+        m_Directory = std::filesystem::temp_directory_path() / "audiometadatacachetest";
+        std::filesystem::remove_all(m_Directory);
+        std::filesystem::create_directories(m_Directory);
+        m_CachePath = (m_Directory / "metadata.cache").string();
+
+        m_Stamp.size             = 1234;
+        m_Stamp.modificationTime = 5678;
+
+        m_Track.artist       = "Artist";
+        m_Track.title        = "Title";
+        m_Track.album        = "Album";
+        m_Track.albumArtist  = "Album Artist";
+        m_Track.genre        = "Rock";
+        m_Track.composer     = "Composer";
+        m_Track.discNr       = 2;
+        m_Track.year         = 1999;
+        m_Track.trackNr      = 7;
+        m_Track.bitRate      = 320;
+        m_Track.sampleRate   = 44100;
+        m_Track.channels     = 2;
+        m_Track.duration     = 245;
+        m_Track.albumArtHash = 0x0123456789ABCDEF;
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(m_Directory);
+    }
+
+    void storeAndSave(uint32_t fields)
+    {
+        MetadataCache cache(m_CachePath);
+        cache.store("/music/song.mp3", m_Stamp, fields, m_Track);
+        cache.save();
+    }
+
+    std::vector<char> readCacheFile()
+    {
+        std::ifstream stream(m_CachePath, std::ios::binary);
+        return std::vector<char>((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    }
+
+    void writeCacheFile(const std::vector<char>& data)
+    {
+        std::ofstream stream(m_CachePath, std::ios::binary | std::ios::trunc);
+        stream.write(data.data(), data.size());
+    }
+
+    void expectEmpty()
+    {
+        MetadataCache cache(m_CachePath);
+        TrackMetadata track;
+        EXPECT_FALSE(cache.lookup("/music/song.mp3", m_Stamp, 0, track));
+
+        // a corrupt cache is replaced on the next save
+        cache.store("/music/song.mp3", m_Stamp, 0, m_Track);
+        cache.save();
+
+        MetadataCache reopened(m_CachePath);
+        EXPECT_TRUE(reopened.lookup("/music/song.mp3", m_Stamp, 0, track));
+    }
+
+    std::filesystem::path   m_Directory;
+    std::string             m_CachePath;
+    FileStamp               m_Stamp;
+    TrackMetadata           m_Track;
+};
+
+static const uint32_t ALL_FIELDS = MetadataCache::AudioProperties | MetadataCache::AlbumArtHash;
+
+TEST_F(MetadataCacheTest, RoundTrip)
+{
+    storeAndSave(ALL_FIELDS);
+
+    MetadataCache cache(m_CachePath);
+    TrackMetadata track;
+    ASSERT_TRUE(cache.lookup("/music/song.mp3", m_Stamp, ALL_FIELDS, track));
+
+    EXPECT_EQ("/music/song.mp3", track.path);
+    EXPECT_EQ(m_Track.artist, track.artist);
+    EXPECT_EQ(m_Track.title, track.title);
+    EXPECT_EQ(m_Track.album, track.album);
+    EXPECT_EQ(m_Track.albumArtist, track.albumArtist);
+    EXPECT_EQ(m_Track.genre, track.genre);
+    EXPECT_EQ(m_Track.composer, track.composer);
+    EXPECT_EQ(m_Track.discNr, track.discNr);
+    EXPECT_EQ(m_Track.year, track.year);
+    EXPECT_EQ(m_Track.trackNr, track.trackNr);
+    EXPECT_EQ(m_Track.bitRate, track.bitRate);
+    EXPECT_EQ(m_Track.sampleRate, track.sampleRate);
+    EXPECT_EQ(m_Track.channels, track.channels);
+    EXPECT_EQ(m_Track.duration, track.duration);
+    EXPECT_EQ(m_Track.albumArtHash, track.albumArtHash);
+
+    EXPECT_FALSE(cache.lookup("/music/other.mp3", m_Stamp, 0, track));
+}
+
+TEST_F(MetadataCacheTest, LookupBeforeSave)
+{
+    MetadataCache cache(m_CachePath);
+    cache.store("/music/song.mp3", m_Stamp, 0, m_Track);
+
+    TrackMetadata track;
+    EXPECT_TRUE(cache.lookup("/music/song.mp3", m_Stamp, 0, track));
+    EXPECT_EQ(m_Track.title, track.title);
+}
+
+TEST_F(MetadataCacheTest, ChangedFileIsNotUsed)
+{
+    storeAndSave(0);
+
+    MetadataCache cache(m_CachePath);
+    TrackMetadata track;
+
+    auto stamp = m_Stamp;
+    stamp.size += 1;
+    EXPECT_FALSE(cache.lookup("/music/song.mp3", stamp, 0, track));
+
+    stamp = m_Stamp;
+    stamp.modificationTime += 1;
+    EXPECT_FALSE(cache.lookup("/music/song.mp3", stamp, 0, track));
+}
+
+TEST_F(MetadataCacheTest, MissingFieldsAreNotUsed)
+{
+    storeAndSave(0);
+
+    {
+        // read without audio properties or album art, the zero values are not valid for other scans
+        MetadataCache cache(m_CachePath);
+        TrackMetadata track;
+        EXPECT_TRUE(cache.lookup("/music/song.mp3", m_Stamp, 0, track));
+        EXPECT_FALSE(cache.lookup("/music/song.mp3", m_Stamp, MetadataCache::AudioProperties, track));
+        EXPECT_FALSE(cache.lookup("/music/song.mp3", m_Stamp, MetadataCache::AlbumArtHash, track));
+    }
+
+    storeAndSave(MetadataCache::AudioProperties);
+
+    MetadataCache cache(m_CachePath);
+    TrackMetadata track;
+    EXPECT_TRUE(cache.lookup("/music/song.mp3", m_Stamp, MetadataCache::AudioProperties, track));
+    EXPECT_FALSE(cache.lookup("/music/song.mp3", m_Stamp, ALL_FIELDS, track));
+}
+
+TEST_F(MetadataCacheTest, DropUnused)
+{
+    {
+        MetadataCache cache(m_CachePath);
+        cache.store("/music/a.mp3", m_Stamp, 0, m_Track);
+        cache.store("/music/b.mp3", m_Stamp, 0, m_Track);
+        cache.save();
+    }
+
+    {
+        MetadataCache cache(m_CachePath);
+        TrackMetadata track;
+        EXPECT_TRUE(cache.lookup("/music/a.mp3", m_Stamp, 0, track));
+        cache.save(true);
+    }
+
+    MetadataCache cache(m_CachePath);
+    TrackMetadata track;
+    EXPECT_TRUE(cache.lookup("/music/a.mp3", m_Stamp, 0, track));
+    EXPECT_FALSE(cache.lookup("/music/b.mp3", m_Stamp, 0, track));
+}
+
+TEST_F(MetadataCacheTest, MissingFile)
+{
+    expectEmpty();
+}
+
+TEST_F(MetadataCacheTest, TruncatedFile)
+{
+    storeAndSave(0);
+    auto data = readCacheFile();
+
+    data.resize(data.size() - 1);
+    writeCacheFile(data);
+    expectEmpty();
+
+    data.resize(10);
+    writeCacheFile(data);
+    expectEmpty();
+
+    data.clear();
+    writeCacheFile(data);
+    expectEmpty();
+}
+
+TEST_F(MetadataCacheTest, CorruptHeader)
+{
+    storeAndSave(0);
+    auto original = readCacheFile();
+
+    // magic
+    auto data = original;
+    data[0] = 'X';
+    writeCacheFile(data);
+    expectEmpty();
+
+    // version
+    data = original;
+    data[4] = 99;
+    writeCacheFile(data);
+    expectEmpty();
+
+    // record count larger than the file
+    data = original;
+    data[8 + 7] = 0x10;
+    writeCacheFile(data);
+    expectEmpty();
+}
+
+TEST_F(MetadataCacheTest, CorruptStringReference)
+{
+    storeAndSave(0);
+    auto data = readCacheFile();
+
+    // the path offset of the first record (header: 24 bytes, path reference at byte 32 of the record)
+    data[24 + 32 + 3] = 0x7F;
+    writeCacheFile(data);
+
+    MetadataCache cache(m_CachePath);
+    TrackMetadata track;
+    EXPECT_FALSE(cache.lookup("/music/song.mp3", m_Stamp, 0, track));
+}
+
+}
+}
@@ -0,0 +1,129 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "gmock/gmock.h"
+
+#include "audiompscqueue.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace testing;
+
+namespace audio
+{
+namespace test
+{
+
+TEST(MpscQueueTest, EmptyQueue)
+{
+    MpscQueue<int> queue;
+
+    int value = 0;
+    EXPECT_FALSE(queue.pop(value));
+}
+
+TEST(MpscQueueTest, SingleProducerOrder)
+{
+    MpscQueue<int> queue;
+    for (int i = 0; i < 100; ++i)
+    {
+        queue.push(i);
+    }
+
+    int value = -1;
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT_TRUE(queue.pop(value));
+        EXPECT_EQ(i, value);
+    }
+
+    EXPECT_FALSE(queue.pop(value));
+
+    // the queue keeps working after it ran empty
+    queue.push(100);
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(100, value);
+    EXPECT_FALSE(queue.pop(value));
+}
+
+TEST(MpscQueueTest, MoveOnlyValues)
+{
+    MpscQueue<std::unique_ptr<int>> queue;
+    queue.push(std::make_unique<int>(1));
+    queue.push(std::make_unique<int>(2));
+
+    std::unique_ptr<int> value;
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(1, *value);
+
+    // the remaining value is destroyed with the queue
+    queue.push(std::make_unique<int>(3));
+}
+
+TEST(MpscQueueTest, MultipleProducers)
+{
+    static const uint32_t producerCount = 4;
+    static const uint32_t valuesPerProducer = 100000;
+
+    MpscQueue<uint64_t> queue;
+
+    std::vector<std::thread> producers;
+    for (uint32_t producer = 0; producer < producerCount; ++producer)
+    {
+        producers.emplace_back([&queue, producer] () {
+            for (uint32_t i = 0; i < valuesPerProducer; ++i)
+            {
+                queue.push(static_cast<uint64_t>(producer) << 32 | i);
+            }
+        });
+    }
+
+    // the values of every producer arrive complete and in the order they were pushed
+    std::vector<uint32_t> expected(producerCount, 0);
+    uint64_t received = 0;
+    bool ordered = true;
+    while (received < producerCount * valuesPerProducer)
+    {
+        uint64_t value;
+        if (!queue.pop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        auto producer = static_cast<uint32_t>(value >> 32);
+        ASSERT_LT(producer, producerCount);
+        ordered = ordered && static_cast<uint32_t>(value) == expected[producer];
+        expected[producer] = static_cast<uint32_t>(value) + 1;
+        ++received;
+    }
+
+    for (auto& thread : producers)
+    {
+        thread.join();
+    }
+
+    uint64_t value;
+    EXPECT_FALSE(queue.pop(value));
+    EXPECT_TRUE(ordered);
+    EXPECT_THAT(expected, Each(valuesPerProducer));
+}
+
+}
+}
@@ -0,0 +1,175 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "gmock/gmock.h"
+
+#include "audio/audioplaylistparser.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace testing;
+
+namespace audio
+{
+namespace test
+{
+
+struct ParsedEntry
+{
+    std::string path;
+    std::string title;
+    double      duration;
+};
+
+static std::vector<ParsedEntry> parse(const std::string& contents)
+{
+    std::vector<ParsedEntry> entries;
+    auto count = PlaylistParser::parse(contents, [&] (const PlaylistEntry& entry) {
+        entries.push_back({ std::string(entry.path), std::string(entry.title), entry.duration });
+    });
+
+    EXPECT_EQ(entries.size(), count);
+    return entries;
+}
+
+TEST(PlaylistParserTest, M3u)
+{
+    auto entries = parse("#EXTM3U\n#EXTINF:123,Artist - Title\nsong.mp3\n\nother.mp3\n");
+
+    ASSERT_EQ(2u, entries.size());
+    EXPECT_EQ("song.mp3", entries[0].path);
+    EXPECT_EQ("Artist - Title", entries[0].title);
+    EXPECT_DOUBLE_EQ(123.0, entries[0].duration);
+    EXPECT_EQ("other.mp3", entries[1].path);
+    EXPECT_EQ("", entries[1].title);
+    EXPECT_LT(entries[1].duration, 0.0);
+}
+
+TEST(PlaylistParserTest, ExtInfQuotedComma)
+{
+    auto entries = parse("#EXTM3U\n#EXTINF:-1 tvg-name=\"Radio, One\" group-title=\"A,B\",Radio One\nhttp://host/stream\n");
+
+    ASSERT_EQ(1u, entries.size());
+    EXPECT_EQ("http://host/stream", entries[0].path);
+    EXPECT_EQ("Radio One", entries[0].title);
+    EXPECT_LT(entries[0].duration, 0.0);
+}
+
+TEST(PlaylistParserTest, CrLfAndBom)
+{
+    auto entries = parse("\xEF\xBB\xBF#EXTM3U\r\n#EXTINF:10,Title\r\nsong.mp3\r\n");
+
+    ASSERT_EQ(1u, entries.size());
+    EXPECT_EQ("song.mp3", entries[0].path);
+    EXPECT_EQ("Title", entries[0].title);
+    EXPECT_DOUBLE_EQ(10.0, entries[0].duration);
+}
+
+TEST(PlaylistParserTest, Pls)
+{
+    auto entries = parse("\xEF\xBB\xBF[playlist]\r\nFile1=a.mp3\r\nTitle1=A\r\nLength1=10\r\nFile2=b.mp3\r\nNumberOfEntries=2\r\nVersion=2\r\n");
+
+    ASSERT_EQ(2u, entries.size());
+    EXPECT_EQ("a.mp3", entries[0].path);
+    EXPECT_EQ("A", entries[0].title);
+    EXPECT_DOUBLE_EQ(10.0, entries[0].duration);
+    EXPECT_EQ("b.mp3", entries[1].path);
+    EXPECT_EQ("", entries[1].title);
+}
+
+TEST(PlaylistParserTest, PlsKeysNotAdjacent)
+{
+    auto entries = parse("[playlist]\nFile2=b.mp3\nFile1=a.mp3\nTitle2=B\nTitle1=A\nLength2=20\nFile10=c.mp3\n");
+
+    ASSERT_EQ(3u, entries.size());
+    EXPECT_EQ("a.mp3", entries[0].path);
+    EXPECT_EQ("A", entries[0].title);
+    EXPECT_EQ("b.mp3", entries[1].path);
+    EXPECT_EQ("B", entries[1].title);
+    EXPECT_DOUBLE_EQ(20.0, entries[1].duration);
+    EXPECT_EQ("c.mp3", entries[2].path);
+}
+
+TEST(PlaylistParserTest, Malformed)
+{
+    EXPECT_TRUE(parse("").empty());
+    EXPECT_TRUE(parse("\xEF\xBB\xBF").empty());
+    EXPECT_TRUE(parse("#EXTM3U\n#EXTINF:abc\n").empty());
+
+    // entries without a file and keys without a valid number are ignored
+    auto entries = parse("[playlist]\nTitle1=No file\nFileX=x.mp3\nFile=y.mp3\nnonsense\nFile3=c.mp3\n");
+    ASSERT_EQ(1u, entries.size());
+    EXPECT_EQ("c.mp3", entries[0].path);
+}
+
+TEST(PlaylistParserTest, ResolvePath)
+{
+    EXPECT_EQ("/music/list/song.mp3", PlaylistParser::resolvePath("/music/list/a.m3u", "song.mp3"));
+    EXPECT_EQ("/music/list/sub/song.mp3", PlaylistParser::resolvePath("/music/list/a.m3u", "./sub/song.mp3"));
+    EXPECT_EQ("/music/list/../song.mp3", PlaylistParser::resolvePath("/music/list/a.m3u", "../song.mp3"));
+    EXPECT_EQ("/other/song.mp3", PlaylistParser::resolvePath("/music/list/a.m3u", "/other/song.mp3"));
+    EXPECT_EQ("C:\\music\\song.mp3", PlaylistParser::resolvePath("/music/list/a.m3u", "C:\\music\\song.mp3"));
+    EXPECT_EQ("http://host/song.mp3", PlaylistParser::resolvePath("/music/list/a.m3u", "http://host/song.mp3"));
+    EXPECT_EQ("song.mp3", PlaylistParser::resolvePath("a.m3u", "song.mp3"));
+}
+
+TEST(PlaylistParserTest, ParseFileResolvesRelativePaths)
+{
+    auto directory = std::filesystem::temp_directory_path() / "audioplaylisttest";
+    std::filesystem::create_directories(directory);
+    auto path = (directory / "list.m3u").string();
+    {
+        std::ofstream stream(path, std::ios::binary);
+        stream << "#EXTM3U\r\nsong.mp3\r\n/abs/song.mp3\r\n";
+    }
+
+    std::vector<std::string> resolved;
+    auto count = PlaylistParser::parseFile(path, [&] (const PlaylistEntry&, const std::string& resolvedPath) {
+        resolved.push_back(resolvedPath);
+    });
+
+    std::filesystem::remove_all(directory);
+
+    ASSERT_EQ(2u, count);
+    EXPECT_EQ((directory / "song.mp3").string(), resolved[0]);
+    EXPECT_EQ("/abs/song.mp3", resolved[1]);
+}
+
+TEST(PlaylistParserTest, ParseFileEmptyFile)
+{
+    auto directory = std::filesystem::temp_directory_path() / "audioplaylisttest";
+    std::filesystem::create_directories(directory);
+    auto path = (directory / "empty.m3u").string();
+    std::ofstream(path, std::ios::binary).close();
+
+    auto count = PlaylistParser::parseFile(path, [] (const PlaylistEntry&, const std::string&) {});
+    std::filesystem::remove_all(directory);
+
+    EXPECT_EQ(0u, count);
+}
+
+TEST(PlaylistParserTest, ParseFileMissingFile)
+{
+    auto path = (std::filesystem::temp_directory_path() / "audioplaylisttest" / "missing.m3u").string();
+    EXPECT_THROW(PlaylistParser::parseFile(path, [] (const PlaylistEntry&, const std::string&) {}), std::logic_error);
+}
+
+}
+}
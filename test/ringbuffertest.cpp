@@ -0,0 +1,222 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "gmock/gmock.h"
+
+#include "audioringbuffer.h"
+
+#include <deque>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace testing;
+
+namespace audio
+{
+namespace test
+{
+
+static std::vector<uint8_t> sequence(uint8_t start, uint32_t size)
+{
+    std::vector<uint8_t> data(size);
+    std::iota(data.begin(), data.end(), start);
+    return data;
+}
+
+TEST(RingBufferTest, Empty)
+{
+    RingBuffer buffer(16);
+    EXPECT_EQ(16u, buffer.size());
+    EXPECT_EQ(0u, buffer.bytesUsed());
+    EXPECT_EQ(16u, buffer.bytesFree());
+
+    uint8_t data[4];
+    EXPECT_EQ(0u, buffer.readData(data, sizeof(data)));
+
+    uint8_t* pData = data;
+    EXPECT_EQ(0u, buffer.peek(0, pData));
+    EXPECT_EQ(nullptr, pData);
+}
+
+TEST(RingBufferTest, Full)
+{
+    RingBuffer buffer(16);
+    auto data = sequence(0, 16);
+    buffer.writeData(data.data(), 16);
+    EXPECT_EQ(16u, buffer.bytesUsed());
+    EXPECT_EQ(0u, buffer.bytesFree());
+    EXPECT_THROW(buffer.writeData(data.data(), 1), std::logic_error);
+
+    std::vector<uint8_t> read(20);
+    EXPECT_EQ(16u, buffer.readData(read.data(), 20));
+    read.resize(16);
+    EXPECT_EQ(data, read);
+    EXPECT_EQ(0u, buffer.bytesUsed());
+
+    // full again after the positions moved
+    buffer.writeData(data.data(), 5);
+    EXPECT_EQ(5u, buffer.readData(read.data(), 5));
+    buffer.writeData(data.data(), 16);
+    EXPECT_EQ(0u, buffer.bytesFree());
+    EXPECT_THROW(buffer.writeData(data.data(), 1), std::logic_error);
+    EXPECT_EQ(16u, buffer.readData(read.data(), 16));
+    EXPECT_EQ(data, read);
+}
+
+TEST(RingBufferTest, WrapAround)
+{
+    RingBuffer buffer(10);
+    std::vector<uint8_t> read(10);
+
+    buffer.writeData(sequence(0, 7).data(), 7);
+    EXPECT_EQ(5u, buffer.readData(read.data(), 5));
+
+    // 3 bytes at the end of the storage, 5 at the start
+    buffer.writeData(sequence(7, 8).data(), 8);
+    EXPECT_EQ(10u, buffer.bytesUsed());
+    EXPECT_EQ(10u, buffer.readData(read.data(), 10));
+    EXPECT_EQ(sequence(5, 10), read);
+}
+
+TEST(RingBufferTest, WrapAroundModel)
+{
+    // odd sizes so the wrap point moves through the storage
+    RingBuffer buffer(13);
+    std::deque<uint8_t> model;
+    uint8_t next = 0;
+
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        uint32_t writeSize = (i * 7) % 14;
+        if (writeSize <= buffer.bytesFree())
+        {
+            auto data = sequence(next, writeSize);
+            buffer.writeData(data.data(), writeSize);
+            model.insert(model.end(), data.begin(), data.end());
+            next += static_cast<uint8_t>(writeSize);
+        }
+
+        ASSERT_EQ(model.size(), buffer.bytesUsed());
+
+        uint32_t readSize = (i * 5) % 14;
+        std::vector<uint8_t> read(readSize);
+        read.resize(buffer.readData(read.data(), readSize));
+        ASSERT_EQ(std::min<size_t>(readSize, model.size()), read.size());
+        ASSERT_TRUE(std::equal(read.begin(), read.end(), model.begin()));
+        model.erase(model.begin(), model.begin() + read.size());
+    }
+}
+
+TEST(RingBufferTest, PeekAcrossWrapAround)
+{
+    RingBuffer buffer(10);
+    std::vector<uint8_t> read(10);
+    buffer.writeData(sequence(0, 8).data(), 8);
+    buffer.readData(read.data(), 6);
+    buffer.writeData(sequence(8, 6).data(), 6);
+
+    // the data is returned in two contiguous blocks
+    uint8_t* pData = nullptr;
+    ASSERT_EQ(4u, buffer.peek(0, pData));
+    EXPECT_EQ(std::vector<uint8_t>({ 6, 7, 8, 9 }), std::vector<uint8_t>(pData, pData + 4));
+
+    ASSERT_EQ(2u, buffer.peek(2, pData));
+    EXPECT_EQ(8, pData[0]);
+
+    ASSERT_EQ(4u, buffer.peek(4, pData));
+    EXPECT_EQ(std::vector<uint8_t>({ 10, 11, 12, 13 }), std::vector<uint8_t>(pData, pData + 4));
+
+    EXPECT_EQ(0u, buffer.peek(8, pData));
+    EXPECT_EQ(8u, buffer.bytesUsed());
+}
+
+TEST(RingBufferTest, TruncateAndClear)
+{
+    RingBuffer buffer(10);
+    std::vector<uint8_t> read(10);
+    buffer.writeData(sequence(0, 8).data(), 8);
+    buffer.readData(read.data(), 6);
+    buffer.writeData(sequence(8, 6).data(), 6);
+
+    // larger than the buffered data: nothing changes
+    buffer.truncate(9);
+    EXPECT_EQ(8u, buffer.bytesUsed());
+
+    buffer.truncate(5);
+    EXPECT_EQ(5u, buffer.bytesUsed());
+    EXPECT_EQ(5u, buffer.readData(read.data(), 10));
+    EXPECT_EQ(sequence(6, 5), std::vector<uint8_t>(read.begin(), read.begin() + 5));
+
+    buffer.writeData(sequence(0, 10).data(), 10);
+    buffer.clear();
+    EXPECT_EQ(0u, buffer.bytesUsed());
+    EXPECT_EQ(10u, buffer.bytesFree());
+    EXPECT_EQ(0u, buffer.readData(read.data(), 10));
+}
+
+TEST(RingBufferTest, ProducerAndConsumerThreads)
+{
+    static const uint32_t totalSize = 1000000;
+    RingBuffer buffer(4099);
+
+    std::thread producer([&buffer] () {
+        uint32_t written = 0;
+        uint8_t next = 0;
+        while (written < totalSize)
+        {
+            uint32_t size = std::min(std::min(totalSize - written, 1000u), buffer.bytesFree());
+            if (size == 0)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            auto data = sequence(next, size);
+            buffer.writeData(data.data(), size);
+            next += static_cast<uint8_t>(size);
+            written += size;
+        }
+    });
+
+    uint32_t received = 0;
+    uint8_t expected = 0;
+    bool ordered = true;
+    std::vector<uint8_t> read(777);
+    while (received < totalSize)
+    {
+        auto size = buffer.readData(read.data(), static_cast<uint32_t>(read.size()));
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            ordered = ordered && read[i] == expected++;
+        }
+
+        received += size;
+        if (size == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    producer.join();
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(0u, buffer.bytesUsed());
+}
+
+}
+}
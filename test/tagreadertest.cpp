@@ -0,0 +1,472 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include "gmock/gmock.h"
+
+#include "audiotagreader.h"
+#include "audio/audiometadata.h"
+#include "audio/audiostringarena.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace testing;
+
+namespace audio
+{
+namespace test
+{
+
+using Bytes = std::vector<uint8_t>;
+
+static void append(Bytes& data, const Bytes& other)
+{
+    data.insert(data.end(), other.begin(), other.end());
+}
+
+static void append(Bytes& data, const std::string& value)
+{
+    data.insert(data.end(), value.begin(), value.end());
+}
+
+static Bytes synchsafe(uint32_t value)
+{
+    return { uint8_t((value >> 21) & 0x7F), uint8_t((value >> 14) & 0x7F), uint8_t((value >> 7) & 0x7F), uint8_t(value & 0x7F) };
+}
+
+static Bytes bigEndian(uint32_t value)
+{
+    return { uint8_t(value >> 24), uint8_t(value >> 16), uint8_t(value >> 8), uint8_t(value) };
+}
+
+static Bytes text(uint8_t encoding, const std::string& value)
+{
+    Bytes payload { encoding };
+    append(payload, value);
+    return payload;
+}
+
+// the units are written in the given byte order, optionally preceded by a byte order mark
+static Bytes utf16(uint8_t encoding, const std::u16string& value, bool bigEndianOrder, bool byteOrderMark)
+{
+    Bytes payload { encoding };
+    auto addUnit = [&] (char16_t unit) {
+        uint8_t high = uint8_t(unit >> 8), low = uint8_t(unit & 0xFF);
+        payload.push_back(bigEndianOrder ? high : low);
+        payload.push_back(bigEndianOrder ? low : high);
+    };
+
+    if (byteOrderMark)
+    {
+        addUnit(0xFEFF);
+    }
+
+    for (auto unit : value)
+    {
+        addUnit(unit);
+    }
+
+    return payload;
+}
+
+static Bytes frame(uint32_t version, const std::string& id, const Bytes& payload, uint16_t flags = 0)
+{
+    Bytes data;
+    append(data, id);
+    append(data, version == 4 ? synchsafe(uint32_t(payload.size())) : bigEndian(uint32_t(payload.size())));
+    data.push_back(uint8_t(flags >> 8));
+    data.push_back(uint8_t(flags & 0xFF));
+    append(data, payload);
+    return data;
+}
+
+static Bytes tag(uint32_t version, const Bytes& frames, uint8_t flags = 0, uint32_t padding = 0)
+{
+    Bytes data;
+    append(data, std::string("ID3"));
+    data.push_back(uint8_t(version));
+    data.push_back(0);
+    data.push_back(flags);
+    append(data, synchsafe(uint32_t(frames.size() + padding)));
+    append(data, frames);
+    data.resize(data.size() + padding, 0);
+    return data;
+}
+
+static Bytes littleEndian(uint32_t value)
+{
+    return { uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16), uint8_t(value >> 24) };
+}
+
+static Bytes flacBlock(uint8_t type, const Bytes& payload, bool last = false)
+{
+    Bytes data { uint8_t(type | (last ? 0x80 : 0)), uint8_t(payload.size() >> 16), uint8_t(payload.size() >> 8), uint8_t(payload.size()) };
+    append(data, payload);
+    return data;
+}
+
+static Bytes streamInfo(uint32_t sampleRate, uint32_t channels, uint64_t totalSamples)
+{
+    // block sizes and frame sizes first, then 20 bits rate, 3 bits channels, 5 bits bits per sample and 36 bits samples
+    Bytes info(10, 0);
+    uint32_t bitsPerSample = 16;
+    info.push_back(uint8_t(sampleRate >> 12));
+    info.push_back(uint8_t(sampleRate >> 4));
+    info.push_back(uint8_t(((sampleRate & 0x0F) << 4) | ((channels - 1) << 1) | ((bitsPerSample - 1) >> 4)));
+    info.push_back(uint8_t((((bitsPerSample - 1) & 0x0F) << 4) | ((totalSamples >> 32) & 0x0F)));
+    append(info, bigEndian(uint32_t(totalSamples)));
+    // md5 signature
+    info.resize(34, 0);
+    return info;
+}
+
+static Bytes vorbisComment(const std::vector<std::string>& comments)
+{
+    Bytes data;
+    std::string vendor = "reference libFLAC 1.3.2";
+    append(data, littleEndian(uint32_t(vendor.size())));
+    append(data, vendor);
+    append(data, littleEndian(uint32_t(comments.size())));
+    for (auto& comment : comments)
+    {
+        append(data, littleEndian(uint32_t(comment.size())));
+        append(data, comment);
+    }
+
+    return data;
+}
+
+static Bytes flac(const std::vector<Bytes>& blocks)
+{
+    Bytes data;
+    append(data, std::string("fLaC"));
+    for (auto& block : blocks)
+    {
+        append(data, block);
+    }
+
+    return data;
+}
+
+class TagReaderTest : public Test
+{
+protected:
+    void SetUp() override
+    {
+        m_Directory = std::filesystem::temp_directory_path() / "audiotagreadertest";
+        std::filesystem::create_directories(m_Directory);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(m_Directory);
+    }
+
+    bool read(const Bytes& data, const std::string& extension = "mp3", bool readAudioProperties = false)
+    {
+        auto path = (m_Directory / ("file." + extension)).string();
+        {
+            std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+            stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+        }
+
+        m_Fields = MetadataFields();
+        return TagReader::read(path, readAudioProperties, m_Arena, m_Fields);
+    }
+
+    std::filesystem::path   m_Directory;
+    StringArena             m_Arena;
+    MetadataFields          m_Fields;
+};
+
+TEST_F(TagReaderTest, Id3v23Latin1)
+{
+    Bytes frames;
+    append(frames, frame(3, "TPE1", text(0, "Caf\xE9")));
+    append(frames, frame(3, "TIT2", text(0, "Title")));
+    append(frames, frame(3, "TALB", text(0, "Album")));
+    append(frames, frame(3, "TPE2", text(0, "Album Artist")));
+    append(frames, frame(3, "TCON", text(0, "(17)")));
+    append(frames, frame(3, "TCOM", text(0, "Composer")));
+    append(frames, frame(3, "TRCK", text(0, "3/12")));
+    append(frames, frame(3, "TPOS", text(0, "1/2")));
+    append(frames, frame(3, "TYER", text(0, "2001")));
+
+    ASSERT_TRUE(read(tag(3, frames, 0, 64)));
+    EXPECT_EQ("Caf\xC3\xA9", m_Fields.artist);
+    EXPECT_EQ("Title", m_Fields.title);
+    EXPECT_EQ("Album", m_Fields.album);
+    EXPECT_EQ("Album Artist", m_Fields.albumArtist);
+    EXPECT_EQ("Rock", m_Fields.genre);
+    EXPECT_EQ("Composer", m_Fields.composer);
+    EXPECT_EQ(3u, m_Fields.trackNr);
+    EXPECT_EQ(1u, m_Fields.discNr);
+    EXPECT_EQ(2001u, m_Fields.year);
+}
+
+TEST_F(TagReaderTest, Id3v24Utf8)
+{
+    // large enough to need more than one byte of the synchsafe size
+    std::string title(300, 'x');
+
+    Bytes frames;
+    append(frames, frame(4, "TIT2", text(3, title)));
+    append(frames, frame(4, "TPE1", text(3, "\xC3\xA9t\xC3\xA9 ")));
+    append(frames, frame(4, "TDRC", text(3, "2018-05-01")));
+
+    ASSERT_TRUE(read(tag(4, frames)));
+    EXPECT_EQ(title, m_Fields.title);
+    EXPECT_EQ("\xC3\xA9t\xC3\xA9", m_Fields.artist);
+    EXPECT_EQ(2018u, m_Fields.year);
+}
+
+TEST_F(TagReaderTest, Utf16WithByteOrderMark)
+{
+    Bytes frames;
+    append(frames, frame(3, "TPE1", utf16(1, u"Little \u00E9", false, true)));
+    append(frames, frame(3, "TIT2", utf16(1, u"Big \u20AC", true, true)));
+    // surrogate pair: U+1F3B5
+    append(frames, frame(3, "TALB", utf16(1, u"\U0001F3B5", false, true)));
+
+    ASSERT_TRUE(read(tag(3, frames)));
+    EXPECT_EQ("Little \xC3\xA9", m_Fields.artist);
+    EXPECT_EQ("Big \xE2\x82\xAC", m_Fields.title);
+    EXPECT_EQ("\xF0\x9F\x8E\xB5", m_Fields.album);
+}
+
+TEST_F(TagReaderTest, Utf16WithoutByteOrderMark)
+{
+    Bytes frames;
+    append(frames, frame(4, "TPE1", utf16(2, u"Big endian \u00E9", true, false)));
+    append(frames, frame(4, "TIT2", utf16(2, u"Terminated", true, false)));
+
+    ASSERT_TRUE(read(tag(4, frames)));
+    EXPECT_EQ("Big endian \xC3\xA9", m_Fields.artist);
+    EXPECT_EQ("Terminated", m_Fields.title);
+}
+
+TEST_F(TagReaderTest, ExtendedHeader)
+{
+    Bytes frames = frame(3, "TIT2", text(0, "Title"));
+
+    // version 3: the size excludes itself
+    Bytes v3;
+    append(v3, bigEndian(6));
+    v3.resize(10, 0);
+    append(v3, frames);
+    ASSERT_TRUE(read(tag(3, v3, 0x40)));
+    EXPECT_EQ("Title", m_Fields.title);
+
+    // version 4: synchsafe size that includes itself
+    frames = frame(4, "TIT2", text(3, "Title"));
+    Bytes v4;
+    append(v4, synchsafe(6));
+    v4.push_back(1);
+    v4.push_back(0);
+    append(v4, frames);
+    ASSERT_TRUE(read(tag(4, v4, 0x40)));
+    EXPECT_EQ("Title", m_Fields.title);
+
+    // larger than the tag
+    Bytes invalid;
+    append(invalid, bigEndian(1000));
+    append(invalid, frames);
+    EXPECT_FALSE(read(tag(3, invalid, 0x40)));
+}
+
+TEST_F(TagReaderTest, UnsupportedFrameFlags)
+{
+    // compressed or encrypted frames that are not read are skipped
+    Bytes frames;
+    append(frames, frame(3, "TXXX", text(0, "compressed"), 0x0080));
+    append(frames, frame(3, "TIT2", text(0, "Title")));
+    ASSERT_TRUE(read(tag(3, frames)));
+    EXPECT_EQ("Title", m_Fields.title);
+
+    // the full parser has to handle a field that can not be decoded
+    frames = frame(3, "TIT2", text(0, "compressed"), 0x0080);
+    EXPECT_FALSE(read(tag(3, frames)));
+
+    frames = frame(3, "TRCK", text(0, "1"), 0x0040);
+    EXPECT_FALSE(read(tag(3, frames)));
+
+    frames = frame(4, "TPE1", text(3, "encrypted"), 0x0004);
+    EXPECT_FALSE(read(tag(4, frames)));
+
+    frames = frame(4, "TALB", text(3, "compressed"), 0x0008);
+    EXPECT_FALSE(read(tag(4, frames)));
+}
+
+TEST_F(TagReaderTest, Malformed)
+{
+    EXPECT_FALSE(read(Bytes()));
+    EXPECT_FALSE(read(Bytes { 'I', 'D', '3' }));
+    EXPECT_FALSE(read(Bytes(100, 0xFF)));
+
+    Bytes frames = frame(3, "TIT2", text(0, "Title"));
+
+    // unsupported version and whole tag unsynchronisation
+    EXPECT_FALSE(read(tag(2, frames)));
+    EXPECT_FALSE(read(tag(3, frames, 0x80)));
+
+    // frame larger than the tag
+    auto data = tag(3, frames);
+    data[10 + 7] = 0x7F;
+    EXPECT_FALSE(read(data));
+
+    // truncated file
+    data = tag(3, frames);
+    data.resize(data.size() - 2);
+    EXPECT_FALSE(read(data));
+
+    // tag size beyond the end of the file
+    data = tag(3, frames);
+    auto hugeSize = synchsafe(0x0FFFFFFF);
+    std::copy(hugeSize.begin(), hugeSize.end(), data.begin() + 6);
+    EXPECT_FALSE(read(data));
+
+    // empty text frames and a frame header without data
+    frames = frame(3, "TIT2", Bytes());
+    append(frames, frame(3, "TPE1", text(1, "")));
+    ASSERT_TRUE(read(tag(3, frames)));
+    EXPECT_TRUE(m_Fields.title.empty());
+    EXPECT_TRUE(m_Fields.artist.empty());
+
+    // padding ends the frames
+    frames = frame(3, "TIT2", text(0, "Title"));
+    data = tag(3, frames, 0, 20);
+    ASSERT_TRUE(read(data));
+    EXPECT_EQ("Title", m_Fields.title);
+}
+
+TEST_F(TagReaderTest, FlacStreamInfo)
+{
+    // 10 seconds of audio followed by 1250000 bytes of frames: 1000 kbps
+    auto data = flac({ flacBlock(0, streamInfo(44100, 2, 441000), true) });
+    data.resize(data.size() + 1250000, 0);
+    ASSERT_TRUE(read(data, "flac", true));
+    EXPECT_EQ(44100u, m_Fields.sampleRate);
+    EXPECT_EQ(2u, m_Fields.channels);
+    EXPECT_EQ(10u, m_Fields.duration);
+    EXPECT_EQ(1000u, m_Fields.bitRate);
+
+    // sample rate that needs all 20 bits and a sample count that needs all 36 bits
+    uint64_t totalSamples = 0xF00000000ull + 655350;
+    data = flac({ flacBlock(0, streamInfo(655350, 8, totalSamples), true) });
+    ASSERT_TRUE(read(data, "flac", true));
+    EXPECT_EQ(655350u, m_Fields.sampleRate);
+    EXPECT_EQ(8u, m_Fields.channels);
+    EXPECT_EQ(uint32_t(totalSamples / 655350), m_Fields.duration);
+
+    // the audio properties are only filled in when requested
+    data = flac({ flacBlock(0, streamInfo(48000, 6, 480000), true) });
+    ASSERT_TRUE(read(data, "flac", false));
+    EXPECT_EQ(0u, m_Fields.sampleRate);
+    EXPECT_EQ(0u, m_Fields.channels);
+    EXPECT_EQ(0u, m_Fields.duration);
+}
+
+TEST_F(TagReaderTest, FlacVorbisComment)
+{
+    auto comments = vorbisComment({
+        "ARTIST=Caf\xC3\xA9",
+        "title= Title ",
+        "Album=Album",
+        "ALBUMARTIST=Album Artist",
+        "GENRE=Rock",
+        "COMPOSER=Composer",
+        "TRACKNUMBER=3",
+        "DISCNUMBER=2",
+        "DATE=1999-01-01",
+        "ARTIST=Second Artist",
+        "NOSEPARATOR",
+        "COMMENT=Ignored",
+    });
+
+    ASSERT_TRUE(read(flac({ flacBlock(0, streamInfo(44100, 2, 441000)), flacBlock(4, comments, true) }), "flac"));
+    EXPECT_EQ("Caf\xC3\xA9", m_Fields.artist);
+    EXPECT_EQ("Title", m_Fields.title);
+    EXPECT_EQ("Album", m_Fields.album);
+    EXPECT_EQ("Album Artist", m_Fields.albumArtist);
+    EXPECT_EQ("Rock", m_Fields.genre);
+    EXPECT_EQ("Composer", m_Fields.composer);
+    EXPECT_EQ(3u, m_Fields.trackNr);
+    EXPECT_EQ(2u, m_Fields.discNr);
+    EXPECT_EQ(1999u, m_Fields.year);
+}
+
+TEST_F(TagReaderTest, FlacSkipsPictureBlock)
+{
+    // the picture data contains a fake vorbis comment that must not be parsed
+    Bytes picture;
+    append(picture, flacBlock(4, vorbisComment({ "TITLE=Picture" })));
+    picture.resize(4096, 0xFF);
+
+    auto data = flac({
+        flacBlock(0, streamInfo(44100, 2, 441000)),
+        flacBlock(6, picture),
+        flacBlock(1, Bytes(100, 0)),
+        flacBlock(4, vorbisComment({ "TITLE=Title" }), true),
+    });
+
+    ASSERT_TRUE(read(data, "flac", true));
+    EXPECT_EQ("Title", m_Fields.title);
+    EXPECT_EQ(44100u, m_Fields.sampleRate);
+}
+
+TEST_F(TagReaderTest, FlacTruncated)
+{
+    EXPECT_FALSE(read(Bytes { 'f', 'L', 'a' }, "flac"));
+    EXPECT_FALSE(read(Bytes(100, 0), "flac"));
+
+    // id3v2 tag in front of the marker is left to the full parser
+    auto data = tag(3, frame(3, "TIT2", text(0, "Title")));
+    append(data, flac({ flacBlock(0, streamInfo(44100, 2, 441000), true) }));
+    EXPECT_FALSE(read(data, "flac"));
+
+    // block shorter than its header claims
+    data = flac({ flacBlock(0, streamInfo(44100, 2, 441000)), flacBlock(4, vorbisComment({ "TITLE=Title" }), true) });
+    data.resize(data.size() - 3);
+    EXPECT_FALSE(read(data, "flac"));
+
+    data = flac({ flacBlock(0, streamInfo(44100, 2, 441000), true) });
+    data.resize(data.size() - 10);
+    EXPECT_FALSE(read(data, "flac"));
+
+    // no last block flag and nothing after the picture that is skipped
+    data = flac({ flacBlock(0, streamInfo(44100, 2, 441000)), flacBlock(6, Bytes(64, 0)) });
+    EXPECT_FALSE(read(data, "flac"));
+
+    // comment length beyond the end of the block
+    auto comments = vorbisComment({ "TITLE=Title" });
+    comments[comments.size() - 15] = 0xFF;
+    EXPECT_FALSE(read(flac({ flacBlock(4, comments, true) }), "flac"));
+}
+
+TEST_F(TagReaderTest, UnsupportedFiles)
+{
+    Bytes frames = frame(3, "TIT2", text(0, "Title"));
+    EXPECT_FALSE(read(tag(3, frames), "ogg"));
+    EXPECT_FALSE(TagReader::isSupported("file.ogg"));
+    EXPECT_TRUE(TagReader::isSupported("file.MP3"));
+    EXPECT_TRUE(TagReader::isSupported("file.flac"));
+}
+
+}
+}
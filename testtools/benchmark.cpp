@@ -0,0 +1,460 @@
+//    Copyright (C) 2018 Dirk Vanden Boer <dirk.vdb@gmail.com>
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utils/log.h"
+
+#include "audioconfig.h"
+#include "audio/audioformat.h"
+#include "audio/audioframe.h"
+#include "audiobuffer.h"
+#include "audiofade.h"
+#include "audioringbuffer.h"
+
+#ifdef HAVE_MAD
+#include "audiomaddecoder.h"
+#endif
+
+#ifdef HAVE_FLAC
+#include "audioflacdecoder.h"
+#include <FLAC++/encoder.h>
+#endif
+
+#ifdef HAVE_FFMPEG
+#include "audioffmpegdecoder.h"
+#include "audioresampler.h"
+#endif
+
+using namespace std;
+using namespace utils;
+using namespace audio;
+
+// Decoder and kernel throughput measurements
+// Every benchmark is repeated until it ran for at least the minimum duration,
+// the results can be written as json so they can be compared between builds.
+
+static const uint32_t FIXTURE_RATE = 44100;
+static const uint32_t FIXTURE_CHANNELS = 2;
+static const uint32_t FIXTURE_SECONDS = 30;
+static const uint32_t KERNEL_BLOCK_SIZE = 1024 * 1024;
+static const uint32_t CHUNK_SIZE = 4096;
+static const double PI = 3.14159265358979323846;
+
+struct Result
+{
+    std::string name;
+    double      seconds = 0.0;
+    uint64_t    bytes = 0;
+    uint64_t    frames = 0;        // sample frames, only for decoders
+    double      audioSeconds = 0.0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Runs func until minDuration has passed, func returns the number of bytes it processed
+static Result measure(const std::string& name, double minDuration, const std::function<uint64_t()>& func)
+{
+    Result result;
+    result.name = name;
+
+    auto start = Clock::now();
+    do
+    {
+        result.bytes += func();
+        result.seconds = secondsSince(start);
+    }
+    while (result.seconds < minDuration);
+
+    return result;
+}
+
+// Stereo signal with two tones and some noise so the encoders cannot cheat
+static std::vector<int16_t> generateSignal(uint32_t numFrames)
+{
+    std::vector<int16_t> samples(numFrames * FIXTURE_CHANNELS);
+    uint32_t noise = 12345;
+
+    for (uint32_t i = 0; i < numFrames; ++i)
+    {
+        double t = static_cast<double>(i) / FIXTURE_RATE;
+        for (uint32_t channel = 0; channel < FIXTURE_CHANNELS; ++channel)
+        {
+            noise = noise * 1103515245 + 12345;
+            double value = 0.4 * std::sin(2 * PI * (440.0 + channel * 110.0) * t)
+                         + 0.2 * std::sin(2 * PI * 3520.0 * t)
+                         + 0.02 * (static_cast<int32_t>(noise >> 16 & 0x7FFF) / 16384.0 - 1.0);
+            samples[i * FIXTURE_CHANNELS + channel] = static_cast<int16_t>(value * 32767);
+        }
+    }
+
+    return samples;
+}
+
+static void writeLittleEndian(std::ofstream& stream, uint32_t value, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        stream.put(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+static void writeWave(const std::string& path, const std::vector<int16_t>& samples)
+{
+    std::ofstream stream(path, std::ios::binary);
+    if (!stream.is_open())
+    {
+        throw std::logic_error("Failed to create " + path);
+    }
+
+    uint32_t dataSize = static_cast<uint32_t>(samples.size() * sizeof(int16_t));
+
+    stream.write("RIFF", 4);
+    writeLittleEndian(stream, 36 + dataSize, 4);
+    stream.write("WAVEfmt ", 8);
+    writeLittleEndian(stream, 16, 4);
+    writeLittleEndian(stream, 1, 2); // pcm
+    writeLittleEndian(stream, FIXTURE_CHANNELS, 2);
+    writeLittleEndian(stream, FIXTURE_RATE, 4);
+    writeLittleEndian(stream, FIXTURE_RATE * FIXTURE_CHANNELS * sizeof(int16_t), 4);
+    writeLittleEndian(stream, FIXTURE_CHANNELS * sizeof(int16_t), 2);
+    writeLittleEndian(stream, 16, 2);
+    stream.write("data", 4);
+    writeLittleEndian(stream, dataSize, 4);
+    stream.write(reinterpret_cast<const char*>(samples.data()), dataSize);
+}
+
+#ifdef HAVE_FLAC
+static void writeFlac(const std::string& path, const std::vector<int16_t>& samples)
+{
+    FLAC::Encoder::File encoder;
+    encoder.set_channels(FIXTURE_CHANNELS);
+    encoder.set_bits_per_sample(16);
+    encoder.set_sample_rate(FIXTURE_RATE);
+    encoder.set_compression_level(5);
+    encoder.set_total_samples_estimate(samples.size() / FIXTURE_CHANNELS);
+
+    if (encoder.init(path) != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
+    {
+        throw std::logic_error("Failed to create " + path);
+    }
+
+    std::vector<FLAC__int32> block;
+    for (size_t offset = 0; offset < samples.size(); offset += CHUNK_SIZE * FIXTURE_CHANNELS)
+    {
+        auto count = std::min<size_t>(CHUNK_SIZE * FIXTURE_CHANNELS, samples.size() - offset);
+        block.assign(samples.begin() + offset, samples.begin() + offset + count);
+        if (!encoder.process_interleaved(block.data(), static_cast<uint32_t>(count / FIXTURE_CHANNELS)))
+        {
+            throw std::logic_error("Failed to encode " + path);
+        }
+    }
+
+    encoder.finish();
+}
+#endif
+
+template <typename DecoderType>
+static Result benchmarkDecoder(const std::string& name, const std::string& path, double minDuration)
+{
+    Result result;
+    result.name = name;
+
+    auto start = Clock::now();
+    do
+    {
+        DecoderType decoder(path);
+        auto format = decoder.getAudioFormat();
+        // 24 bit samples are stored in 32 bit containers
+        uint32_t frameSize = (format.bits == 24 ? 4 : format.bits / 8) * format.numChannels;
+
+        Frame frame;
+        uint64_t bytes = 0;
+        while (decoder.decodeAudioFrame(frame))
+        {
+            bytes += frame.getDataSize();
+        }
+
+        result.bytes += bytes;
+        result.frames += bytes / frameSize;
+        result.audioSeconds += static_cast<double>(bytes / frameSize) / format.rate;
+        result.seconds = secondsSince(start);
+    }
+    while (result.seconds < minDuration);
+
+    return result;
+}
+
+static void runDecoder(std::vector<Result>& results, const std::function<Result()>& func)
+{
+    try
+    {
+        results.push_back(func());
+    }
+    catch (std::exception& e)
+    {
+        log::error("Decoder benchmark failed: {}", e.what());
+    }
+}
+
+static void benchmarkDecoders(std::vector<Result>& results, const std::string& fixtureDir, const std::string& mp3Path, double minDuration)
+{
+    auto samples = generateSignal(FIXTURE_RATE * FIXTURE_SECONDS);
+    std::vector<std::string> fixtures;
+
+    std::string wavePath = fixtureDir + "/benchmark.wav";
+    writeWave(wavePath, samples);
+    fixtures.push_back(wavePath);
+
+#ifdef HAVE_FFMPEG
+    runDecoder(results, [&] () { return benchmarkDecoder<FFmpegDecoder>("decode.wav.ffmpeg", wavePath, minDuration); });
+#endif
+
+#ifdef HAVE_FLAC
+    std::string flacPath = fixtureDir + "/benchmark.flac";
+    writeFlac(flacPath, samples);
+    fixtures.push_back(flacPath);
+
+    runDecoder(results, [&] () { return benchmarkDecoder<FlacDecoder>("decode.flac.flac", flacPath, minDuration); });
+#ifdef HAVE_FFMPEG
+    runDecoder(results, [&] () { return benchmarkDecoder<FFmpegDecoder>("decode.flac.ffmpeg", flacPath, minDuration); });
+#endif
+#endif
+
+    // there is no mp3 encoder available, the file has to be provided
+    if (!mp3Path.empty())
+    {
+#ifdef HAVE_MAD
+        runDecoder(results, [&] () { return benchmarkDecoder<MadDecoder>("decode.mp3.mad", mp3Path, minDuration); });
+#endif
+#ifdef HAVE_FFMPEG
+        runDecoder(results, [&] () { return benchmarkDecoder<FFmpegDecoder>("decode.mp3.ffmpeg", mp3Path, minDuration); });
+#endif
+    }
+
+    for (auto& fixture : fixtures)
+    {
+        std::remove(fixture.c_str());
+    }
+}
+
+static void benchmarkKernels(std::vector<Result>& results, double minDuration)
+{
+    Format s16Format;
+    s16Format.rate = FIXTURE_RATE;
+    s16Format.numChannels = FIXTURE_CHANNELS;
+    s16Format.bits = 16;
+
+    Format floatFormat = s16Format;
+    floatFormat.bits = 32;
+    floatFormat.floatingPoint = true;
+
+    auto signal = generateSignal(KERNEL_BLOCK_SIZE / (sizeof(int16_t) * FIXTURE_CHANNELS));
+    std::vector<uint8_t> s16Block(KERNEL_BLOCK_SIZE);
+    memcpy(s16Block.data(), signal.data(), KERNEL_BLOCK_SIZE);
+
+    std::vector<uint8_t> floatBlock(KERNEL_BLOCK_SIZE);
+    auto* pFloat = reinterpret_cast<float*>(floatBlock.data());
+    for (size_t i = 0; i < KERNEL_BLOCK_SIZE / sizeof(float); ++i)
+    {
+        pFloat[i] = signal[i % signal.size()] / 32768.f;
+    }
+
+    // alternate between attenuation and amplification so the samples do not decay to denormals
+    int32_t volumes[] = { 80, 125 };
+    uint32_t volumeIndex = 0;
+
+    results.push_back(measure("volume.s16", minDuration, [&] () {
+        applyVolume(s16Block.data(), KERNEL_BLOCK_SIZE, s16Format, volumes[++volumeIndex % 2]);
+        return KERNEL_BLOCK_SIZE;
+    }));
+
+    results.push_back(measure("volume.float", minDuration, [&] () {
+        applyVolume(floatBlock.data(), KERNEL_BLOCK_SIZE, floatFormat, volumes[++volumeIndex % 2]);
+        return KERNEL_BLOCK_SIZE;
+    }));
+
+    // a fade in over the whole block would converge to silence, restore the input every run
+    std::vector<uint8_t> fadeBlock(KERNEL_BLOCK_SIZE);
+    results.push_back(measure("fade.s16", minDuration, [&] () {
+        memcpy(fadeBlock.data(), s16Block.data(), KERNEL_BLOCK_SIZE);
+        applyFade(fadeBlock.data(), KERNEL_BLOCK_SIZE, s16Format, 0, KERNEL_BLOCK_SIZE / 4, FadeDirection::In);
+        return KERNEL_BLOCK_SIZE;
+    }));
+
+    results.push_back(measure("fade.float", minDuration, [&] () {
+        memcpy(fadeBlock.data(), floatBlock.data(), KERNEL_BLOCK_SIZE);
+        applyFade(fadeBlock.data(), KERNEL_BLOCK_SIZE, floatFormat, 0, KERNEL_BLOCK_SIZE / 8, FadeDirection::In);
+        return KERNEL_BLOCK_SIZE;
+    }));
+
+#ifdef HAVE_FFMPEG
+    Format resampledFormat = floatFormat;
+    resampledFormat.rate = 48000;
+
+    Resampler converter(s16Format, floatFormat);
+    results.push_back(measure("convert.s16_float", minDuration, [&] () {
+        for (uint32_t offset = 0; offset < KERNEL_BLOCK_SIZE; offset += CHUNK_SIZE)
+        {
+            converter.resample(s16Block.data() + offset, CHUNK_SIZE);
+        }
+        return KERNEL_BLOCK_SIZE;
+    }));
+
+    Resampler resampler(s16Format, resampledFormat);
+    results.push_back(measure("resample.s16_44100_float_48000", minDuration, [&] () {
+        for (uint32_t offset = 0; offset < KERNEL_BLOCK_SIZE; offset += CHUNK_SIZE)
+        {
+            resampler.resample(s16Block.data() + offset, CHUNK_SIZE);
+        }
+        return KERNEL_BLOCK_SIZE;
+    }));
+#endif
+
+    Buffer buffer(KERNEL_BLOCK_SIZE);
+    results.push_back(measure("buffer", minDuration, [&] () {
+        uint64_t bytes = 0;
+        while (buffer.bytesFree() >= CHUNK_SIZE)
+        {
+            buffer.writeData(s16Block.data(), CHUNK_SIZE);
+        }
+
+        while (buffer.bytesUsed() > 0)
+        {
+            uint32_t size = CHUNK_SIZE;
+            buffer.getData(size);
+            bytes += size;
+        }
+        return bytes;
+    }));
+
+    RingBuffer ringBuffer(KERNEL_BLOCK_SIZE);
+    std::vector<uint8_t> readBlock(CHUNK_SIZE);
+    results.push_back(measure("ringbuffer", minDuration, [&] () {
+        uint64_t bytes = 0;
+        while (ringBuffer.bytesFree() >= CHUNK_SIZE)
+        {
+            ringBuffer.writeData(s16Block.data(), CHUNK_SIZE);
+        }
+
+        while (ringBuffer.bytesUsed() > 0)
+        {
+            bytes += ringBuffer.readData(readBlock.data(), CHUNK_SIZE);
+        }
+        return bytes;
+    }));
+}
+
+static void writeJson(const std::string& path, const std::vector<Result>& results)
+{
+    std::ofstream stream(path);
+    if (!stream.is_open())
+    {
+        throw std::logic_error("Failed to create " + path);
+    }
+
+    stream << "{\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        auto& result = results[i];
+        stream << (i == 0 ? "\n" : ",\n");
+        stream << "    { \"name\": \"" << result.name << "\""
+               << ", \"seconds\": " << result.seconds
+               << ", \"bytes_per_second\": " << result.bytes / result.seconds;
+        if (result.frames > 0)
+        {
+            stream << ", \"samples_per_second\": " << result.frames / result.seconds
+                   << ", \"realtime_factor\": " << result.audioSeconds / result.seconds;
+        }
+        stream << " }";
+    }
+    stream << "\n  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        std::string jsonPath;
+        std::string mp3Path;
+        std::string fixtureDir = ".";
+        double minDuration = 1.0;
+
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (i + 1 >= argc)
+            {
+                log::error("Usage: {} [--json file] [--mp3 file] [--fixtures dir] [--duration seconds]", argv[0]);
+                return -1;
+            }
+
+            if (arg == "--json")            jsonPath = argv[++i];
+            else if (arg == "--mp3")        mp3Path = argv[++i];
+            else if (arg == "--fixtures")   fixtureDir = argv[++i];
+            else if (arg == "--duration")   minDuration = std::stod(argv[++i]);
+            else
+            {
+                log::error("Unknown argument: {}", arg);
+                return -1;
+            }
+        }
+
+        std::vector<Result> results;
+        benchmarkDecoders(results, fixtureDir, mp3Path, minDuration);
+        benchmarkKernels(results, minDuration);
+
+        for (auto& result : results)
+        {
+            if (result.frames > 0)
+            {
+                log::info("{:<32} {:>10.1f} MB/s {:>12.0f} samples/s {:>8.1f}x realtime", result.name,
+                    result.bytes / result.seconds / (1024 * 1024), result.frames / result.seconds, result.audioSeconds / result.seconds);
+            }
+            else
+            {
+                log::info("{:<32} {:>10.1f} MB/s", result.name, result.bytes / result.seconds / (1024 * 1024));
+            }
+        }
+
+        if (!jsonPath.empty())
+        {
+            writeJson(jsonPath, results);
+        }
+    }
+    catch (std::exception& e)
+    {
+        log::error(e.what());
+        return -1;
+    }
+
+    return 0;
+}
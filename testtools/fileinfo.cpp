@@ -9,6 +9,8 @@
 #include "audioconfig.h"
 #ifdef HAVE_TAGLIB
 #include "audio/audiometadata.h"
+#include "audio/audiometadatacache.h"
+#include "audio/audiometadatascanner.h"
 #endif
 #include "audio/audiompegutils.h"
 
@@ -20,22 +22,53 @@ int main(int argc, char** argv)
 {
     try
     {
-        if (argc != 2)
+        if (argc != 2 && argc != 3)
         {
-            log::error("Usage: {} filename", argv[0]);
+            log::error("Usage: {} filename [metadatacache]", argv[0]);
             return -1;
         }
         
 #ifdef HAVE_TAGLIB
-        Metadata meta(argv[1], Metadata::ReadAudioProperties::Yes);
-        log::info("Artist: {}", meta.getArtist());
-        log::info("Title: {}", meta.getTitle());
-        
-        auto data = meta.getAlbumArt();
-        if (!data.data.empty())
+        // the cache is only used for the tags, the mpeg header is always read from the file
+        std::unique_ptr<MetadataCache> cache;
+        FileStamp stamp;
+        TrackMetadata track;
+        if (argc == 3 && FileStamp::get(argv[1], stamp))
+        {
+            cache = std::make_unique<MetadataCache>(argv[2]);
+        }
+
+        if (cache && cache->lookup(argv[1], stamp, MetadataCache::AudioProperties, track))
+        {
+            log::info("Artist: {} (cached)", track.artist);
+            log::info("Title: {} (cached)", track.title);
+        }
+        else
+        {
+            // read the tags like a library scan so the cache entry is complete
+            MetadataScanner::Options options;
+            options.threads = 1;
+            options.cache   = cache.get();
+
+            MetadataScanner scanner(options);
+            scanner.scan({ argv[1] }, [] (const TrackMetadata& track) {
+                log::info("Artist: {}", track.artist);
+                log::info("Title: {}", track.title);
+            });
+
+            if (cache)
+            {
+                cache->save();
+            }
+        }
+
+        // the album art is not part of the metadata cache
+        Metadata meta(argv[1], Metadata::ReadAudioProperties::No);
+        auto art = meta.getAlbumArtView();
+        if (!art.empty())
         {
             ofstream ostr("cover.jpg", std::ios::binary);
-            ostr.write(reinterpret_cast<const char*>(data.data.data()), data.data.size());
+            ostr.write(reinterpret_cast<const char*>(art.pData), art.size);
         }
         else
         {
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <deque>
 #include <mutex>
 #include <condition_variable>
@@ -55,6 +56,17 @@ public:
     {
         return m_Tracks.size();
     }
+
+    std::vector<std::shared_ptr<ITrack>> peekNextTracks(size_t count) const override
+    {
+        std::vector<std::shared_ptr<ITrack>> tracks;
+        for (size_t i = 0; i < std::min(count, m_Tracks.size()); ++i)
+        {
+            tracks.push_back(std::make_shared<Track>(m_Tracks[i]));
+        }
+
+        return tracks;
+    }
     
 private:
     std::deque<std::string>    m_Tracks;
@@ -67,15 +79,19 @@ int main(int argc, char** argv)
 {
     try
     {
-        if (argc != 2)
+        if (argc < 2)
         {
-            log::error("Usage: {} filename", argv[0]);
+            log::error("Usage: {} filename...", argv[0]);
             return -1;
         }
         
         Playlist playlist;
         std::unique_ptr<IPlayback> playback(PlaybackFactory::create("Custom", "Playback", "OpenAL", "Default", playlist));
-        playlist.addTrack(argv[1]);
+        // the tracks after the first one are opened in advance while the first one plays
+        for (int i = 1; i < argc; ++i)
+        {
+            playlist.addTrack(argv[i]);
+        }
 
         playback->play();
         